@@ -0,0 +1,24 @@
+#ifndef ALIGNEDBLOCK_H
+#define ALIGNEDBLOCK_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+  * allocate a memory block whose usable part starts on an aligned address
+  * (the buffers of Plane, ImagePlane and ScratchArena)
+  *
+  * @param bytes usable bytes
+  * @param alignment alignment of the first usable byte (power of 2)
+  * @param block memory block to give back with free (0 -> out of memory)
+  * @return  first aligned byte in block (0 -> out of memory, bytes too large)
+  */
+inline void *alignedAllocate(size_t bytes, size_t alignment, void **block) {
+    *block = bytes <= (size_t) -1 - alignment ? malloc(bytes + alignment) : 0;
+    if(*block == 0) {
+        return 0;
+    }
+    return (void*) (((uintptr_t) *block + alignment - 1) & ~(uintptr_t) (alignment - 1));
+}
+
+#endif // ALIGNEDBLOCK_H
@@ -0,0 +1,617 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QDir>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include "pgmimage.h"
+#include "kernels.h"
+#include "threadpool.h"
+#include "lanepipeline.h"
+
+/**
+  * one step of the pipeline
+  */
+struct Step {
+    QString name; ///< name in the pipeline spec
+    int **kernel; ///< kernel of a convolution (Gauss, or 0)
+    int kSize; ///< size of the kernel
+    bool builtin; ///< true -> convolution with builtinKernel
+    Kernels::Builtin builtinKernel; ///< built-in kernel (if builtin)
+    int filterSize; ///< window size of a box, median or bilateral filter (or 0)
+};
+
+/**
+  * result of one file
+  */
+struct FileResult {
+    int ret; ///< 0 -> ok, otherwise error code of the failed step
+    QString failedStep; ///< name of the failed step
+    qint64 nsecs; ///< processing time (load, steps and save)
+    qint64 pixels; ///< pixels of the image
+    long scratchAllocations; ///< blocks allocated by the scratch arena of the image for this file
+    size_t scratchHighWater; ///< most bytes of the scratch arena taken by one step
+};
+
+static bool verbose = false; ///< true -> show debug output of the steps
+
+#if QT_VERSION >= 0x050000
+static void messageHandler(QtMsgType type, const QMessageLogContext &, const QString &msg) {
+    if(type != QtDebugMsg || verbose) {
+	fprintf(stderr, "%s\n", qPrintable(msg));
+    }
+}
+#else
+static void messageHandler(QtMsgType type, const char *msg) {
+    if(type != QtDebugMsg || verbose) {
+	fprintf(stderr, "%s\n", msg);
+    }
+}
+#endif
+
+static void usage() {
+    fprintf(stderr,
+	    "usage: cvbatch [options] files...\n"
+	    "  files may contain wildcards (e.g. frames/*.pgm)\n"
+	    "  with -l a file may contain several frames, - reads frames from stdin\n"
+	    "options:\n"
+	    "  -p <pipeline>  steps separated by ',' (default: gauss7,sobelLD,houghLD,dye)\n"
+	    "                 invert histogram equalize threshold gauss<n> kirsch laplace\n"
+	    "                 prewitt1 prewitt2 sobel sobelLD box<n> median<n> bilateral<n>\n"
+	    "                 gradient compassKirsch compassPrewitt compassRobinson canny\n"
+	    "                 hough houghP houghG houghC houghPC houghLD dye cutRD\n"
+	    "  -l             lane detection of a frame sequence in pipelined threads\n"
+	    "                 (gauss7, sobelLD, houghLD, dye), prints the lanes per frame\n"
+	    "  -t             with -l: track the lanes, search only around the last lanes\n"
+	    "  -r <roi>       region of interest: left,top,right,bottom (rectangle) or\n"
+	    "                 x1,y1,x2,y2,x3,y3,... (polygon) in pixels\n"
+	    "  -o <dir>       save the results in this directory\n"
+	    "  -j <threads>   number of threads (default: number of cores)\n"
+	    "  -b <repeats>   benchmark of load, convolution (gauss7), hough, histogram,\n"
+	    "                 invert and savePgm on synthetic 640x480 and 3840x2160 frames\n"
+	    "                 (no files needed)\n"
+	    "  -v             show debug output of the steps\n");
+}
+
+/**
+  * create the steps of a pipeline spec
+  *
+  * @param spec steps separated by ','
+  * @param steps created steps
+  * @return  0 -> steps created
+  *         -1 -> unknown step
+  *         -2 -> out of memory
+  */
+static int parseSteps(const QString &spec, std::vector<Step> *steps) {
+    QStringList names = spec.split(',', QString::SkipEmptyParts);
+    foreach(QString name, names) {
+	Step step;
+	step.name = name.trimmed();
+	step.kernel = 0;
+	step.kSize = 0;
+	step.builtin = false;
+	step.builtinKernel = Kernels::Sobel;
+	step.filterSize = 0;
+
+	// kernels of the convolutions
+	if(step.name.startsWith("gauss")) {
+	    bool ok;
+	    step.kSize = step.name.mid(5).toInt(&ok);
+	    if(!ok || step.kSize < 3 || step.kSize > 23 || step.kSize % 2 == 0) {
+		return -1;
+	    }
+	} else if(step.name == "laplace" || step.name == "kirsch" || step.name == "prewitt1"
+		  || step.name == "prewitt2" || step.name == "sobel" || step.name == "sobelLD") {
+	    // built-in kernels are applied with their stencils
+	    step.builtin = true;
+	    if(step.name == "laplace") {
+		step.builtinKernel = Kernels::Laplace;
+	    } else if(step.name == "kirsch") {
+		step.builtinKernel = Kernels::Kirsch;
+	    } else if(step.name == "prewitt1") {
+		step.builtinKernel = Kernels::Prewitt1;
+	    } else if(step.name == "prewitt2") {
+		step.builtinKernel = Kernels::Prewitt2;
+	    } else if(step.name == "sobel") {
+		step.builtinKernel = Kernels::Sobel;
+	    } else {
+		step.builtinKernel = Kernels::SobelVertical;
+	    }
+	} else if(step.name.startsWith("box") || step.name.startsWith("median")
+		  || step.name.startsWith("bilateral")) {
+	    // filters with a window of 3 .. 51 (size after the name)
+	    bool ok;
+	    int nameLength = step.name.startsWith("box") ? 3 : (step.name.startsWith("median") ? 6 : 9);
+	    step.filterSize = step.name.mid(nameLength).toInt(&ok);
+	    if(!ok || step.filterSize < 3 || step.filterSize > 51 || step.filterSize % 2 == 0) {
+		return -1;
+	    }
+	} else if(step.name != "invert" && step.name != "histogram" && step.name != "equalize"
+		  && step.name != "threshold" && step.name != "gradient"
+		  && step.name != "compassKirsch" && step.name != "compassPrewitt"
+		  && step.name != "compassRobinson" && step.name != "canny"
+		  && step.name != "hough" && step.name != "houghP" && step.name != "houghG"
+		  && step.name != "houghC" && step.name != "houghPC"
+		  && step.name != "houghLD" && step.name != "dye" && step.name != "cutRD") {
+	    return -1;
+	}
+
+	if(step.kSize > 0) {
+	    step.kernel = Kernels::allocate(step.kSize);
+	    if(step.kernel == 0) {
+		return -2;
+	    }
+	    Kernels::gauss(step.kernel, step.kSize);
+	}
+	steps->push_back(step);
+    }
+    return steps->empty() ? -1 : 0;
+}
+
+/**
+  * create the region of interest of a spec
+  *
+  * @param spec numbers separated by ',' (4 -> rectangle, 6 or more -> polygon)
+  * @param roi created region
+  * @return  0 -> region created
+  *         -1 -> wrong spec
+  */
+static int parseRoi(const QString &spec, Roi *roi) {
+    QStringList numbers = spec.split(',', QString::SkipEmptyParts);
+    std::vector<double> values;
+    foreach(QString number, numbers) {
+	bool ok;
+	values.push_back(number.trimmed().toDouble(&ok));
+	if(!ok) {
+	    return -1;
+	}
+    }
+    if(values.size() == 4) {
+	roi->setRectangle((int) values[0], (int) values[1], (int) values[2], (int) values[3]);
+    } else if(values.size() >= 6 && values.size() % 2 == 0) {
+	std::vector<RoiPoint> corners;
+	for(size_t i = 0; i < values.size(); i += 2) {
+	    RoiPoint corner = { values[i], values[i+1] };
+	    corners.push_back(corner);
+	}
+	roi->setPolygon(corners);
+    } else {
+	return -1;
+    }
+    return 0;
+}
+
+/**
+  * run one step on the image
+  *
+  * @return  0 -> ok, otherwise error code of the operation
+  */
+static int runStep(PgmImage *image, const Step &step) {
+    if(step.name == "sobelLD") {
+	return image->convolutionLD(step.builtinKernel);
+    } else if(step.builtin) {
+	return image->convolution(step.builtinKernel);
+    } else if(step.kernel != 0) {
+	return image->convolution(step.kernel, step.kSize, false);
+    } else if(step.name.startsWith("box")) {
+	return image->box(step.filterSize);
+    } else if(step.name.startsWith("median")) {
+	return image->median(step.filterSize);
+    } else if(step.name.startsWith("bilateral")) {
+	return image->bilateral(step.filterSize);
+    } else if(step.name == "invert") {
+	return image->invert();
+    } else if(step.name == "histogram") {
+	return image->histogram();
+    } else if(step.name == "equalize") {
+	return image->equalize();
+    } else if(step.name == "threshold") {
+	return image->threshold();
+    } else if(step.name == "hough") {
+	return image->hough();
+    } else if(step.name == "gradient") {
+	return image->gradient();
+    } else if(step.name == "compassKirsch") {
+	return image->compass(Compass::Kirsch);
+    } else if(step.name == "compassPrewitt") {
+	return image->compass(Compass::Prewitt);
+    } else if(step.name == "compassRobinson") {
+	return image->compass(Compass::Robinson);
+    } else if(step.name == "canny") {
+	return image->canny();
+    } else if(step.name == "houghP") {
+	return image->houghP();
+    } else if(step.name == "houghG") {
+	return image->houghGradient();
+    } else if(step.name == "houghC") {
+	return image->houghCanny();
+    } else if(step.name == "houghPC") {
+	return image->houghPCanny();
+    } else if(step.name == "houghLD") {
+	return image->houghLD();
+    } else if(step.name == "dye") {
+	return image->dyeLD();
+    } else if(step.name == "cutRD") {
+	return image->cutRD();
+    }
+    return -1;
+}
+
+/**
+  * load a file, run the pipeline and save the result
+  */
+static void processFile(PgmImage *image, const QString &path, const std::vector<Step> &steps,
+			const QString &outDir, FileResult *result) {
+    QElapsedTimer timer;
+    timer.start();
+    result->pixels = 0;
+    long allocations = image->getScratch().allocations();
+
+    result->ret = image->loadPgm(path);
+    result->failedStep = "load";
+    if(result->ret == 0) {
+	result->pixels = (qint64) image->getWidth() * image->getHeight();
+	for(size_t i = 0; i < steps.size() && result->ret == 0; i++) {
+	    result->ret = runStep(image, steps[i]);
+	    result->failedStep = steps[i].name;
+	}
+    }
+    if(result->ret == 0 && !outDir.isEmpty()) {
+	result->ret = image->savePgm(QDir(outDir).filePath(QFileInfo(path).fileName()));
+	result->failedStep = "save";
+    }
+    result->nsecs = timer.nsecsElapsed();
+    result->scratchAllocations = image->getScratch().allocations() - allocations;
+    result->scratchHighWater = image->getScratch().highWater();
+}
+
+/**
+  * run the lane detection pipeline on all frames and print the lanes
+  *
+  * @return  0 -> all frames done
+  *          1 -> at least one frame failed
+  *         -4 -> out of memory
+  */
+static int runLanes(const QStringList &files, const QString &outDir, bool tracking,
+		    const Roi &roi) {
+    long count = 0;
+    long failed = 0;
+    qint64 latencySum = 0;
+    qint64 latencyMax = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    LanePipeline pipeline;
+    pipeline.setTracking(tracking);
+    pipeline.setRoi(roi);
+    int ret = pipeline.run(files, [&](LaneFrame &frame) {
+	count++;
+	if(frame.ret != 0) {
+	    failed++;
+	    printf("frame %ld %s: error %d in %s\n", frame.number, qPrintable(frame.source),
+		   frame.ret, qPrintable(frame.failedStage));
+	    return;
+	}
+	latencySum += frame.latency;
+	latencyMax = frame.latency > latencyMax ? frame.latency : latencyMax;
+
+	// lane lines and dyed lane
+	printf("frame %ld %s: %.2f ms", frame.number, qPrintable(frame.source),
+	       frame.latency / 1e6);
+	const char *names[2] = { "left", "right" };
+	int index[2] = { frame.left, frame.right };
+	for(int i = 0; i < 2; i++) {
+	    if(index[i] < 0) {
+		printf(", %s none", names[i]);
+	    } else {
+		const HoughLine &line = frame.lines[index[i]];
+		printf(", %s rho %.0f theta %.0f votes %d", names[i], line.rho, line.theta,
+		       line.votes);
+	    }
+	}
+	if(frame.lane.area > 0) {
+	    printf(", lane %ld px x %d-%d y %d-%d\n", frame.lane.area, frame.lane.left,
+		   frame.lane.right, frame.lane.top, frame.lane.bottom);
+	} else {
+	    printf(", lane none\n");
+	}
+
+	if(!outDir.isEmpty()) {
+	    char name[32];
+	    snprintf(name, sizeof(name), "frame%06ld.pgm", frame.number);
+	    frame.image.savePgm(QDir(outDir).filePath(name));
+	}
+    });
+    if(ret < 0) {
+	return ret;
+    }
+
+    double seconds = timer.nsecsElapsed() / 1e9;
+    long ok = count - failed;
+    printf("%ld frames (%ld failed) in %.3f s: %.1f frames/s, latency %.2f ms (max %.2f ms)\n",
+	   count, failed, seconds, ok / seconds, ok > 0 ? latencySum / 1e6 / ok : 0.0,
+	   latencyMax / 1e6);
+    if(tracking) {
+	printf("tracking: %ld full searches, %ld band searches\n",
+	       pipeline.laneTracker().fullSearchCount(), pipeline.laneTracker().bandSearchCount());
+    }
+    return ret;
+}
+
+/**
+  * create a synthetic road frame: noisy bright background and two dark
+  * lane lines from the bottom corners to the center
+  *
+  * @param width width of the frame
+  * @param height height of the frame
+  * @return  pgm file (header and pixels)
+  */
+static std::vector<uint8_t> syntheticFrame(int width, int height) {
+    char header[64];
+    int headerSize = snprintf(header, sizeof(header), "P5\n%d %d\n255\n", width, height);
+    std::vector<uint8_t> frame(header, header + headerSize);
+    frame.resize(headerSize + (size_t) width * height);
+    uint8_t *pixel = &frame[headerSize];
+
+    uint32_t random = 1;
+    int thickness = width / 160 + 1;
+    for(int y = 0; y < height; y++) {
+	// lane lines below the horizon (the middle row)
+	int depth = y - height / 2;
+	int leftLane = width / 2 - (int) ((long long) depth * width / height);
+	int rightLane = width / 2 + (int) ((long long) depth * width / height);
+	for(int x = 0; x < width; x++) {
+	    random = random * 1103515245u + 12345u;
+	    int value = 150 + (int) ((random >> 16) & 63);
+	    if(depth >= 0 && (abs(x - leftLane) < thickness || abs(x - rightLane) < thickness)) {
+		value = 20 + (int) ((random >> 16) & 15);
+	    }
+	    *pixel++ = (uint8_t) value;
+	}
+    }
+    return frame;
+}
+
+/**
+  * time the operations of PgmImage on synthetic frames of 640x480 and
+  * 3840x2160 pixels and print the best and the median time of every
+  * operation (every run starts with a freshly loaded frame)
+  *
+  * @param repeats runs of every operation
+  * @return  0 -> all operations done
+  *          1 -> an operation failed
+  *         -4 -> out of memory
+  */
+static int runBenchmark(int repeats) {
+    const int sizes[2][2] = { { 640, 480 }, { 3840, 2160 } };
+    const char *names[6] = { "load", "convolution", "hough", "histogram", "invert", "savePgm" };
+    int **kernel = Kernels::allocate(7);
+    if(kernel == 0) {
+	return -4;
+    }
+    Kernels::gauss(kernel, 7);
+
+    int ret = 0;
+    printf("%d runs, %d threads\n", repeats, ThreadPool::instance()->threadCount());
+    for(int s = 0; s < 2 && ret == 0; s++) {
+	int width = sizes[s][0];
+	int height = sizes[s][1];
+	QString input = QDir::temp().filePath(QString("cvbatch-bench-%1x%2.pgm").arg(width).arg(height));
+	QString output = QDir::temp().filePath("cvbatch-bench-out.pgm");
+
+	// the frame is loaded from a file like a real one
+	PgmImage image;
+	std::vector<uint8_t> frame = syntheticFrame(width, height);
+	ret = image.loadPgm(&frame[0], frame.size());
+	if(ret == 0) {
+	    ret = image.savePgm(input);
+	}
+	if(ret != 0) {
+	    printf("%dx%d: error %d while creating the frame\n", width, height, ret);
+	    break;
+	}
+
+	for(int op = 0; op < 6 && ret == 0; op++) {
+	    std::vector<qint64> times;
+	    for(int r = 0; r < repeats && ret == 0; r++) {
+		QElapsedTimer timer;
+		if(op == 0) {
+		    timer.start();
+		    ret = image.loadPgm(input);
+		} else {
+		    ret = image.loadPgm(input);
+		    timer.start();
+		    if(ret != 0) {
+			break;
+		    } else if(op == 1) {
+			ret = image.convolution(kernel, 7, false);
+		    } else if(op == 2) {
+			ret = image.hough();
+		    } else if(op == 3) {
+			ret = image.histogram();
+		    } else if(op == 4) {
+			ret = image.invert();
+		    } else {
+			ret = image.savePgm(output);
+		    }
+		}
+		times.push_back(timer.nsecsElapsed());
+	    }
+	    if(ret != 0) {
+		printf("%dx%d %s: error %d\n", width, height, names[op], ret);
+		break;
+	    }
+
+	    std::sort(times.begin(), times.end());
+	    qint64 best = times[0];
+	    qint64 median = times[times.size() / 2];
+	    printf("%4dx%-4d %-12s best %8.3f ms, median %8.3f ms, %8.1f MPixel/s\n", width, height,
+		   names[op], best / 1e6, median / 1e6,
+		   best > 0 ? (double) width * height * 1e3 / best : 0.0);
+	}
+	QFile::remove(input);
+	QFile::remove(output);
+    }
+    Kernels::release(kernel, 7);
+    return ret;
+}
+
+/**
+  * expand the wildcards of the arguments
+  *
+  * @param args files and patterns
+  * @return  existing files (patterns sorted by name)
+  */
+static QStringList expandFiles(const QStringList &args) {
+    QStringList files;
+    foreach(QString arg, args) {
+	QFileInfo info(arg);
+	if(!arg.contains('*') && !arg.contains('?') && !arg.contains('[')) {
+	    files.append(arg);
+	    continue;
+	}
+	QDir dir = info.dir();
+	QStringList names = dir.entryList(QStringList(info.fileName()), QDir::Files, QDir::Name);
+	foreach(QString name, names) {
+	    files.append(dir.filePath(name));
+	}
+    }
+    return files;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+#if QT_VERSION >= 0x050000
+    qInstallMessageHandler(messageHandler);
+#else
+    qInstallMsgHandler(messageHandler);
+#endif
+
+    // read arguments
+    QString spec = "gauss7,sobelLD,houghLD,dye";
+    QString outDir;
+    bool lanes = false;
+    bool tracking = false;
+    int benchmarkRuns = 0;
+    Roi roi;
+    QStringList inputs;
+    QStringList args = app.arguments();
+    for(int i = 1; i < args.size(); i++) {
+	if(args[i] == "-p" && i+1 < args.size()) {
+	    spec = args[++i];
+	} else if(args[i] == "-r" && i+1 < args.size()) {
+	    if(parseRoi(args[++i], &roi) != 0) {
+		fprintf(stderr, "wrong region: %s\n", qPrintable(args[i]));
+		usage();
+		return 2;
+	    }
+	} else if(args[i] == "-o" && i+1 < args.size()) {
+	    outDir = args[++i];
+	} else if(args[i] == "-j" && i+1 < args.size()) {
+	    ThreadPool::instance()->setThreadCount(args[++i].toInt());
+	} else if(args[i] == "-b" && i+1 < args.size()) {
+	    benchmarkRuns = args[++i].toInt();
+	    if(benchmarkRuns <= 0) {
+		usage();
+		return 2;
+	    }
+	} else if(args[i] == "-v") {
+	    verbose = true;
+	} else if(args[i] == "-l") {
+	    lanes = true;
+	} else if(args[i] == "-t") {
+	    tracking = true;
+	} else if(args[i].startsWith("-") && args[i] != "-") {
+	    usage();
+	    return 2;
+	} else {
+	    inputs.append(args[i]);
+	}
+    }
+
+    if(benchmarkRuns > 0) {
+	int ret = runBenchmark(benchmarkRuns);
+	if(ret == -4) {
+	    fprintf(stderr, "out of memory\n");
+	}
+	return ret == 0 ? 0 : 1;
+    }
+
+    std::vector<Step> steps;
+    if(parseSteps(spec, &steps) != 0) {
+	fprintf(stderr, "wrong pipeline: %s\n", qPrintable(spec));
+	usage();
+	return 2;
+    }
+    QStringList files = expandFiles(inputs);
+    if(files.isEmpty()) {
+	usage();
+	return 2;
+    }
+    if(!outDir.isEmpty() && !QDir().mkpath(outDir)) {
+	fprintf(stderr, "cannot create %s\n", qPrintable(outDir));
+	return 2;
+    }
+
+    if(lanes) {
+	int ret = runLanes(files, outDir, tracking, roi);
+	if(ret == -4) {
+	    fprintf(stderr, "out of memory\n");
+	}
+	for(size_t i = 0; i < steps.size(); i++) {
+	    Kernels::release(steps[i].kernel, steps[i].kSize);
+	}
+	return ret == 0 ? 0 : 1;
+    }
+
+    // many files: one file per thread, otherwise every step uses all threads
+    std::vector<FileResult> results(files.size());
+    ThreadPool *pool = ThreadPool::instance();
+    std::atomic<int> nextFile(0);
+    QElapsedTimer timer;
+    timer.start();
+    ThreadPool::BandFunction worker = [&](int, int, int) {
+	PgmImage image;
+	image.setRoi(roi);
+	for(int i = nextFile++; i < files.size(); i = nextFile++) {
+	    processFile(&image, files[i], steps, outDir, &results[i]);
+	}
+    };
+    if(files.size() >= pool->threadCount()) {
+	pool->parallelBands(files.size(), worker, 1);
+    } else {
+	worker(0, files.size(), 0);
+    }
+    qint64 nsecs = timer.nsecsElapsed();
+
+    // report
+    int failed = 0;
+    qint64 pixels = 0;
+    for(int i = 0; i < files.size(); i++) {
+	const FileResult &result = results[i];
+	if(result.ret != 0) {
+	    failed++;
+	    printf("%s: error %d in %s\n", qPrintable(files[i]), result.ret,
+		   qPrintable(result.failedStep));
+	    continue;
+	}
+	pixels += result.pixels;
+	printf("%s: %.2f ms, %.1f MPixel/s, scratch %zu KB (%ld allocations)\n",
+	       qPrintable(files[i]), result.nsecs / 1e6,
+	       result.nsecs > 0 ? result.pixels * 1e3 / result.nsecs : 0.0,
+	       result.scratchHighWater / 1024, result.scratchAllocations);
+    }
+    double seconds = nsecs / 1e9;
+    printf("%d files (%d failed) in %.3f s with %d threads: %.1f frames/s, %.0f frames/min, %.1f MPixel/s\n",
+	   files.size(), failed, seconds, pool->threadCount(),
+	   (files.size() - failed) / seconds, (files.size() - failed) * 60 / seconds,
+	   pixels / seconds / 1e6);
+
+    for(size_t i = 0; i < steps.size(); i++) {
+	Kernels::release(steps[i].kernel, steps[i].kSize);
+    }
+    return failed == 0 ? 0 : 1;
+}
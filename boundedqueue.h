@@ -0,0 +1,99 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/**
+  * queue between two threads with a maximal number of elements
+  *
+  * push blocks while the queue is full, so a fast stage cannot run away
+  * from a slow one, pop blocks while the queue is empty
+  * after close the remaining elements can still be taken
+  */
+template<typename T>
+class BoundedQueue
+{
+private:
+    std::deque<T> elements; ///< elements in the queue
+    size_t capacity; ///< maximal number of elements
+    bool closed; ///< true -> no more elements will be pushed
+    std::mutex mutex; ///< protects elements and closed
+    std::condition_variable notFull; ///< signals a taken element or close
+    std::condition_variable notEmpty; ///< signals a new element or close
+
+    // the queue is shared by two threads, so it cannot be copied
+    BoundedQueue(const BoundedQueue &);
+    BoundedQueue &operator=(const BoundedQueue &);
+
+public:
+    /**
+      * @param capacity maximal number of elements (at least 1)
+      */
+    explicit BoundedQueue(size_t capacity) {
+        this->capacity = capacity > 0 ? capacity : 1;
+        closed = false;
+    }
+
+    /**
+      * add an element, wait while the queue is full
+      *
+      * @param element element to add
+      * @return  true -> element added, false -> queue is closed
+      */
+    bool push(const T &element) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(elements.size() >= capacity && !closed) {
+            notFull.wait(lock);
+        }
+        if(closed) {
+            return false;
+        }
+        elements.push_back(element);
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+      * take the oldest element, wait while the queue is empty
+      *
+      * @param element taken element
+      * @return  true -> element taken, false -> queue is closed and empty
+      */
+    bool pop(T *element) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(elements.empty() && !closed) {
+            notEmpty.wait(lock);
+        }
+        if(elements.empty()) {
+            return false;
+        }
+        *element = elements.front();
+        elements.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    /**
+      * close the queue, waiting threads wake up
+      */
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    /**
+      * get the number of elements in the queue
+      *
+      * @return  number of elements
+      */
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return elements.size();
+    }
+};
+
+#endif // BOUNDEDQUEUE_H
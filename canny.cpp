@@ -0,0 +1,161 @@
+#include "canny.h"
+#include "threadpool.h"
+#include <string.h>
+
+/**
+  * class of a pixel while detecting
+  */
+enum CannyClass {
+    CannyNone = 0, ///< no edge
+    CannyWeak = 1, ///< maximum from the low threshold on
+    CannyStrong = 2, ///< maximum from the high threshold on
+    CannyEdge = 3 ///< reached by the hysteresis
+};
+
+int Canny::detect(const ImageView &src, int low, int high, const Roi *roi) {
+    if(low < 0 || high < low) {
+	return -1;
+    }
+    if(marks.allocate(src.width, src.height) != 0) {
+	return -4;
+    }
+    for(int y = 0; y < src.height; y++) {
+	memset(marks.row(y), CannyNone, src.width);
+    }
+
+    Roi whole;
+    if(roi == 0) {
+	whole.prepare(src.width, src.height);
+	roi = &whole;
+    }
+    int top = roi->top();
+    int bottom = roi->bottom();
+
+    // gradient of the rows of the region and of the rows above and below
+    // (the suppression compares with them)
+    if(roi->isWhole()) {
+	sobel.compute(src);
+    } else {
+	Roi rows;
+	rows.setRectangle(0, top > 0 ? top-1 : 0, src.width, bottom < src.height ? bottom+1 : src.height);
+	rows.prepare(src.width, src.height);
+	sobel.compute(src, &rows);
+    }
+
+    // non-maximum suppression, the strong pixels of every band are the
+    // seeds of the hysteresis
+    ThreadPool *pool = ThreadPool::instance();
+    int bands = pool->bandCount(bottom - top);
+    seeds.resize(bands);
+    bandPoints.resize(bands);
+    int stride = marks.stride();
+    pool->parallelBands(bottom - top, [&](int begin, int end, int band) {
+	std::vector<int> &seed = seeds[band];
+	seed.clear();
+	for(int y = begin+top; y < end+top; y++) {
+	    const int16_t *magnitude = sobel.magnitudeRow(y);
+	    const int16_t *orientation = sobel.orientationRow(y);
+	    uint8_t *mark = marks.row(y);
+	    int count;
+	    const RoiSpan *span = roi->row(y, &count);
+	    for(int s = 0; s < count; s++) {
+		for(int x = span[s].left; x < span[s].right; x++) {
+		    // the first and the last row and column have no
+		    // orientation, so the neighbors are inside
+		    int m = magnitude[x];
+		    if(m < low || orientation[x] < 0) {
+			continue;
+		    }
+		    const int16_t *above = sobel.magnitudeRow(y-1);
+		    const int16_t *below = sobel.magnitudeRow(y+1);
+		    int before;
+		    int after;
+		    switch(((orientation[x] + 22) / 45) & 3) {
+		    case 0:
+			before = magnitude[x-1];
+			after = magnitude[x+1];
+			break;
+		    case 1:
+			before = above[x-1];
+			after = below[x+1];
+			break;
+		    case 2:
+			before = above[x];
+			after = below[x];
+			break;
+		    default:
+			before = above[x+1];
+			after = below[x-1];
+			break;
+		    }
+		    if(m <= before || m < after) {
+			continue;
+		    }
+		    if(m >= high) {
+			mark[x] = CannyStrong;
+			seed.push_back(y * stride + x);
+		    } else {
+			mark[x] = CannyWeak;
+		    }
+		}
+	    }
+	}
+    });
+
+    // hysteresis: follow the weak pixels from every strong one
+    uint8_t *map = marks.row(0);
+    const int neighbors[8] = { -stride-1, -stride, -stride+1, -1, 1, stride-1, stride, stride+1 };
+    for(int band = 0; band < bands; band++) {
+	for(size_t i = 0; i < seeds[band].size(); i++) {
+	    int start = seeds[band][i];
+	    if(map[start] != CannyStrong) {
+		// reached from an earlier seed
+		continue;
+	    }
+	    map[start] = CannyEdge;
+	    stack.push_back(start);
+	    while(!stack.empty()) {
+		int pixel = stack.back();
+		stack.pop_back();
+		for(int n = 0; n < 8; n++) {
+		    int next = pixel + neighbors[n];
+		    if(map[next] == CannyWeak || map[next] == CannyStrong) {
+			map[next] = CannyEdge;
+			stack.push_back(next);
+		    }
+		}
+	    }
+	}
+    }
+
+    // edge map and edge list, the bands collect their rows, the lists are
+    // appended in the order of the bands
+    pool->parallelBands(bottom - top, [&](int begin, int end, int band) {
+	EdgePoints &found = bandPoints[band];
+	found.x.clear();
+	found.y.clear();
+	for(int y = begin+top; y < end+top; y++) {
+	    uint8_t *mark = marks.row(y);
+	    int count;
+	    const RoiSpan *span = roi->row(y, &count);
+	    for(int s = 0; s < count; s++) {
+		for(int x = span[s].left; x < span[s].right; x++) {
+		    if(mark[x] == CannyEdge) {
+			mark[x] = edge;
+			found.x.push_back(x);
+			found.y.push_back(y);
+		    } else {
+			mark[x] = CannyNone;
+		    }
+		}
+	    }
+	}
+    });
+    points.x.clear();
+    points.y.clear();
+    for(int band = 0; band < bands; band++) {
+	points.x.insert(points.x.end(), bandPoints[band].x.begin(), bandPoints[band].x.end());
+	points.y.insert(points.y.end(), bandPoints[band].y.begin(), bandPoints[band].y.end());
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef CANNY_H
+#define CANNY_H
+
+#include <vector>
+#include "imageplane.h"
+#include "roi.h"
+#include "gradient.h"
+
+/**
+  * edge pixels as coordinate lists (one array per coordinate), row by row
+  * and left to right
+  */
+struct EdgePoints {
+    std::vector<int> x; ///< column of every edge pixel
+    std::vector<int> y; ///< row of every edge pixel
+
+    size_t size() const { return x.size(); } ///< number of edge pixels
+};
+
+/**
+  * edge detector of Canny on an 8 bit image
+  *
+  * gradient: Sobel magnitude and orientation (see Gradient)
+  * non-maximum suppression: a pixel stays only if its magnitude is the
+  * maximum along its gradient (the orientation rounded to 0, 45, 90 or 135
+  * degree, the pixel before wins equal magnitudes), so the edges are one
+  * pixel thin
+  * hysteresis: pixels from the high threshold on are edges, pixels from the
+  * low threshold on are edges if they are connected (8 neighbors) to an
+  * edge, followed with a stack instead of recursion
+  *
+  * the result is an edge map and the list of the edge pixels, so a
+  * following step (e.g. the Hough transformation) visits the edges only
+  * gradient and suppression run in parallel bands, the hysteresis follows
+  * the edges in one thread
+  */
+class Canny
+{
+private:
+    Gradient sobel; ///< gradient of the last image
+    Plane<uint8_t> marks; ///< class of every pixel while detecting, the edge map afterwards
+    std::vector<int> stack; ///< pixels (y * stride + x) whose neighbors are not followed yet
+    std::vector<std::vector<int> > seeds; ///< strong pixels of every band
+    std::vector<EdgePoints> bandPoints; ///< edge pixels of every band
+    EdgePoints points; ///< edge pixels of the region
+
+public:
+    static const uint8_t edge = 255; ///< value of an edge in the edge map (others: 0)
+
+    /**
+      * detect the edges of an image
+      *
+      * @param src image
+      * @param low low threshold of the magnitude (0 .. 1443)
+      * @param high high threshold of the magnitude (low .. 1443)
+      * @param roi only the pixels of this region (prepared for the size of
+      *            src, 0 -> whole image), the map is 0 outside of it
+      * @return  0 -> edges detected
+      *         -1 -> wrong thresholds
+      *         -4 -> out of memory
+      */
+    int detect(const ImageView &src, int low, int high, const Roi *roi = 0);
+
+    int width() const { return marks.width(); } ///< width of the edge map
+    int height() const { return marks.height(); } ///< height of the edge map
+
+    /**
+      * get the edge map of a row
+      *
+      * @param y row of the image
+      * @return  edge or 0 for the pixels of the row
+      */
+    const uint8_t *edgeRow(int y) const { return marks.constRow(y); }
+
+    /**
+      * get the edge pixels of the last detect
+      *
+      * @return  edge pixels of the region, row by row
+      */
+    const EdgePoints &edges() const { return points; }
+
+    /**
+      * get the gradient of the last detect (valid within the region)
+      *
+      * @return  magnitude and orientation
+      */
+    const Gradient &gradient() const { return sobel; }
+};
+
+#endif // CANNY_H
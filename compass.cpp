@@ -0,0 +1,281 @@
+#include "compass.h"
+#include "threadpool.h"
+#if defined(__SSE2__)
+#define CV_COMPASS_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+  * arithmetic of the responses of one pixel
+  */
+struct ScalarLanes {
+    typedef int Value;
+    static const int width = 1; ///< pixels at a time
+
+    static Value load(const uint8_t *pixel) { return *pixel; }
+    static Value set(int value) { return value; }
+    static Value add(Value a, Value b) { return a + b; }
+    static Value sub(Value a, Value b) { return a - b; }
+    static Value twice(Value a) { return a + a; }
+    static Value abs(Value a) { return a < 0 ? -a : a; }
+    static Value max(Value a, Value b) { return a > b ? a : b; }
+
+    /**
+      * keep a response and its direction if it is larger than the best one
+      */
+    static void keep(Value response, Value direction, Value *best, Value *bestDirection) {
+	if(response > *best) {
+	    *best = response;
+	    *bestDirection = direction;
+	}
+    }
+
+    static void store(Value best, Value bestDirection, int16_t *response, uint8_t *direction) {
+	*response = (int16_t) best;
+	*direction = (uint8_t) (best > 0 ? bestDirection : Compass::noDirection);
+    }
+};
+
+#ifdef CV_COMPASS_SSE2
+/**
+  * arithmetic of the responses of 8 pixels in 16 bit lanes
+  */
+struct SseLanes {
+    typedef __m128i Value;
+    static const int width = 8; ///< pixels at a time
+
+    static Value load(const uint8_t *pixels) {
+	return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) pixels), _mm_setzero_si128());
+    }
+    static Value set(int value) { return _mm_set1_epi16((short) value); }
+    static Value add(Value a, Value b) { return _mm_add_epi16(a, b); }
+    static Value sub(Value a, Value b) { return _mm_sub_epi16(a, b); }
+    static Value twice(Value a) { return _mm_add_epi16(a, a); }
+    static Value abs(Value a) { return _mm_max_epi16(a, _mm_sub_epi16(_mm_setzero_si128(), a)); }
+    static Value max(Value a, Value b) { return _mm_max_epi16(a, b); }
+
+    static void keep(Value response, Value direction, Value *best, Value *bestDirection) {
+	__m128i larger = _mm_cmpgt_epi16(response, *best);
+	*best = _mm_max_epi16(*best, response);
+	*bestDirection = _mm_or_si128(_mm_and_si128(larger, direction),
+				      _mm_andnot_si128(larger, *bestDirection));
+    }
+
+    static void store(Value best, Value bestDirection, int16_t *response, uint8_t *direction) {
+	_mm_storeu_si128((__m128i*) response, best);
+	__m128i edge = _mm_cmpgt_epi16(best, _mm_setzero_si128());
+	__m128i value = _mm_or_si128(_mm_and_si128(edge, bestDirection),
+				     _mm_andnot_si128(edge, _mm_set1_epi16(Compass::noDirection)));
+	_mm_storel_epi64((__m128i*) direction, _mm_packus_epi16(value, value));
+    }
+};
+#endif
+
+/**
+  * response of the mask of direction D
+  */
+template<typename L, Compass::Operator Op, int D>
+struct CompassMask {
+    typedef typename L::Value Value;
+
+    static Value response(const Value *ring, const Value *triple, Value common) {
+	if(Op == Compass::Kirsch) {
+	    return L::sub(L::twice(L::twice(L::twice(triple[D]))), common);
+	} else if(Op == Compass::Prewitt) {
+	    return L::sub(common, L::twice(triple[(D+4) & 7]));
+	}
+	return L::sub(L::add(triple[D], ring[D]), L::add(triple[(D+4) & 7], ring[(D+4) & 7]));
+    }
+};
+
+/**
+  * response of the mask of direction D and all masks after it (unrolled
+  * at compile time, the ring and the triples stay in registers)
+  */
+template<typename L, Compass::Operator Op, int Count, int D>
+struct CompassMasks {
+    typedef typename L::Value Value;
+
+    static void keep(const Value *ring, const Value *triple, Value common, Value *best,
+		     Value *bestDirection) {
+	Value value = CompassMask<L, Op, D>::response(ring, triple, common);
+	if(Count == 4) {
+	    // the opposite mask has the same orientation, only the mask of
+	    // Robinson is the negative of the opposite one
+	    if(Op == Compass::Robinson) {
+		value = L::abs(value);
+	    } else {
+		value = L::max(value, CompassMask<L, Op, (D+4) & 7>::response(ring, triple, common));
+	    }
+	}
+	if(D == 0) {
+	    *best = value;
+	} else {
+	    L::keep(value, L::set(D), best, bestDirection);
+	}
+	CompassMasks<L, Op, Count, D+1>::keep(ring, triple, common, best, bestDirection);
+    }
+};
+
+template<typename L, Compass::Operator Op, int Count>
+struct CompassMasks<L, Op, Count, Count> {
+    typedef typename L::Value Value;
+
+    static void keep(const Value *, const Value *, Value, Value *, Value *) {}
+};
+
+/**
+  * calculate the pixels x .. x + L::width - 1 of a row (the ring of
+  * neighbors is loaded once, every mask is a sum of its triples)
+  */
+template<typename L, Compass::Operator Op, int Count>
+static void computePixels(const uint8_t *above, const uint8_t *center, const uint8_t *below,
+			  int x, int16_t *response, uint8_t *direction) {
+    typedef typename L::Value Value;
+
+    // ring clockwise from the neighbor above
+    Value ring[8];
+    ring[0] = L::load(above + x);
+    ring[1] = L::load(above + x+1);
+    ring[2] = L::load(center + x+1);
+    ring[3] = L::load(below + x+1);
+    ring[4] = L::load(below + x);
+    ring[5] = L::load(below + x-1);
+    ring[6] = L::load(center + x-1);
+    ring[7] = L::load(above + x-1);
+
+    // triple d: the neighbors d-1, d and d+1
+    Value triple[8];
+    triple[0] = L::add(L::add(ring[7], ring[0]), ring[1]);
+    triple[1] = L::add(L::add(ring[0], ring[1]), ring[2]);
+    triple[2] = L::add(L::add(ring[1], ring[2]), ring[3]);
+    triple[3] = L::add(L::add(ring[2], ring[3]), ring[4]);
+    triple[4] = L::add(L::add(ring[3], ring[4]), ring[5]);
+    triple[5] = L::add(L::add(ring[4], ring[5]), ring[6]);
+    triple[6] = L::add(L::add(ring[5], ring[6]), ring[7]);
+    triple[7] = L::add(L::add(ring[6], ring[7]), ring[0]);
+    Value total = L::add(L::add(triple[1], triple[4]), L::add(ring[6], ring[7]));
+
+    // the parts which are the same for all directions
+    Value common;
+    if(Op == Compass::Kirsch) {
+	common = L::add(total, L::twice(total));
+    } else if(Op == Compass::Prewitt) {
+	common = L::sub(total, L::twice(L::load(center + x)));
+    } else {
+	common = L::set(0);
+    }
+
+    Value best = L::set(0);
+    Value bestDirection = L::set(0);
+    CompassMasks<L, Op, Count, 0>::keep(ring, triple, common, &best, &bestDirection);
+    L::store(best, bestDirection, response + x, direction + x);
+}
+
+/**
+  * calculate the pixels [first, last) of a row (first >= 1, last <= width-1)
+  */
+template<Compass::Operator Op, int Count>
+static void computeRow(const uint8_t *above, const uint8_t *center, const uint8_t *below,
+		       int first, int last, int16_t *response, uint8_t *direction) {
+    int x = first;
+#ifdef CV_COMPASS_SSE2
+    // the loads read up to x+8, which is at most last
+    for(; x + SseLanes::width <= last; x += SseLanes::width) {
+	computePixels<SseLanes, Op, Count>(above, center, below, x, response, direction);
+    }
+#endif
+    for(; x < last; x++) {
+	computePixels<ScalarLanes, Op, Count>(above, center, below, x, response, direction);
+    }
+}
+
+typedef void (*CompassRow)(const uint8_t *above, const uint8_t *center, const uint8_t *below,
+			   int first, int last, int16_t *response, uint8_t *direction);
+
+template<int Count>
+static CompassRow rowFunction(Compass::Operator op) {
+    switch(op) {
+    case Compass::Kirsch:
+	return computeRow<Compass::Kirsch, Count>;
+    case Compass::Prewitt:
+	return computeRow<Compass::Prewitt, Count>;
+    case Compass::Robinson:
+	return computeRow<Compass::Robinson, Count>;
+    }
+    return 0;
+}
+
+Compass::Compass() {
+    directionCount = 8;
+}
+
+int Compass::compute(const ImageView &src, Operator op, int count, const Roi *roi) {
+    if(count != 8 && count != 4) {
+	return -1;
+    }
+    if(responses.allocate(src.width, src.height) != 0
+       || directions.allocate(src.width, src.height) != 0) {
+	return -4;
+    }
+    directionCount = count;
+    CompassRow calculateRow = count == 8 ? rowFunction<8>(op) : rowFunction<4>(op);
+
+    Roi whole;
+    if(roi == 0) {
+	whole.prepare(src.width, src.height);
+	roi = &whole;
+    }
+
+    int top = roi->top();
+    ThreadPool::instance()->parallelBands(roi->bottom() - top, [&](int begin, int end, int) {
+	for(int y = begin+top; y < end+top; y++) {
+	    int16_t *response = responses.row(y);
+	    uint8_t *direction = directions.row(y);
+	    int spanCount;
+	    const RoiSpan *span = roi->row(y, &spanCount);
+	    for(int s = 0; s < spanCount; s++) {
+		// pixels of the first and the last row and column have no
+		// response
+		int left = span[s].left;
+		int right = span[s].right;
+		int first = left > 1 ? left : 1;
+		int last = right < src.width-1 ? right : src.width-1;
+		if(y == 0 || y == src.height-1 || first > last) {
+		    first = left;
+		    last = left;
+		}
+		for(int x = left; x < first; x++) {
+		    response[x] = 0;
+		    direction[x] = noDirection;
+		}
+		for(int x = last; x < right; x++) {
+		    response[x] = 0;
+		    direction[x] = noDirection;
+		}
+		if(first < last) {
+		    calculateRow(src.row(y-1), src.row(y), src.row(y+1), first, last, response, direction);
+		}
+	    }
+	}
+    });
+    return 0;
+}
+
+int Compass::bound(Operator op) {
+    switch(op) {
+    case Kirsch:
+	return 5 * 3 * 255;
+    case Prewitt:
+	return 5 * 255;
+    case Robinson:
+	return 4 * 255;
+    }
+    return 0;
+}
+
+int Compass::angle(int direction, int count) {
+    // direction 0 (brighter above) is 270 degree in the orientation of
+    // Gradient, every direction turns by 45 degree clockwise
+    return count == 4 ? (90 + 45 * direction) % 180 : (270 + 45 * direction) % 360;
+}
@@ -0,0 +1,109 @@
+#ifndef COMPASS_H
+#define COMPASS_H
+
+#include "imageplane.h"
+#include "roi.h"
+
+/**
+  * compass edge operator of an 8 bit image: the 3x3 mask is turned in 8
+  * steps of 45 degree, every pixel keeps the maximal response and the
+  * direction of the mask with this response
+  *
+  * the 8 neighbors of a pixel are read once, all masks are sums of
+  * neighboring triples of this ring: with T the sum of the ring, S(d) the
+  * triple around direction d and W(d) the triple with the center twice
+  * Kirsch:   5 * S(d) - 3 * (T - S(d))  = 8 * S(d) - 3 * T
+  * Prewitt:  T - 2 * S(d+4) - 2 * center (mask 1 1 1 / 1 -2 1 / -1 -1 -1)
+  * Robinson: W(d) - W(d+4)                (Sobel 1 2 1 / 0 0 0 / -1 -2 -1)
+  * so 8 directions cost hardly more than one mask
+  *
+  * direction d: the positive side of the mask points to the neighbor d,
+  * 0 -> up, 1 -> up right, 2 -> right, ... 7 -> up left (clockwise)
+  * with 4 directions a mask and the opposite one are one orientation: the
+  * direction d (0 .. 3) keeps the larger response of the masks d and d+4
+  * (for Robinson the absolute value, its mask d+4 is the negative of d)
+  *
+  * the pixels of the first and the last row and column have no response,
+  * 8 pixels are calculated at a time (SSE2), the rows in parallel bands
+  */
+class Compass
+{
+public:
+    /**
+      * mask of the operator
+      */
+    enum Operator {
+        Kirsch, ///< 5 5 5 / -3 0 -3 / -3 -3 -3
+        Prewitt, ///< 1 1 1 / 1 -2 1 / -1 -1 -1
+        Robinson ///< 1 2 1 / 0 0 0 / -1 -2 -1
+    };
+
+    static const uint8_t noDirection = 255; ///< direction of a pixel without response
+
+private:
+    Plane<int16_t> responses; ///< maximal response of every pixel
+    Plane<uint8_t> directions; ///< direction of the maximal response (or noDirection)
+    int directionCount; ///< directions of the last compute (8 or 4)
+
+public:
+    Compass();
+
+    /**
+      * calculate the maximal response and its direction of the pixels of
+      * an image
+      *
+      * @param src image
+      * @param op mask of the operator
+      * @param count number of directions (8 -> 45 degree steps, 4 -> 45
+      *              degree steps of one half, the larger response of a
+      *              mask and the opposite one)
+      * @param roi only the pixels of this region (prepared for the size of
+      *            src, 0 -> whole image), the values of the other pixels
+      *            are undefined
+      * @return  0 -> calculated
+      *         -1 -> wrong count
+      *         -4 -> out of memory
+      */
+    int compute(const ImageView &src, Operator op, int count = 8, const Roi *roi = 0);
+
+    /**
+      * get the bound of the responses of an operator
+      *
+      * @return  maximal absolute response of a pixel
+      */
+    static int bound(Operator op);
+
+    /**
+      * convert a direction into the angle of the normal of the edge (the
+      * orientation of Gradient: 0 -> brighter to the right, 90 -> brighter
+      * below)
+      *
+      * @param direction direction of a pixel (not noDirection)
+      * @param count number of directions of compute
+      * @return  angle in degree (0 .. 315, with 4 directions 0 .. 135)
+      */
+    static int angle(int direction, int count);
+
+    int width() const { return responses.width(); } ///< width of the planes
+    int height() const { return responses.height(); } ///< height of the planes
+    int count() const { return directionCount; } ///< directions of the last compute
+
+    /**
+      * get the responses of a row
+      *
+      * @param y row of the image
+      * @return  maximal response of the pixels of the row (<= 0 -> no edge)
+      */
+    const int16_t *responseRow(int y) const { return responses.constRow(y); }
+
+    /**
+      * get the directions of a row
+      *
+      * @param y row of the image
+      * @return  direction of the pixels of the row (0 .. count-1,
+      *          noDirection -> no edge)
+      */
+    const uint8_t *directionRow(int y) const { return directions.constRow(y); }
+};
+
+#endif // COMPASS_H
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include "compass.h"
+#include "threadpool.h"
+#include "roi.h"
+#include "imageplane.h"
+
+/**
+  * test of the compass operator: every pixel must have the response and
+  * the direction of the 3x3 masks evaluated one by one
+  */
+
+static const int threadCounts[2] = { 1, 3 };
+
+static int cases = 0; ///< compared results
+static int failedCases = 0; ///< results with at least one wrong pixel
+
+static uint32_t randomState = 1; ///< state of random (same numbers in every run)
+
+/**
+  * get a pseudo random number
+  *
+  * @param n number of values
+  * @return  0 .. n-1
+  */
+static int randomNumber(int n) {
+    randomState = randomState * 1103515245u + 12345u;
+    return (int) ((randomState >> 8) % (uint32_t) n);
+}
+
+/**
+  * weight of the neighbors of the mask of direction 0 (clockwise from the
+  * neighbor above, see Compass) and of the center
+  */
+static void masks(Compass::Operator op, int ring[8], int *center) {
+    const int kirsch[8] = { 5, 5, -3, -3, -3, -3, -3, 5 };
+    const int prewitt[8] = { 1, 1, 1, -1, -1, -1, 1, 1 };
+    const int robinson[8] = { 2, 1, 0, -1, -2, -1, 0, 1 };
+    const int *weights = op == Compass::Kirsch ? kirsch : (op == Compass::Prewitt ? prewitt : robinson);
+    for(int i = 0; i < 8; i++) {
+	ring[i] = weights[i];
+    }
+    *center = op == Compass::Prewitt ? -2 : 0;
+}
+
+/**
+  * calculate the response and the direction of a pixel with the masks
+  * (mask d is mask 0 turned by d steps of 45 degree clockwise)
+  *
+  * @param image image
+  * @param x column of the pixel (not in the first or last column)
+  * @param y row of the pixel (not in the first or last row)
+  * @param op operator
+  * @param count number of directions (8 or 4)
+  * @param direction direction of the response (or noDirection)
+  * @return  response
+  */
+static int brute(const Plane<uint8_t> &image, int x, int y, Compass::Operator op, int count,
+		 int *direction) {
+    const int dx[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+    const int dy[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+    int ring[8];
+    int center;
+    masks(op, ring, &center);
+
+    int responses[8];
+    for(int d = 0; d < 8; d++) {
+	int sum = center * image.constRow(y)[x];
+	for(int i = 0; i < 8; i++) {
+	    sum += ring[(i - d + 8) % 8] * image.constRow(y + dy[i])[x + dx[i]];
+	}
+	responses[d] = sum;
+    }
+
+    // the first direction with the largest response wins, with 4
+    // directions the opposite mask belongs to the direction
+    int best = 0;
+    *direction = 0;
+    for(int d = 0; d < count; d++) {
+	int value = responses[d];
+	if(count == 4 && responses[d+4] > value) {
+	    value = responses[d+4];
+	}
+	if(d == 0 || value > best) {
+	    best = value;
+	    *direction = d;
+	}
+    }
+    if(best <= 0) {
+	*direction = Compass::noDirection;
+    }
+    return best;
+}
+
+/**
+  * compare the compass operator of an image with the masks
+  *
+  * @param image image
+  * @param op operator
+  * @param count number of directions (8 or 4)
+  * @param roiName description of the region
+  * @param roi region (prepared for the size of image, 0 -> whole image)
+  */
+static void testCompass(const Plane<uint8_t> &image, Compass::Operator op, int count,
+			const char *roiName, const Roi *roi) {
+    const char *opNames[3] = { "Kirsch", "Prewitt", "Robinson" };
+    int width = image.width();
+    int height = image.height();
+    for(int t = 0; t < 2; t++) {
+	ThreadPool::instance()->setThreadCount(threadCounts[t]);
+	Compass compass;
+	cases++;
+	if(compass.compute(image.constView(), op, count, roi) != 0) {
+	    failedCases++;
+	    printf("FAIL %s %d directions: compute failed\n", opNames[op], count);
+	    continue;
+	}
+
+	long differences = 0;
+	for(int y = 0; y < height; y++) {
+	    int spanCount = 1;
+	    RoiSpan whole = { 0, width };
+	    const RoiSpan *span = roi != 0 ? roi->row(y, &spanCount) : &whole;
+	    for(int s = 0; s < spanCount; s++) {
+		for(int x = span[s].left; x < span[s].right; x++) {
+		    // the first and the last row and column have no response
+		    int direction = Compass::noDirection;
+		    int response = 0;
+		    if(x > 0 && x < width-1 && y > 0 && y < height-1) {
+			response = brute(image, x, y, op, count, &direction);
+		    }
+		    int actual = compass.responseRow(y)[x];
+		    int actualDirection = compass.directionRow(y)[x];
+		    if(actual != response || actualDirection != direction) {
+			if(differences == 0) {
+			    printf("FAIL %s %d directions, %dx%d image, %s, %d threads: "
+				   "(%d, %d) has %d direction %d instead of %d direction %d\n",
+				   opNames[op], count, width, height, roiName, threadCounts[t], x,
+				   y, actual, actualDirection, response, direction);
+			}
+			differences++;
+		    }
+		}
+	    }
+	}
+	if(differences > 0) {
+	    failedCases++;
+	}
+    }
+}
+
+int main() {
+    const int sizes[3][2] = { { 3, 3 }, { 37, 29 }, { 160, 120 } };
+    for(int i = 0; i < 3; i++) {
+	int width = sizes[i][0];
+	int height = sizes[i][1];
+
+	// noise with flat areas (no response, equal responses)
+	Plane<uint8_t> image;
+	if(image.allocate(width, height) != 0) {
+	    printf("FAIL out of memory\n");
+	    return 1;
+	}
+	for(int y = 0; y < height; y++) {
+	    for(int x = 0; x < width; x++) {
+		bool flat = (x / 8 + y / 8) % 3 == 0;
+		image.row(y)[x] = (uint8_t) (flat ? 128 : randomNumber(256));
+	    }
+	}
+
+	Roi rectangle;
+	rectangle.setRectangle(width / 4, height / 5, width - width / 3, height);
+	rectangle.prepare(width, height);
+	const Roi *rois[2] = { 0, &rectangle };
+	const char *roiNames[2] = { "whole image", "rectangle" };
+
+	const Compass::Operator ops[3] = { Compass::Kirsch, Compass::Prewitt, Compass::Robinson };
+	for(int o = 0; o < 3; o++) {
+	    for(int r = 0; r < 2; r++) {
+		testCompass(image, ops[o], 8, roiNames[r], rois[r]);
+		testCompass(image, ops[o], 4, roiNames[r], rois[r]);
+	    }
+	}
+    }
+
+    printf("%d results compared, %d differ\n", cases, failedCases);
+    return failedCases == 0 ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# Test of the compass operator against the 3x3 masks
+# evaluated one by one
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = compasstest
+TEMPLATE = app
+CONFIG   += console
+CONFIG   -= app_bundle
+
+# own objects and Makefile (cv and cvbatch are built in the same directory)
+OBJECTS_DIR = compasstest-obj
+MAKEFILE = Makefile.compasstest
+
+SOURCES += compasstest.cpp \
+    compass.cpp \
+    threadpool.cpp \
+    roi.cpp
+
+HEADERS += compass.h \
+    threadpool.h \
+    roi.h \
+    imageplane.h \
+    alignedblock.h
+
+QMAKE_CXXFLAGS += -std=c++11
+unix:LIBS += -pthread
@@ -0,0 +1,469 @@
+#include "convolution.h"
+#include "simd.h"
+#include "threadpool.h"
+#include <limits>
+
+/**
+  * vectorized multiply-add of a row (only for 32 bit sums)
+  *
+  * @return  true -> dst calculated
+  */
+static bool multiplyAddRow(const uint8_t *const *src, const int16_t *coeff, int taps,
+			   int *dst, int n) {
+    Simd::multiplyAdd(src, coeff, taps, dst, n);
+    return true;
+}
+
+static bool multiplyAddRow(const int16_t *const *src, const int16_t *coeff, int taps,
+			   int *dst, int n) {
+    Simd::multiplyAdd(src, coeff, taps, dst, n);
+    return true;
+}
+
+template <typename Src, typename Acc>
+static bool multiplyAddRow(const Src *const *, const int16_t *, int, Acc *, int) {
+    return false;
+}
+
+/**
+  * check if a coefficient fits in 16 bit
+  */
+static bool isShort(int value) {
+    return value >= -32768 && value <= 32767;
+}
+
+Convolution::Convolution(int **kernel, int size, bool rotate) {
+    prepare(kernel, size, rotate);
+}
+
+Convolution::Convolution(Kernels::Builtin builtin) {
+    // the generic part (border, bound) needs the coefficients too
+    int values[Kernels::maxBuiltinSize][Kernels::maxBuiltinSize];
+    int *kernel[Kernels::maxBuiltinSize];
+    for(int k = 0; k < Kernels::maxBuiltinSize; k++) {
+	kernel[k] = values[k];
+    }
+    Kernels::fill(kernel, builtin);
+    prepare(kernel, Kernels::size(builtin), Kernels::rotating(builtin));
+
+    switch(builtin) {
+    case Kernels::Kirsch:
+	useStencil<Kernels::Kirsch>();
+	break;
+    case Kernels::Laplace:
+	useStencil<Kernels::Laplace>();
+	break;
+    case Kernels::Prewitt1:
+	useStencil<Kernels::Prewitt1>();
+	break;
+    case Kernels::Prewitt2:
+	useStencil<Kernels::Prewitt2>();
+	break;
+    case Kernels::Sobel:
+	useStencil<Kernels::Sobel>();
+	break;
+    case Kernels::SobelVertical:
+	useStencil<Kernels::SobelVertical>();
+	break;
+    }
+}
+
+void Convolution::prepare(int **kernel, int size, bool rotate) {
+    kSize = size;
+    radius = (size-1)/2;
+    rotating = rotate;
+    stencilShort = 0;
+    stencilInt = 0;
+    stencilBorder = 0;
+
+    // copy the kernel and add the rotated kernel
+    original.resize(size*size);
+    combined.resize(size*size);
+    long long kernelSum = 0;
+    absSum = 0;
+    for(int k = 0; k < size; k++) {
+	for(int l = 0; l < size; l++) {
+	    original[k*size + l] = kernel[k][l];
+	    combined[k*size + l] = kernel[k][l] + (rotate ? kernel[l][size-1-k] : 0);
+	    kernelSum += kernel[k][l];
+	    absSum += kernel[k][l] < 0 ? -kernel[k][l] : kernel[k][l];
+	}
+    }
+    if(kernelSum == 0) {
+	divisorValue = 0;
+    } else {
+	divisorValue = rotate ? kernelSum*2 : kernelSum;
+    }
+    absSum *= rotate ? 2 : 1;
+
+    // only coefficients which are not zero are needed
+    shortTaps = true;
+    for(int k = 0; k < size; k++) {
+	for(int l = 0; l < size; l++) {
+	    if(combined[k*size + l] != 0) {
+		Tap tap;
+		tap.row = k;
+		tap.col = l;
+		tap.value = combined[k*size + l];
+		taps.push_back(tap);
+		tapValues.push_back((int16_t) tap.value);
+		shortTaps = shortTaps && isShort(tap.value);
+	    }
+	}
+    }
+    shortTaps = shortTaps && !taps.empty() && taps.size() <= (size_t) Simd::maxTaps;
+
+    split();
+}
+
+void Convolution::split() {
+    separable = false;
+    if(taps.empty()) {
+	return;
+    }
+
+    // use the first coefficient which is not zero as pivot
+    int p = taps[0].row;
+    int q = taps[0].col;
+    pivot = combined[p*kSize + q];
+    column.resize(kSize);
+    row.resize(kSize);
+    for(int i = 0; i < kSize; i++) {
+	column[i] = combined[i*kSize + q];
+	row[i] = combined[p*kSize + i];
+    }
+
+    // rank 1: every coefficient is column * row / pivot
+    int columnTaps = 0;
+    int rowTaps = 0;
+    for(int k = 0; k < kSize; k++) {
+	for(int l = 0; l < kSize; l++) {
+	    if((long long) combined[k*kSize + l] * pivot != (long long) column[k] * row[l]) {
+		return;
+	    }
+	}
+	columnTaps += column[k] != 0;
+	rowTaps += row[k] != 0;
+    }
+
+    // only worth it, if it saves multiplications
+    separable = columnTaps + rowTaps < (int) taps.size();
+
+    shortRow = true;
+    for(int l = 0; l < kSize; l++) {
+	if(row[l] != 0) {
+	    rowOffsets.push_back(l);
+	    rowValues.push_back((int16_t) row[l]);
+	    shortRow = shortRow && isShort(row[l]);
+	}
+    }
+}
+
+long long Convolution::bound(long long pixelBound) const {
+    long long sum = absSum * pixelBound;
+    long long divisor = divisorValue < 0 ? -divisorValue : divisorValue;
+    return divisor == 0 ? sum : (sum + divisor - 1) / divisor;
+}
+
+template <typename Src>
+long long Convolution::borderPixel(const PlaneView<Src> &src, int y, int x, long long white) const {
+    long long valueSum = 0;
+    for(int k = 0; k < kSize; k++) {
+	// attention: borders
+	int srcY = y-radius + k;
+	bool rowInside = srcY > 0 && srcY < src.height;
+	const Src *srcRow = rowInside ? src.row(srcY) : 0;
+	for(int l = 0; l < kSize; l++) {
+	    int srcX = x-radius + l;
+	    if(rowInside && srcX > 0 && srcX < src.width) {
+		// multiplize kernel with a pixel of the image
+		valueSum += (long long) combined[k*kSize + l] * srcRow[srcX];
+	    } else {
+		// multiplize kernel with the color white (for borders)
+		valueSum += original[k*kSize + l] * white;
+	    }
+	}
+    }
+    return valueSum;
+}
+
+long long Convolution::borderPixel(const ImageView &src, int y, int x, long long white) const {
+    if(stencilBorder == 0) {
+	return borderPixel<uint8_t>(src, y, x, white);
+    }
+    return stencilBorder(src.data, src.stride, src.width, src.height, y, x, (int) white);
+}
+
+template <typename Src, typename Acc, typename Dst>
+void Convolution::innerDirect(const PlaneView<Src> &src, const PlaneView<Dst> &dst,
+			      const Output &out, const int *left, const int *right,
+			      int y0, int y1) const {
+    std::vector<Acc> acc(src.width);
+    std::vector<const Src*> srcRows(taps.size() + 1);
+
+    for(int y = y0; y < y1; y++) {
+	int x0 = left[y];
+	int n = right[y] - x0;
+	if(n <= 0) {
+	    continue;
+	}
+	for(size_t t = 0; t < taps.size(); t++) {
+	    srcRows[t] = src.row(y-radius + taps[t].row) + x0-radius + taps[t].col;
+	}
+
+	// tap by tap, each one is a multiply-add over the whole row
+	if(!shortTaps || !multiplyAddRow(&srcRows[0], &tapValues[0], (int) taps.size(), &acc[0], n)) {
+	    for(int i = 0; i < n; i++) {
+		acc[i] = 0;
+	    }
+	    for(size_t t = 0; t < taps.size(); t++) {
+		const Src *srcRow = srcRows[t];
+		Acc value = taps[t].value;
+		for(int i = 0; i < n; i++) {
+		    acc[i] += value * srcRow[i];
+		}
+	    }
+	}
+
+	Dst *dstRow = dst.row(y) + x0;
+	for(int i = 0; i < n; i++) {
+	    dstRow[i] = store<Dst>(acc[i], out);
+	}
+    }
+}
+
+template <typename Src, typename Acc, typename Dst>
+void Convolution::innerSeparable(const PlaneView<Src> &src, const PlaneView<Dst> &dst,
+				 const Output &out, const int *left, const int *right,
+				 int x0, int x1, int y0, int y1) const {
+    int width = x1 - x0;
+    int h0 = y0 - radius;
+    int h1 = y1 + radius;
+    std::vector<Acc> tmp((size_t) (h1-h0) * width);
+    std::vector<Acc> acc(width);
+    std::vector<const Src*> srcRows(rowOffsets.size() + 1);
+
+    // horizontal pass with the row vector (only the columns needed by the
+    // rows below and above)
+    for(int y = h0; y < h1; y++) {
+	int from = x1;
+	int to = x0;
+	for(int k = y-radius > y0 ? y-radius : y0; k <= y+radius && k < y1; k++) {
+	    if(left[k] < right[k]) {
+		from = left[k] < from ? left[k] : from;
+		to = right[k] > to ? right[k] : to;
+	    }
+	}
+	int n = to - from;
+	if(n <= 0) {
+	    continue;
+	}
+	const Src *srcRow = src.row(y) + from-radius;
+	Acc *tmpRow = &tmp[(size_t) (y-h0) * width + from-x0];
+	for(size_t t = 0; t < rowOffsets.size(); t++) {
+	    srcRows[t] = srcRow + rowOffsets[t];
+	}
+	if(shortRow && multiplyAddRow(&srcRows[0], &rowValues[0], (int) rowOffsets.size(), tmpRow, n)) {
+	    continue;
+	}
+	for(int i = 0; i < n; i++) {
+	    tmpRow[i] = 0;
+	}
+	for(size_t t = 0; t < rowOffsets.size(); t++) {
+	    Acc value = row[rowOffsets[t]];
+	    for(int i = 0; i < n; i++) {
+		tmpRow[i] += value * srcRows[t][i];
+	    }
+	}
+    }
+
+    // vertical pass with the column vector
+    for(int y = y0; y < y1; y++) {
+	int n = right[y] - left[y];
+	if(n <= 0) {
+	    continue;
+	}
+	for(int i = 0; i < n; i++) {
+	    acc[i] = 0;
+	}
+	for(int k = 0; k < kSize; k++) {
+	    if(column[k] == 0) {
+		continue;
+	    }
+	    const Acc *tmpRow = &tmp[(size_t) (y-radius+k-h0) * width + left[y]-x0];
+	    Acc value = column[k];
+	    for(int i = 0; i < n; i++) {
+		acc[i] += value * tmpRow[i];
+	    }
+	}
+
+	Dst *dstRow = dst.row(y) + left[y];
+	for(int i = 0; i < n; i++) {
+	    dstRow[i] = store<Dst>((Acc) (acc[i] / pivot), out);
+	}
+    }
+}
+
+bool Convolution::innerStencil(const ImageView &src, const PlaneView<int16_t> &dst,
+			       const Output &out, const int *left, const int *right,
+			       int y0, int y1) const {
+    // the stencil shifts its sums up, but does not divide the shifted sum
+    // by 2^down
+    if(stencilShort == 0 || out.down != 0 || !out.narrow) {
+	return false;
+    }
+    bool vectors = Simd::active() != Simd::Scalar;
+    const uint8_t *rows[Kernels::maxBuiltinSize];
+    for(int y = y0; y < y1; y++) {
+	int n = right[y] - left[y];
+	if(n <= 0) {
+	    continue;
+	}
+	for(int k = 0; k < kSize; k++) {
+	    rows[k] = src.row(y-radius + k) + left[y]-radius;
+	}
+	stencilShort(rows, dst.row(y) + left[y], n, out.up, vectors);
+    }
+    return true;
+}
+
+bool Convolution::innerStencil(const ImageView &src, const PlaneView<int> &dst,
+			       const Output &out, const int *left, const int *right,
+			       int y0, int y1) const {
+    if(stencilInt == 0 || out.up != 0 || out.down != 0 || !out.narrow) {
+	return false;
+    }
+    bool vectors = Simd::active() != Simd::Scalar;
+    const uint8_t *rows[Kernels::maxBuiltinSize];
+    for(int y = y0; y < y1; y++) {
+	int n = right[y] - left[y];
+	if(n <= 0) {
+	    continue;
+	}
+	for(int k = 0; k < kSize; k++) {
+	    rows[k] = src.row(y-radius + k) + left[y]-radius;
+	}
+	stencilInt(rows, dst.row(y) + left[y], n, vectors);
+    }
+    return true;
+}
+
+void Convolution::apply(const ImageView &src, int *dst, int dstStride, const Roi *roi) const {
+    PlaneView<int> values = { dst, src.width, src.height, dstStride };
+    convolute(src, 0, values, 0, roi);
+}
+
+void Convolution::apply(const ImageView &src, const PlaneView<int16_t> &dst, int dstShift,
+			const Roi *roi) const {
+    convolute(src, 0, dst, dstShift, roi);
+}
+
+void Convolution::apply(const PlaneView<int16_t> &src, int srcShift, const PlaneView<int16_t> &dst,
+			int dstShift, const Roi *roi) const {
+    convolute(src, srcShift, dst, dstShift, roi);
+}
+
+void Convolution::apply(const PlaneView<int16_t> &src, int srcShift, int *dst, int dstStride,
+			const Roi *roi) const {
+    PlaneView<int> values = { dst, src.width, src.height, dstStride };
+    convolute(src, srcShift, values, 0, roi);
+}
+
+template <typename Src, typename Dst>
+void Convolution::convolute(const PlaneView<Src> &src, int srcShift, const PlaneView<Dst> &dst,
+			    int dstShift, const Roi *roi) const {
+    // inner part: every pixel under the kernel is inside of the image
+    // (the first row and column are treated as border)
+    int x0 = radius + 1;
+    int x1 = src.width - radius;
+    int y0 = radius + 1;
+    int y1 = src.height - radius;
+    if(x0 >= x1 || y0 >= y1) {
+	x0 = x1 = y0 = y1 = 0;
+    }
+
+    // the sums are in units of 2^-srcShift, the results in 2^-dstShift
+    Output out;
+    out.up = dstShift > srcShift ? dstShift - srcShift : 0;
+    out.divisor = divisorValue;
+    out.down = srcShift > dstShift ? srcShift - dstShift : 0;
+    long long white = 255LL << srcShift;
+
+    // 32 bit sums if they cannot overflow
+    long long pixelMax = std::numeric_limits<Src>::max();
+    bool wide = absSum * pixelMax > 0x7fffffff;
+    out.narrow = (absSum * pixelMax << out.up) <= 0x7fffffff && divisorValue <= 0x7fffffff
+		 && divisorValue >= -0x7fffffff;
+    if(separable) {
+	long long bound = pixelMax;
+	long long columnSum = 0;
+	long long rowSum = 0;
+	for(int i = 0; i < kSize; i++) {
+	    columnSum += column[i] < 0 ? -column[i] : column[i];
+	    rowSum += row[i] < 0 ? -row[i] : row[i];
+	}
+	bound *= columnSum * rowSum;
+	wide = bound > 0x7fffffff;
+    }
+
+    // columns of the inner part per row: from the first to the last pixel
+    // of the region (gaps of a polygon are calculated too)
+    Roi whole;
+    if(roi == 0) {
+	whole.prepare(src.width, src.height);
+	roi = &whole;
+    }
+    std::vector<int> left(src.height, x0);
+    std::vector<int> right(src.height, x0);
+    for(int y = y0; y < y1; y++) {
+	int count;
+	const RoiSpan *span = roi->row(y, &count);
+	if(count > 0) {
+	    left[y] = span[0].left > x0 ? span[0].left : x0;
+	    right[y] = span[count-1].right < x1 ? span[count-1].right : x1;
+	    right[y] = right[y] > left[y] ? right[y] : left[y];
+	}
+    }
+
+    // every band calculates its rows of the region (separable kernels
+    // recalculate the horizontal pass of the rows around the band)
+    int top = roi->top();
+    ThreadPool::instance()->parallelBands(roi->bottom() - top, [&](int begin, int end, int) {
+	begin += top;
+	end += top;
+
+	// border with checks
+	for(int y = begin; y < end; y++) {
+	    Dst *dstRow = dst.row(y);
+	    int count;
+	    const RoiSpan *span = roi->row(y, &count);
+	    for(int i = 0; i < count; i++) {
+		for(int x = span[i].left; x < span[i].right; x++) {
+		    if(x >= left[y] && x < right[y]) {
+			x = right[y] - 1;
+			continue;
+		    }
+		    dstRow[x] = store<Dst>(borderPixel(src, y, x, white), out);
+		}
+	    }
+	}
+
+	// inner part without checks
+	int bandY0 = begin > y0 ? begin : y0;
+	int bandY1 = end < y1 ? end : y1;
+	if(x0 == x1 || bandY0 >= bandY1) {
+	    return;
+	}
+	if(innerStencil(src, dst, out, &left[0], &right[0], bandY0, bandY1)) {
+	    return;
+	} else if(separable && !wide) {
+	    innerSeparable<Src, int>(src, dst, out, &left[0], &right[0], x0, x1, bandY0, bandY1);
+	} else if(separable) {
+	    innerSeparable<Src, long long>(src, dst, out, &left[0], &right[0], x0, x1, bandY0, bandY1);
+	} else if(!wide) {
+	    innerDirect<Src, int>(src, dst, out, &left[0], &right[0], bandY0, bandY1);
+	} else {
+	    innerDirect<Src, long long>(src, dst, out, &left[0], &right[0], bandY0, bandY1);
+	}
+    });
+}
@@ -0,0 +1,266 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include <vector>
+#include "imageplane.h"
+#include "kernels.h"
+#include "roi.h"
+
+/**
+  * convolution of an 8 bit or a 16 bit fixed point image with a square
+  * integer kernel
+  *
+  * the kernel is prepared once: the rotated kernel is added (rotating
+  * kernels), zero coefficients are dropped and separable (rank 1) kernels
+  * are split into a column and a row vector, so they are applied as two
+  * 1-D passes (2k instead of k*k multiplications per pixel)
+  *
+  * the inner part of the image is calculated without any border checks
+  * (vectorized, see Simd), only the pixels near the border use the generic
+  * loop (pixels outside of the image are white)
+  * with a region of interest only the pixels of the region are calculated
+  *
+  * a fixed point image stores value * 2^shift (e.g. the result of a
+  * convolution which is the source of the next one without rescaling it to
+  * 8 bit), the result can be written as int or again as fixed point
+  *
+  * a built-in kernel (Kernels::Builtin) calculates the inner part of an
+  * 8 bit image with its stencil (unrolled, see StencilRows) instead of the
+  * generic loops, other kernels and fixed point sources use the generic
+  * loops, the results are the same (the stencil uses vectors only if
+  * Simd::active is not Simd::Scalar)
+  */
+class Convolution
+{
+private:
+    /**
+      * one coefficient of the kernel which is not zero
+      */
+    struct Tap {
+        int row; ///< row in the kernel
+        int col; ///< column in the kernel
+        int value; ///< coefficient
+    };
+
+    /**
+      * conversion of a sum into a result: (sum * 2^up) / divisor / 2^down
+      * (every step cut towards zero like one division)
+      */
+    struct Output {
+        int up; ///< shift of the sum to the left
+        long long divisor; ///< divisor of the shifted sum (0 -> no division)
+        int down; ///< shift of the quotient to the right
+        bool narrow; ///< true -> the shifted sum and the divisor fit in 32 bit
+    };
+
+    int kSize; ///< x and y size of the kernel
+    int radius; ///< pixels left (and right) of the center
+    bool rotating; ///< convolute with the kernel and with the rotated kernel
+    std::vector<int> original; ///< kernel as given (size: kSize x kSize)
+    std::vector<int> combined; ///< kernel plus rotated kernel (if rotating)
+    std::vector<Tap> taps; ///< coefficients of combined which are not zero
+    std::vector<int16_t> tapValues; ///< values of taps in 16 bit (if shortTaps)
+    bool shortTaps; ///< true -> all taps fit in 16 bit (vectorized multiply-add)
+    long long divisorValue; ///< divide the sum by this value (0 -> no division)
+    long long absSum; ///< sum of the absolute coefficients (twice for rotating kernels)
+
+    bool separable; ///< true -> combined = column * row / pivot
+    std::vector<int> column; ///< column vector of a separable kernel
+    std::vector<int> row; ///< row vector of a separable kernel
+    int pivot; ///< divisor of the product of column and row
+    std::vector<int> rowOffsets; ///< positions in row which are not zero
+    std::vector<int16_t> rowValues; ///< values of row at rowOffsets in 16 bit
+    bool shortRow; ///< true -> row fits in 16 bit (vectorized multiply-add)
+
+    /// unrolled rows of a built-in kernel (0 -> generic loops)
+    void (*stencilShort)(const uint8_t *const *rows, int16_t *dst, int n, int up, bool vectors);
+    void (*stencilInt)(const uint8_t *const *rows, int *dst, int n, bool vectors);
+    int (*stencilBorder)(const uint8_t *data, int stride, int width, int height, int y, int x,
+                         int white);
+
+    /**
+      * prepare a kernel (see constructor)
+      */
+    void prepare(int **kernel, int size, bool rotate);
+
+    /**
+      * check if the combined kernel has rank 1 and split it
+      */
+    void split();
+
+    /**
+      * use the stencil of a built-in kernel for the inner part
+      */
+    template <Kernels::Builtin B>
+    void useStencil() {
+        typedef Kernels::Traits<B> Traits;
+        typedef StencilRows<StencilKernel<typename Traits::Stencil, Traits::rotating> > Rows;
+        stencilShort = &Rows::run;
+        stencilInt = &Rows::run;
+        stencilBorder = &Rows::border;
+    }
+
+    /**
+      * calculate one pixel with border checks (pixels outside have the
+      * value white)
+      */
+    template <typename Src>
+    long long borderPixel(const PlaneView<Src> &src, int y, int x, long long white) const;
+    long long borderPixel(const ImageView &src, int y, int x, long long white) const;
+
+    /**
+      * convert a sum into a result
+      */
+    template <typename Dst, typename Acc>
+    static Dst store(Acc sum, const Output &out) {
+        if(out.narrow) {
+            Acc shifted = sum * ((Acc) 1 << out.up);
+            return (Dst) shiftDown(out.divisor == 0 ? shifted : shifted / (Acc) out.divisor, out.down);
+        }
+        long long shifted = (long long) sum * (1LL << out.up);
+        return (Dst) shiftDown(out.divisor == 0 ? shifted : shifted / out.divisor, out.down);
+    }
+
+    /**
+      * divide by 2^shift, cut towards zero without a branch (negative
+      * values get 2^shift - 1 before the arithmetic shift)
+      */
+    template <typename Acc>
+    static Acc shiftDown(Acc value, int shift) {
+        Acc bias = (value >> (sizeof(Acc) * 8 - 1)) & (((Acc) 1 << shift) - 1);
+        return (value + bias) >> shift;
+    }
+
+    /**
+      * calculate the inner part with the 2-D kernel, the columns
+      * [left[y], right[y]) of the rows [y0, y1)
+      */
+    template <typename Src, typename Acc, typename Dst>
+    void innerDirect(const PlaneView<Src> &src, const PlaneView<Dst> &dst, const Output &out,
+                     const int *left, const int *right, int y0, int y1) const;
+
+    /**
+      * calculate the inner part with two 1-D passes, the columns
+      * [left[y], right[y]) of the rows [y0, y1), all within [x0, x1)
+      */
+    template <typename Src, typename Acc, typename Dst>
+    void innerSeparable(const PlaneView<Src> &src, const PlaneView<Dst> &dst, const Output &out,
+                        const int *left, const int *right, int x0, int x1, int y0, int y1) const;
+
+    /**
+      * calculate the inner part with the stencil of a built-in kernel, the
+      * columns [left[y], right[y]) of the rows [y0, y1)
+      *
+      * @return  true -> calculated (false -> no stencil for this source,
+      *          result or output, use the generic loops)
+      */
+    bool innerStencil(const ImageView &src, const PlaneView<int16_t> &dst, const Output &out,
+                      const int *left, const int *right, int y0, int y1) const;
+    bool innerStencil(const ImageView &src, const PlaneView<int> &dst, const Output &out,
+                      const int *left, const int *right, int y0, int y1) const;
+    template <typename Src, typename Dst>
+    bool innerStencil(const PlaneView<Src> &, const PlaneView<Dst> &, const Output &,
+                      const int *, const int *, int, int) const {
+        return false;
+    }
+
+    /**
+      * convolute an image of any pixel type into a result of any type
+      *
+      * @param src image to convolute
+      * @param srcShift fraction bits of src
+      * @param dst result
+      * @param dstShift fraction bits of dst
+      * @param roi region to calculate (0 -> whole image)
+      */
+    template <typename Src, typename Dst>
+    void convolute(const PlaneView<Src> &src, int srcShift, const PlaneView<Dst> &dst,
+                   int dstShift, const Roi *roi) const;
+
+public:
+    /**
+      * prepare a kernel
+      *
+      * @param kernel kernel (size: [size][size])
+      * @param size x and y size of the kernel (odd)
+      * @param rotate convolute with the kernel and with the rotated kernel
+      */
+    Convolution(int **kernel, int size, bool rotate);
+
+    /**
+      * prepare a built-in kernel (applied with its stencil)
+      *
+      * @param builtin built-in kernel
+      */
+    explicit Convolution(Kernels::Builtin builtin);
+
+    /**
+      * convolute the image, every result is divided by the sum of the kernel
+      * (twice the sum for rotating kernels, no division if the sum is zero)
+      *
+      * @param src image to convolute
+      * @param dst result (size: src.width x src.height, values outside of
+      *            the region are undefined)
+      * @param dstStride distance between two rows of dst in values
+      * @param roi region to calculate (prepared for the size of src, 0 ->
+      *            whole image)
+      */
+    void apply(const ImageView &src, int *dst, int dstStride, const Roi *roi = 0) const;
+
+    /**
+      * convolute the image into a 16 bit fixed point result (the result
+      * must fit, see bound)
+      *
+      * @param src image to convolute
+      * @param dst result (size of src, values outside of the region are
+      *            undefined)
+      * @param dstShift fraction bits of dst
+      * @param roi region to calculate (prepared for the size of src, 0 ->
+      *            whole image)
+      */
+    void apply(const ImageView &src, const PlaneView<int16_t> &dst, int dstShift,
+               const Roi *roi = 0) const;
+
+    /**
+      * convolute a 16 bit fixed point image (pixels outside of the image
+      * are white, 255) into a 16 bit fixed point result
+      *
+      * @param src image to convolute
+      * @param srcShift fraction bits of src
+      * @param dst result (size of src, another plane than src, values
+      *            outside of the region are undefined)
+      * @param dstShift fraction bits of dst
+      * @param roi region to calculate (prepared for the size of src, 0 ->
+      *            whole image)
+      */
+    void apply(const PlaneView<int16_t> &src, int srcShift, const PlaneView<int16_t> &dst,
+               int dstShift, const Roi *roi = 0) const;
+
+    /**
+      * convolute a 16 bit fixed point image into int values
+      *
+      * @param src image to convolute
+      * @param srcShift fraction bits of src
+      * @param dst result (size: src.width x src.height, values outside of
+      *            the region are undefined)
+      * @param dstStride distance between two rows of dst in values
+      * @param roi region to calculate (prepared for the size of src, 0 ->
+      *            whole image)
+      */
+    void apply(const PlaneView<int16_t> &src, int srcShift, int *dst, int dstStride,
+               const Roi *roi = 0) const;
+
+    /**
+      * get the maximal absolute result
+      *
+      * @param pixelBound maximal absolute value of a pixel (at least 255,
+      *                   the value of the border)
+      * @return  maximal absolute result
+      */
+    long long bound(long long pixelBound) const;
+
+    bool isSeparable() const { return separable; } ///< true if applied in two 1-D passes
+    bool hasStencil() const { return stencilShort != 0; } ///< true if applied with a stencil
+};
+
+#endif // CONVOLUTION_H
@@ -11,10 +11,10 @@ TEMPLATE = app
 
 
 SOURCES += main.cpp\
-	mainwindow.cpp \
-    pgmimage.cpp
+	mainwindow.cpp
 
-HEADERS  += mainwindow.h \
-    pgmimage.h
+HEADERS  += mainwindow.h
 
 FORMS    += mainwindow.ui
+
+include(cvcore.pri)
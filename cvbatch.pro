@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Batch processing of pgm images without GUI
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = cvbatch
+TEMPLATE = app
+CONFIG   += console
+CONFIG   -= app_bundle
+
+# PgmImage without QImage, own objects and Makefile (cv is built with GUI)
+DEFINES += CV_NO_GUI
+OBJECTS_DIR = batch-obj
+MOC_DIR = batch-obj
+MAKEFILE = Makefile.batch
+
+SOURCES += batchmain.cpp
+
+include(cvcore.pri)
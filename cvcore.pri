@@ -0,0 +1,55 @@
+#-------------------------------------------------
+#
+# Image processing without GUI (used by cv and cvbatch)
+#
+#-------------------------------------------------
+
+SOURCES += pgmimage.cpp \
+    imageplane.cpp \
+    pgmformat.cpp \
+    convolution.cpp \
+    simd.cpp \
+    threadpool.cpp \
+    gradient.cpp \
+    compass.cpp \
+    canny.cpp \
+    smoothing.cpp \
+    histogram.cpp \
+    scratcharena.cpp \
+    hough.cpp \
+    raster.cpp \
+    floodfill.cpp \
+    kernels.cpp \
+    roi.cpp \
+    lanetracker.cpp \
+    pgmstream.cpp \
+    lanepipeline.cpp
+
+HEADERS += pgmimage.h \
+    imageplane.h \
+    alignedblock.h \
+    pgmformat.h \
+    convolution.h \
+    simd.h \
+    threadpool.h \
+    gradient.h \
+    compass.h \
+    canny.h \
+    smoothing.h \
+    histogram.h \
+    pointops.h \
+    stencil.h \
+    scratcharena.h \
+    hough.h \
+    raster.h \
+    floodfill.h \
+    kernels.h \
+    roi.h \
+    lanetracker.h \
+    pgmstream.h \
+    boundedqueue.h \
+    lanepipeline.h
+
+# std::thread for the thread pool and the lane pipeline
+QMAKE_CXXFLAGS += -std=c++11
+unix:LIBS += -pthread
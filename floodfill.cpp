@@ -0,0 +1,109 @@
+#include "floodfill.h"
+
+void FloodFill::pushRuns(const uint8_t *row, const uint8_t *barrier, int y, int left, int right,
+			 uint8_t oldValue) {
+    bool inRun = false;
+    for(int x = left; x <= right; x++) {
+	if(!fillable(row, barrier, x, oldValue)) {
+	    inRun = false;
+	} else if(!inRun) {
+	    Seed seed = { x, y };
+	    stack.push_back(seed);
+	    inRun = true;
+	}
+    }
+}
+
+void FloodFill::pushRuns(const uint8_t *row, const uint8_t *barrier, int y, int left, int right,
+			 uint8_t oldValue, const Roi *roi) {
+    if(roi == 0) {
+	pushRuns(row, barrier, y, left, right, oldValue);
+	return;
+    }
+    int count;
+    const RoiSpan *span = roi->row(y, &count);
+    for(int i = 0; i < count; i++) {
+	int from = span[i].left > left ? span[i].left : left;
+	int to = span[i].right-1 < right ? span[i].right-1 : right;
+	if(from <= to) {
+	    pushRuns(row, barrier, y, from, to, oldValue);
+	}
+    }
+}
+
+int FloodFill::fill(const ImageView &img, int x, int y, uint8_t oldValue, uint8_t newValue,
+		    Connectivity connectivity, FillResult *result, const Roi *roi,
+		    const ImageView *barrier) {
+    if(x < 0 || x >= img.width || y < 0 || y >= img.height || oldValue == newValue
+	|| (roi != 0 && !roi->contains(x, y))) {
+	return -1;
+    }
+    if(!fillable(img.row(y), barrier != 0 ? barrier->row(y) : 0, x, oldValue)) {
+	return 1;
+    }
+
+    FillResult filled = { 0, x, y, x, y };
+    int diagonal = connectivity == Eight ? 1 : 0;
+    stack.clear();
+    Seed start = { x, y };
+    stack.push_back(start);
+
+    while(!stack.empty()) {
+	Seed seed = stack.back();
+	stack.pop_back();
+	uint8_t *row = img.row(seed.y);
+	const uint8_t *barrierRow = barrier != 0 ? barrier->row(seed.y) : 0;
+	if(!fillable(row, barrierRow, seed.x, oldValue)) {
+	    // filled by another run
+	    continue;
+	}
+
+	// whole run of the seed (within the span of the region)
+	int first = 0;
+	int last = img.width-1;
+	if(roi != 0) {
+	    int count;
+	    const RoiSpan *span = roi->row(seed.y, &count);
+	    for(int i = 0; i < count; i++) {
+		if(seed.x >= span[i].left && seed.x < span[i].right) {
+		    first = span[i].left;
+		    last = span[i].right-1;
+		}
+	    }
+	}
+	int left = seed.x;
+	while(left > first && fillable(row, barrierRow, left-1, oldValue)) {
+	    left--;
+	}
+	int right = seed.x;
+	while(right < last && fillable(row, barrierRow, right+1, oldValue)) {
+	    right++;
+	}
+	for(int i = left; i <= right; i++) {
+	    row[i] = newValue;
+	}
+
+	filled.area += right - left + 1;
+	filled.left = left < filled.left ? left : filled.left;
+	filled.right = right > filled.right ? right : filled.right;
+	filled.top = seed.y < filled.top ? seed.y : filled.top;
+	filled.bottom = seed.y > filled.bottom ? seed.y : filled.bottom;
+
+	// runs above and below (one pixel more on each side with diagonals)
+	int scanLeft = left - diagonal > 0 ? left - diagonal : 0;
+	int scanRight = right + diagonal < img.width-1 ? right + diagonal : img.width-1;
+	if(seed.y > 0) {
+	    pushRuns(img.row(seed.y-1), barrier != 0 ? barrier->row(seed.y-1) : 0, seed.y-1,
+		     scanLeft, scanRight, oldValue, roi);
+	}
+	if(seed.y < img.height-1) {
+	    pushRuns(img.row(seed.y+1), barrier != 0 ? barrier->row(seed.y+1) : 0, seed.y+1,
+		     scanLeft, scanRight, oldValue, roi);
+	}
+    }
+
+    if(result != 0) {
+	*result = filled;
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef FLOODFILL_H
+#define FLOODFILL_H
+
+#include <vector>
+#include "imageplane.h"
+#include "roi.h"
+
+/**
+  * result of a flood fill
+  */
+struct FillResult {
+    long area; ///< number of filled pixels
+    int left; ///< bounding box: first column
+    int top; ///< bounding box: first row
+    int right; ///< bounding box: last column
+    int bottom; ///< bounding box: last row
+};
+
+/**
+  * scanline flood fill without recursion
+  *
+  * a region is filled run by run (a run is a part of a row), the runs
+  * next to it in the row above and below are put on an explicit stack
+  * the stack is kept between two fills, so it is only allocated once
+  */
+class FloodFill
+{
+private:
+    /**
+      * pixel which starts a run
+      */
+    struct Seed {
+        int x; ///< column
+        int y; ///< row
+    };
+
+    std::vector<Seed> stack; ///< runs which are not filled yet
+
+    /**
+      * check if a pixel belongs to the region (oldValue and no barrier)
+      */
+    static bool fillable(const uint8_t *row, const uint8_t *barrier, int x, uint8_t oldValue) {
+        return row[x] == oldValue && (barrier == 0 || barrier[x] == 0);
+    }
+
+    /**
+      * put one seed per run of fillable pixels of a row on the stack
+      */
+    void pushRuns(const uint8_t *row, const uint8_t *barrier, int y, int left, int right,
+                  uint8_t oldValue);
+
+    /**
+      * put the runs of the columns [left, right] of a row on the stack,
+      * only the parts inside of the region
+      */
+    void pushRuns(const uint8_t *row, const uint8_t *barrier, int y, int left, int right,
+                  uint8_t oldValue, const Roi *roi);
+
+public:
+    /**
+      * neighbours of a pixel
+      */
+    enum Connectivity {
+        Four = 4, ///< left, right, above and below
+        Eight = 8 ///< also the diagonal neighbours
+    };
+
+    /**
+      * fill the region of pixels with oldValue which contains the seed
+      *
+      * @param img image to fill
+      * @param x column of the seed
+      * @param y row of the seed
+      * @param oldValue gray value of the region
+      * @param newValue new gray value of the region
+      * @param connectivity neighbours of a pixel
+      * @param result filled area and bounding box (may be 0)
+      * @param roi the fill stays inside of this region (prepared for the
+      *            image, 0 -> whole image)
+      * @param barrier pixels which are not zero in this view are not filled
+      *                (e.g. drawn lines, size: as img, 0 -> no barrier)
+      * @return  0 -> region filled
+      *          1 -> seed has another value or is a barrier (nothing filled)
+      *         -1 -> seed outside of the image (or region) or oldValue == newValue
+      */
+    int fill(const ImageView &img, int x, int y, uint8_t oldValue, uint8_t newValue,
+             Connectivity connectivity, FillResult *result, const Roi *roi = 0,
+             const ImageView *barrier = 0);
+};
+
+#endif // FLOODFILL_H
@@ -0,0 +1,94 @@
+#include "gradient.h"
+#include "threadpool.h"
+#include <math.h>
+
+Gradient::Gradient() {
+    planeWidth = 0;
+    planeHeight = 0;
+}
+
+void Gradient::compute(const ImageView &src, const Roi *roi) {
+    Roi whole;
+    if(roi == 0) {
+	whole.prepare(src.width, src.height);
+	roi = &whole;
+    }
+
+    // atan of the first octant (only once)
+    if(octant.empty()) {
+	octant.resize(octantSteps + 1);
+	for(int i = 0; i <= octantSteps; i++) {
+	    octant[i] = (int16_t) floor(atan((double) i / octantSteps) * 180 / M_PI + 0.5);
+	}
+    }
+    magnitudes.resize((size_t) src.width * src.height);
+    orientations.resize((size_t) src.width * src.height);
+    planeWidth = src.width;
+    planeHeight = src.height;
+
+    int top = roi->top();
+    ThreadPool::instance()->parallelBands(roi->bottom() - top, [&](int begin, int end, int) {
+	std::vector<int> rowX(planeWidth);
+	std::vector<int> rowY(planeWidth);
+	for(int y = begin+top; y < end+top; y++) {
+	    int16_t *magnitude = &magnitudes[(size_t) y * planeWidth];
+	    int16_t *orientation = &orientations[(size_t) y * planeWidth];
+	    int count;
+	    const RoiSpan *span = roi->row(y, &count);
+	    for(int s = 0; s < count; s++) {
+		// pixels of the first and the last row and column have no
+		// gradient
+		int left = span[s].left;
+		int right = span[s].right;
+		int first = left > 1 ? left : 1;
+		int last = right < planeWidth-1 ? right : planeWidth-1;
+		if(y == 0 || y == planeHeight-1 || first > last) {
+		    first = left;
+		    last = left;
+		}
+		for(int x = left; x < first; x++) {
+		    magnitude[x] = 0;
+		    orientation[x] = -1;
+		}
+		for(int x = last; x < right; x++) {
+		    magnitude[x] = 0;
+		    orientation[x] = -1;
+		}
+
+		// both Sobel components
+		const uint8_t *above = src.row(y-1);
+		const uint8_t *center = src.row(y);
+		const uint8_t *below = src.row(y+1);
+		int *gx = &rowX[0];
+		int *gy = &rowY[0];
+		for(int x = first; x < last; x++) {
+		    gx[x] = (above[x+1] + 2*center[x+1] + below[x+1]) - (above[x-1] + 2*center[x-1] + below[x-1]);
+		    gy[x] = (below[x-1] + 2*below[x] + below[x+1]) - (above[x-1] + 2*above[x] + above[x+1]);
+		}
+
+		for(int x = first; x < last; x++) {
+		    if(gx[x] == 0 && gy[x] == 0) {
+			magnitude[x] = 0;
+			orientation[x] = -1;
+			continue;
+		    }
+		    magnitude[x] = (int16_t) (sqrtf((float) (gx[x]*gx[x] + gy[x]*gy[x])) + 0.5f);
+
+		    // angle of the octant, mirrored into the quadrant and
+		    // the quadrant of the signs
+		    int ax = gx[x] < 0 ? -gx[x] : gx[x];
+		    int ay = gy[x] < 0 ? -gy[x] : gy[x];
+		    int angle = ay <= ax ? octant[(int) ((float) ay * octantSteps / ax)]
+					 : 90 - octant[(int) ((float) ax * octantSteps / ay)];
+		    if(gx[x] < 0) {
+			angle = 180 - angle;
+		    }
+		    if(gy[x] < 0) {
+			angle = (360 - angle) % 360;
+		    }
+		    orientation[x] = (int16_t) angle;
+		}
+	    }
+	}
+    });
+}
@@ -0,0 +1,64 @@
+#ifndef GRADIENT_H
+#define GRADIENT_H
+
+#include <vector>
+#include "imageplane.h"
+#include "roi.h"
+
+/**
+  * gradient of an 8 bit image with the Sobel operator
+  *
+  * both Sobel components are calculated in one pass and kept as magnitude
+  * (sqrt(gx^2 + gy^2)) and orientation (atan2(gy, gx) in degree, the
+  * normal of the edge in the angles of HoughTransform) of every pixel
+  * the orientation is taken from a table of one octant, so no pixel needs
+  * atan2
+  * the pixels of the first and the last row and column have no gradient
+  */
+class Gradient
+{
+private:
+    int planeWidth; ///< width of the planes
+    int planeHeight; ///< height of the planes
+    std::vector<int16_t> magnitudes; ///< magnitude of every pixel (0 .. 1443)
+    std::vector<int16_t> orientations; ///< orientation of every pixel (0 .. 359, -1 -> no gradient)
+    std::vector<int16_t> octant; ///< atan(i / octantSteps) in degree (0 .. 45)
+
+    static const int octantSteps = 1024; ///< entries of the octant table - 1
+
+public:
+    Gradient();
+
+    /**
+      * calculate magnitude and orientation of the pixels of an image, the
+      * rows are calculated in parallel bands
+      *
+      * @param src image
+      * @param roi only the pixels of this region (prepared for the size of
+      *            src, 0 -> whole image), the values of the other pixels
+      *            are undefined
+      */
+    void compute(const ImageView &src, const Roi *roi = 0);
+
+    int width() const { return planeWidth; } ///< width of the planes
+    int height() const { return planeHeight; } ///< height of the planes
+
+    /**
+      * get the magnitudes of a row
+      *
+      * @param y row of the image
+      * @return  magnitude of the pixels of the row (0 -> no gradient)
+      */
+    const int16_t *magnitudeRow(int y) const { return &magnitudes[(size_t) y * planeWidth]; }
+
+    /**
+      * get the orientations of a row
+      *
+      * @param y row of the image
+      * @return  orientation of the pixels of the row in degree (0 .. 359,
+      *          -1 -> no gradient)
+      */
+    const int16_t *orientationRow(int y) const { return &orientations[(size_t) y * planeWidth]; }
+};
+
+#endif // GRADIENT_H
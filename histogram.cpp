@@ -0,0 +1,116 @@
+#include "histogram.h"
+#include "threadpool.h"
+#include <vector>
+
+Histogram::Histogram() {
+    for(int i = 0; i < 256; i++) {
+	bins[i] = 0;
+	cumulative[i] = 0;
+    }
+    total = 0;
+}
+
+void Histogram::compute(const ImageView &src, const Roi *roi) {
+    Roi whole;
+    if(roi == 0) {
+	whole.prepare(src.width, src.height);
+	roi = &whole;
+    }
+
+    // count the pixels of the region, every band in its own sub-histograms
+    int top = roi->top();
+    ThreadPool *pool = ThreadPool::instance();
+    int bands = pool->bandCount(roi->bottom() - top);
+    std::vector<int> sub(bands * subCount * 256, 0);
+    pool->parallelBands(roi->bottom() - top, [&](int begin, int end, int band) {
+	int *data = &sub[band * subCount * 256];
+	for(int y = begin+top; y < end+top; y++) {
+	    const uint8_t *row = src.row(y);
+	    int count;
+	    const RoiSpan *span = roi->row(y, &count);
+	    for(int s = 0; s < count; s++) {
+		countRow(row, span[s].left, span[s].right, data);
+	    }
+	}
+    });
+
+    setCounts(&sub[0], bands * subCount);
+}
+
+void Histogram::setCounts(const int *sub, int count) {
+    total = 0;
+    for(int i = 0; i < 256; i++) {
+	bins[i] = 0;
+	for(int s = 0; s < count; s++) {
+	    bins[i] += sub[s * 256 + i];
+	}
+	total += bins[i];
+	cumulative[i] = total;
+    }
+}
+
+int Histogram::maxCount() const {
+    return bins[mode()];
+}
+
+int Histogram::mode() const {
+    int best = 0;
+    for(int i = 1; i < 256; i++) {
+	if(bins[i] > bins[best]) {
+	    best = i;
+	}
+    }
+    return best;
+}
+
+int Histogram::otsu(int low, int high) const {
+    // weighted sum and pixels of the range
+    double sum = 0;
+    for(int i = low; i <= high; i++) {
+	sum += (double) i * bins[i];
+    }
+    int below = low > 0 ? cumulative[low-1] : 0;
+    int pixels = cumulative[high] - below;
+
+    // every threshold with pixels in both classes
+    double darkSum = 0;
+    double best = -1;
+    int threshold = low;
+    for(int t = low; t < high; t++) {
+	darkSum += (double) t * bins[t];
+	int dark = cumulative[t] - below;
+	int bright = pixels - dark;
+	if(dark == 0) {
+	    continue;
+	}
+	if(bright == 0) {
+	    break;
+	}
+	double difference = darkSum / dark - (sum - darkSum) / bright;
+	double between = (double) dark * bright * difference * difference;
+	if(between > best) {
+	    best = between;
+	    threshold = t;
+	}
+    }
+    return threshold;
+}
+
+void Histogram::equalization(uint8_t *table) const {
+    // pixels below the lowest gray value of the image
+    int first = 0;
+    while(first < 255 && bins[first] == 0) {
+	first++;
+    }
+    long long low = cumulative[first];
+    long long range = total - low;
+    for(int i = 0; i < 256; i++) {
+	if(range <= 0) {
+	    table[i] = (uint8_t) i;
+	} else if(i < first) {
+	    table[i] = 0;
+	} else {
+	    table[i] = (uint8_t) (((cumulative[i] - low) * 255 + range / 2) / range);
+	}
+    }
+}
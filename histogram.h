@@ -0,0 +1,108 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "imageplane.h"
+#include "roi.h"
+
+/**
+  * histogram of an 8 bit image with its cumulative distribution
+  *
+  * the rows are counted in parallel bands, every band counts into
+  * subCount own sub-histograms (pixel x into sub-histogram x % subCount),
+  * so the increments of equal neighbours do not wait for each other (store
+  * to load forwarding), the sub-histograms are added up at the end
+  * an operation which writes the pixels anyway can count them with countRow
+  * and set the result with setCounts (no extra pass over the image)
+  */
+class Histogram
+{
+private:
+    int bins[256]; ///< pixels of every gray value
+    int cumulative[256]; ///< pixels with this gray value or a lower one
+    int total; ///< pixels of the histogram
+
+public:
+    static const int subCount = 4; ///< sub-histograms of countRow
+
+    Histogram();
+
+    /**
+      * count the pixels of an image, the rows are counted in parallel bands
+      *
+      * @param src image
+      * @param roi only the pixels of this region (prepared for the size of
+      *            src, 0 -> whole image)
+      */
+    void compute(const ImageView &src, const Roi *roi = 0);
+
+    /**
+      * count the pixels of a part of a row into sub-histograms
+      *
+      * @param row first pixel of the row
+      * @param left first pixel to count
+      * @param right pixel after the last one
+      * @param sub subCount sub-histograms (size: subCount x 256)
+      */
+    static void countRow(const uint8_t *row, int left, int right, int *sub) {
+        int x = left;
+        for(; x + 4 <= right; x += 4) {
+            sub[row[x]]++;
+            sub[256 + row[x+1]]++;
+            sub[512 + row[x+2]]++;
+            sub[768 + row[x+3]]++;
+        }
+        for(; x < right; x++) {
+            sub[row[x]]++;
+        }
+    }
+
+    /**
+      * add up sub-histograms and calculate the cumulative distribution
+      *
+      * @param sub sub-histograms (size: count x 256)
+      * @param count number of sub-histograms
+      */
+    void setCounts(const int *sub, int count);
+
+    int count(int value) const { return bins[value]; } ///< pixels of a gray value
+    int cumulativeCount(int value) const { return cumulative[value]; } ///< pixels of a gray value or a lower one
+    int pixels() const { return total; } ///< pixels of the histogram
+
+    /**
+      * get the highest count of a gray value
+      *
+      * @return  pixels of the most frequent gray value
+      */
+    int maxCount() const;
+
+    /**
+      * get the most frequent gray value (the lowest one if several have the
+      * same count)
+      *
+      * @return  gray value (0 for an empty histogram)
+      */
+    int mode() const;
+
+    /**
+      * get the threshold of Otsu, it splits the pixels into a dark and a
+      * bright class with the highest variance between the classes
+      * with a range only the gray values of the range are split (e.g. the
+      * bright class again for three classes)
+      *
+      * @param low lowest gray value of the range
+      * @param high highest gray value of the range
+      * @return  highest gray value of the dark class (low for an empty
+      *          range or a single gray value)
+      */
+    int otsu(int low = 0, int high = 255) const;
+
+    /**
+      * calculate the table of the histogram equalization, the cumulative
+      * distribution is stretched to 0 .. 255
+      *
+      * @param table new gray value of every gray value (size: 256)
+      */
+    void equalization(uint8_t *table) const;
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,638 @@
+#include "hough.h"
+#include "threadpool.h"
+#include <math.h>
+#include <queue>
+#include <random>
+#include <algorithm>
+
+HoughParameters::HoughParameters() {
+    thetaFirst = 0;
+    thetaStep = 1;
+    thetaCount = 360;
+    rhoStep = 1;
+    signedRho = false;
+    rhoFirst = 0;
+    rhoCount = 0;
+    grayThreshold = 20;
+    minVotes = 33;
+    interval = 15;
+    maxLines = 0;
+    minLength = 30;
+    maxGap = 3;
+    minMagnitude = 100;
+    thetaWindow = 8;
+    roi = 0;
+}
+
+HoughTransform::HoughTransform() {
+    thetaFirst = 0;
+    thetaStep = 0;
+    thetas = 0;
+    rhoStep = 0;
+    rhos = 0;
+    rhoOffset = 0;
+    mirrorRho = false;
+}
+
+int HoughTransform::prepare(int width, int height, const HoughParameters &params) {
+    if(params.thetaCount <= 0 || params.thetaStep <= 0 || params.rhoStep <= 0
+	|| params.rhoCount < 0) {
+	return -1;
+    }
+
+    // fixed point tables (only for new angles)
+    if(params.thetaFirst != thetaFirst || params.thetaStep != thetaStep
+	|| params.thetaCount != thetas || params.rhoStep != rhoStep) {
+	thetaFirst = params.thetaFirst;
+	thetaStep = params.thetaStep;
+	thetas = params.thetaCount;
+	rhoStep = params.rhoStep;
+	cosTable.resize(thetas);
+	sinTable.resize(thetas);
+	for(int t = 0; t < thetas; t++) {
+	    double radian = thetaOf(t) * M_PI / 180;
+	    cosTable[t] = llround(cos(radian) / rhoStep * (1LL << fixedBits));
+	    sinTable[t] = llround(sin(radian) / rhoStep * (1LL << fixedBits));
+	}
+    }
+
+    if(params.rhoCount > 0) {
+	// only the given range (may contain negative rhos)
+	rhoOffset = (int) -floor(params.rhoFirst / rhoStep + 0.5);
+	rhos = params.rhoCount;
+	mirrorRho = false;
+    } else {
+	// longest possible distance (in both directions with signed rhos)
+	int maxRho = sqrt(width*width + height*height) / rhoStep + 1;
+	rhoOffset = params.signedRho ? maxRho - 1 : 0;
+	rhos = maxRho + rhoOffset;
+	mirrorRho = params.signedRho;
+    }
+    akku.assign((size_t) thetas * rhos, 0);
+    return 0;
+}
+
+void HoughTransform::vote(const ImageView &src, int threshold, const Roi *roi) {
+    Roi whole;
+    if(roi == 0) {
+	whole.prepare(src.width, src.height);
+	roi = &whole;
+    }
+
+    // bands of the rows of the region
+    ThreadPool *pool = ThreadPool::instance();
+    int top = roi->top();
+    int height = roi->bottom() - top;
+    int bands = pool->bandCount(height, 64);
+    size_t akkuSize = akku.size();
+    if(bands > 1) {
+	bandAkku.assign((size_t) bands * akkuSize, 0);
+    }
+
+    pool->parallelBands(height, [&](int begin, int end, int band) {
+	int *bAkku = bands > 1 ? &bandAkku[band * akkuSize] : &akku[0];
+	std::vector<long long> rowBase(thetas);
+	const long long half = 1LL << (fixedBits-1);
+
+	for(int y = begin+top > 1 ? begin+top : 1; y < end+top; y++) {
+	    // y * sin(theta) (rounded) is the same for the whole row
+	    for(int t = 0; t < thetas; t++) {
+		rowBase[t] = y * sinTable[t] + half;
+	    }
+
+	    const uint8_t *row = src.row(y);
+	    int count;
+	    const RoiSpan *span = roi->row(y, &count);
+	    for(int i = 0; i < count; i++) {
+		for(int x = span[i].left > 1 ? span[i].left : 1; x < span[i].right; x++) {
+		    if(threshold <= row[x]) {
+			continue;
+		    }
+		    int *counter = bAkku;
+		    for(int t = 0; t < thetas; t++, counter += rhos) {
+			long long r = ((rowBase[t] + x * cosTable[t]) >> fixedBits) + rhoOffset;
+			if(r >= 0 && r < rhos) {
+			    counter[r]++;
+			}
+		    }
+		}
+	    }
+	}
+    }, 64);
+
+    // add the accumulators of the bands
+    if(bands > 1) {
+	addBands(bands);
+    }
+}
+
+void HoughTransform::vote(const EdgePoints &edges) {
+    // bands of the list instead of bands of rows
+    ThreadPool *pool = ThreadPool::instance();
+    int count = (int) edges.size();
+    int bands = pool->bandCount(count, 1024);
+    size_t akkuSize = akku.size();
+    if(bands > 1) {
+	bandAkku.assign((size_t) bands * akkuSize, 0);
+    }
+
+    pool->parallelBands(count, [&](int begin, int end, int band) {
+	int *bAkku = bands > 1 ? &bandAkku[band * akkuSize] : &akku[0];
+	const long long half = 1LL << (fixedBits-1);
+	for(int i = begin; i < end; i++) {
+	    long long x = edges.x[i];
+	    long long y = edges.y[i];
+	    int *counter = bAkku;
+	    for(int t = 0; t < thetas; t++, counter += rhos) {
+		long long r = ((y * sinTable[t] + half + x * cosTable[t]) >> fixedBits) + rhoOffset;
+		if(r >= 0 && r < rhos) {
+		    counter[r]++;
+		}
+	    }
+	}
+    }, 1024);
+
+    // add the accumulators of the bands
+    if(bands > 1) {
+	addBands(bands);
+    }
+}
+
+void HoughTransform::addBands(int bands) {
+    size_t akkuSize = akku.size();
+    ThreadPool::instance()->parallelBands(thetas, [&](int begin, int end, int) {
+	for(size_t i = (size_t) begin * rhos; i < (size_t) end * rhos; i++) {
+	    int sum = 0;
+	    for(int band = 0; band < bands; band++) {
+		sum += bandAkku[band * akkuSize + i];
+	    }
+	    akku[i] += sum;
+	}
+    }, 1);
+}
+
+void HoughTransform::voteOriented(const Gradient &gradient, const HoughParameters &params) {
+    // angles near every orientation (the gradient may point to both sides
+    // of the edge, so the distance is taken modulo 180 degree)
+    orientedStart.assign(361, 0);
+    orientedAngles.clear();
+    for(int o = 0; o < 360; o++) {
+	orientedStart[o] = (int) orientedAngles.size();
+	for(int t = 0; t < thetas; t++) {
+	    double distance = fmod(fabs(thetaOf(t) - o), 180);
+	    distance = distance < 180 - distance ? distance : 180 - distance;
+	    if(distance <= params.thetaWindow + 1e-9 && slopeAllowed(params, thetaOf(t))) {
+		orientedAngles.push_back(t);
+	    }
+	}
+    }
+    orientedStart[360] = (int) orientedAngles.size();
+
+    Roi whole;
+    const Roi *roi = params.roi;
+    if(roi == 0) {
+	whole.prepare(gradient.width(), gradient.height());
+	roi = &whole;
+    }
+
+    // bands of the rows of the region
+    ThreadPool *pool = ThreadPool::instance();
+    int top = roi->top();
+    int height = roi->bottom() - top;
+    int bands = pool->bandCount(height, 64);
+    size_t akkuSize = akku.size();
+    if(bands > 1) {
+	bandAkku.assign((size_t) bands * akkuSize, 0);
+    }
+
+    pool->parallelBands(height, [&](int begin, int end, int band) {
+	int *bAkku = bands > 1 ? &bandAkku[band * akkuSize] : &akku[0];
+	for(int y = begin+top; y < end+top; y++) {
+	    const int16_t *magnitude = gradient.magnitudeRow(y);
+	    const int16_t *orientation = gradient.orientationRow(y);
+	    int count;
+	    const RoiSpan *span = roi->row(y, &count);
+	    for(int i = 0; i < count; i++) {
+		for(int x = span[i].left; x < span[i].right; x++) {
+		    if(magnitude[x] < params.minMagnitude || orientation[x] < 0) {
+			continue;
+		    }
+		    const int *angle = &orientedAngles[orientedStart[orientation[x]]];
+		    const int *last = &orientedAngles[0] + orientedStart[orientation[x] + 1];
+		    for(; angle < last; angle++) {
+			long long r = rhoIndex(x, y, *angle);
+			if(r >= 0 && r < rhos) {
+			    bAkku[(size_t) *angle * rhos + r]++;
+			}
+		    }
+		}
+	    }
+	}
+    }, 64);
+
+    // add the accumulators of the bands
+    if(bands > 1) {
+	addBands(bands);
+    }
+}
+
+void HoughTransform::slidingMax(const long long *src, long long *dst, int n, int radius, int lanes) {
+    int window = 2*radius + 1;
+    int padded = n + 2*radius;
+    prefix.resize((size_t) padded * lanes);
+    suffix.resize((size_t) padded * lanes);
+
+    // maxima from the start of every block of window values to the value
+    for(int p = 0; p < padded; p++) {
+	const long long *value = src + (size_t) p * lanes;
+	long long *cur = &prefix[(size_t) p * lanes];
+	if(p % window == 0) {
+	    std::copy(value, value + lanes, cur);
+	    continue;
+	}
+	const long long *last = cur - lanes;
+	for(int l = 0; l < lanes; l++) {
+	    cur[l] = value[l] > last[l] ? value[l] : last[l];
+	}
+    }
+
+    // maxima from the value to the end of its block
+    for(int p = padded-1; p >= 0; p--) {
+	const long long *value = src + (size_t) p * lanes;
+	long long *cur = &suffix[(size_t) p * lanes];
+	if(p % window == window-1 || p == padded-1) {
+	    std::copy(value, value + lanes, cur);
+	    continue;
+	}
+	const long long *next = cur + lanes;
+	for(int l = 0; l < lanes; l++) {
+	    cur[l] = value[l] > next[l] ? value[l] : next[l];
+	}
+    }
+
+    // every window covers the end of one block and the start of the next
+    for(int i = 0; i < n; i++) {
+	const long long *left = &suffix[(size_t) i * lanes];
+	const long long *right = &prefix[(size_t) (i + 2*radius) * lanes];
+	long long *out = dst + (size_t) i * lanes;
+	for(int l = 0; l < lanes; l++) {
+	    out[l] = left[l] > right[l] ? left[l] : right[l];
+	}
+    }
+}
+
+bool HoughTransform::slopeAllowed(const HoughParameters &params, double theta) {
+    if(params.slopes.empty()) {
+	return true;
+    }
+
+    // y = m * x + b with m = -cos / sin (no slope for vertical lines)
+    double radian = theta * M_PI / 180;
+    if(sin(radian) == 0.0) {
+	return false;
+    }
+    double m = -cos(radian) / sin(radian);
+    for(size_t i = 0; i < params.slopes.size(); i++) {
+	if(m > params.slopes[i].low && m < params.slopes[i].high) {
+	    return true;
+	}
+    }
+    return false;
+}
+
+int HoughTransform::findLines(const HoughParameters &params, std::vector<HoughLine> *lines) {
+    // interval must be odd (and the window must not wrap twice)
+    if(params.interval <= 0 || params.interval % 2 == 0 || params.interval > thetas) {
+	return -1;
+    }
+    int radius = (params.interval-1)/2;
+    lines->clear();
+
+    // maximum along rho (outside of the accumulator: -1, below every key)
+    line.resize(rhos + 2*radius);
+    rowMax.resize((size_t) (thetas + 2*radius) * rhos);
+    for(int t = 0; t < thetas; t++) {
+	for(int p = 0; p < rhos + 2*radius; p++) {
+	    int r = p - radius;
+	    line[p] = r >= 0 && r < rhos ? key((size_t) t * rhos + r) : -1;
+	}
+	slidingMax(&line[0], &rowMax[(size_t) (t + radius) * rhos], rhos, radius, 1);
+    }
+
+    // angles before the first and after the last one
+    double range = thetas * thetaStep;
+    bool fullCircle = fabs(range - 360) < 1e-9;
+    bool halfCircle = fabs(range - 180) < 1e-9 && mirrorRho;
+    for(int i = -radius; i < thetas + radius; i++) {
+	if(i == 0) {
+	    i = thetas - 1;
+	    continue;
+	}
+	long long *row = &rowMax[(size_t) (i + radius) * rhos];
+	int wrapped = (i + thetas) % thetas;
+	const long long *source = &rowMax[(size_t) (wrapped + radius) * rhos];
+	for(int r = 0; r < rhos; r++) {
+	    if(fullCircle) {
+		row[r] = source[r];
+	    } else if(halfCircle) {
+		// theta + 180 degree is the same line with -rho
+		int mirrored = 2*rhoOffset - r;
+		row[r] = mirrored >= 0 && mirrored < rhos ? source[mirrored] : -1;
+	    } else {
+		row[r] = -1;
+	    }
+	}
+    }
+
+    // maximum along theta for all rhos at once
+    windowMax.resize(akku.size());
+    slidingMax(&rowMax[0], &windowMax[0], thetas, radius, rhos);
+
+    // keep the best maxima in a heap (lowest key on top)
+    std::priority_queue<long long, std::vector<long long>, std::greater<long long> > best;
+    for(size_t i = 0; i < akku.size(); i++) {
+	if(akku[i] < params.minVotes || akku[i] <= 0 || windowMax[i] != key(i)) {
+	    continue;
+	}
+	if(!slopeAllowed(params, thetaOf(i / rhos))) {
+	    continue;
+	}
+	best.push(key(i));
+	if(params.maxLines > 0 && (int) best.size() > params.maxLines) {
+	    best.pop();
+	}
+    }
+
+    // lines with most votes first
+    lines->resize(best.size());
+    for(int i = (int) best.size()-1; i >= 0; i--) {
+	size_t index = akku.size()-1 - (size_t) (best.top() % (long long) akku.size());
+	best.pop();
+	(*lines)[i].rho = rhoOf(index % rhos);
+	(*lines)[i].theta = thetaOf(index / rhos);
+	(*lines)[i].votes = akku[index];
+    }
+    return 0;
+}
+
+int HoughTransform::detect(const ImageView &src, const HoughParameters &params,
+			   std::vector<HoughLine> *lines) {
+    if(prepare(src.width, src.height, params) != 0) {
+	return -1;
+    }
+    vote(src, params.grayThreshold, params.roi);
+    return findLines(params, lines);
+}
+
+int HoughTransform::detect(const EdgePoints &edges, int width, int height,
+			   const HoughParameters &params, std::vector<HoughLine> *lines) {
+    if(prepare(width, height, params) != 0) {
+	return -1;
+    }
+    vote(edges);
+    return findLines(params, lines);
+}
+
+int HoughTransform::detectOriented(const Gradient &gradient, const HoughParameters &params,
+				   std::vector<HoughLine> *lines) {
+    if(params.thetaWindow < 0 || prepare(gradient.width(), gradient.height(), params) != 0) {
+	return -1;
+    }
+    voteOriented(gradient, params);
+    return findLines(params, lines);
+}
+
+size_t HoughTransform::votePoint(int x, int y, int delta) {
+    size_t best = akku.size();
+    int bestVotes = 0;
+    for(size_t a = 0; a < angles.size(); a++) {
+	long long r = rhoIndex(x, y, angles[a]);
+	if(r < 0 || r >= rhos) {
+	    continue;
+	}
+	size_t index = (size_t) angles[a] * rhos + (size_t) r;
+	akku[index] += delta;
+	if(akku[index] > bestVotes) {
+	    bestVotes = akku[index];
+	    best = index;
+	}
+    }
+    return best;
+}
+
+bool HoughTransform::lineSteps(int theta, long long *stepX, long long *stepY) const {
+    // the line runs along the normal rotated by 90 degree
+    const int shift = 16;
+    double radian = thetaOf(theta) * M_PI / 180;
+    double dx = -sin(radian);
+    double dy = cos(radian);
+    if(fabs(dx) >= fabs(dy)) {
+	*stepX = (dx > 0 ? 1LL : -1LL) << shift;
+	*stepY = llround(dy / fabs(dx) * (1 << shift));
+	return true;
+    }
+    *stepX = llround(dx / fabs(dy) * (1 << shift));
+    *stepY = (dy > 0 ? 1LL : -1LL) << shift;
+    return false;
+}
+
+void HoughTransform::walkLine(int width, int height, int x, int y, int theta, int maxGap,
+			      HoughSegment *segment) {
+    const int shift = 16;
+    long long stepX;
+    long long stepY;
+    bool xMajor = lineSteps(theta, &stepX, &stepY);
+
+    // forward to the first end, backward to the second one
+    for(int k = 0; k < 2; k++) {
+	long long px = ((long long) x << shift) + (1LL << (shift-1));
+	long long py = ((long long) y << shift) + (1LL << (shift-1));
+	int endX = x;
+	int endY = y;
+	int gap = 0;
+	for(;;) {
+	    px += k == 0 ? stepX : -stepX;
+	    py += k == 0 ? stepY : -stepY;
+	    int cx = (int) (px >> shift);
+	    int cy = (int) (py >> shift);
+	    if(cx < 0 || cx >= width || cy < 0 || cy >= height) {
+		break;
+	    }
+
+	    // an edge pixel in the corridor (the angle is rounded, a thin
+	    // line may be one pixel beside the path)
+	    bool edge = false;
+	    for(int c = -1; c <= 1 && !edge; c++) {
+		int ex = xMajor ? cx : cx + c;
+		int ey = xMajor ? cy + c : cy;
+		edge = ex >= 0 && ex < width && ey >= 0 && ey < height
+		       && edgeMask[(size_t) ey * width + ex] != 0;
+	    }
+	    if(edge) {
+		gap = 0;
+		endX = cx;
+		endY = cy;
+	    } else if(++gap > maxGap) {
+		break;
+	    }
+	}
+	if(k == 0) {
+	    segment->x1 = endX;
+	    segment->y1 = endY;
+	} else {
+	    segment->x2 = endX;
+	    segment->y2 = endY;
+	}
+    }
+}
+
+void HoughTransform::clearLine(int width, int height, int x, int y, int theta,
+			       const HoughSegment &segment, bool takeBack) {
+    const int shift = 16;
+    long long stepX;
+    long long stepY;
+    bool xMajor = lineSteps(theta, &stepX, &stepY);
+
+    // the same path as walkLine, from the start pixel to both ends
+    for(int k = 0; k < 2; k++) {
+	long long px = ((long long) x << shift) + (1LL << (shift-1));
+	long long py = ((long long) y << shift) + (1LL << (shift-1));
+	int endX = k == 0 ? segment.x1 : segment.x2;
+	int endY = k == 0 ? segment.y1 : segment.y2;
+	for(;;) {
+	    int cx = (int) (px >> shift);
+	    int cy = (int) (py >> shift);
+
+	    // the pixel and its neighbours across the line
+	    for(int c = -1; c <= 1; c++) {
+		int ex = xMajor ? cx : cx + c;
+		int ey = xMajor ? cy + c : cy;
+		if(ex < 0 || ex >= width || ey < 0 || ey >= height) {
+		    continue;
+		}
+		uint8_t &mask = edgeMask[(size_t) ey * width + ex];
+		if(mask == 2 && takeBack) {
+		    votePoint(ex, ey, -1);
+		}
+		mask = 0;
+	    }
+
+	    if(cx == endX && cy == endY) {
+		break;
+	    }
+	    px += k == 0 ? stepX : -stepX;
+	    py += k == 0 ? stepY : -stepY;
+	}
+    }
+}
+
+int HoughTransform::prepareSegments(int width, int height, const HoughParameters &params,
+				    std::vector<HoughSegment> *segments) {
+    if(params.minVotes <= 0 || params.minLength < 0 || params.maxGap < 0
+	|| prepare(width, height, params) != 0) {
+	return -1;
+    }
+    segments->clear();
+
+    // angles of the slope filter
+    angles.clear();
+    for(int t = 0; t < thetas; t++) {
+	if(slopeAllowed(params, thetaOf(t))) {
+	    angles.push_back(t);
+	}
+    }
+    return 0;
+}
+
+int HoughTransform::detectSegments(const ImageView &src, const HoughParameters &params,
+				   std::vector<HoughSegment> *segments) {
+    if(prepareSegments(src.width, src.height, params, segments) != 0) {
+	return -1;
+    }
+
+    // edge pixels of the region (the first row and column are ignored like
+    // in vote)
+    Roi whole;
+    const Roi *roi = params.roi;
+    if(roi == 0) {
+	whole.prepare(src.width, src.height);
+	roi = &whole;
+    }
+    edgeMask.assign((size_t) src.width * src.height, 0);
+    edgePoints.clear();
+    for(int y = roi->top() > 1 ? roi->top() : 1; y < roi->bottom(); y++) {
+	const uint8_t *row = src.row(y);
+	int count;
+	const RoiSpan *span = roi->row(y, &count);
+	for(int i = 0; i < count; i++) {
+	    for(int x = span[i].left > 1 ? span[i].left : 1; x < span[i].right; x++) {
+		if(row[x] < params.grayThreshold) {
+		    edgeMask[(size_t) y * src.width + x] = 1;
+		    edgePoints.push_back(y * src.width + x);
+		}
+	    }
+	}
+    }
+
+    sampleSegments(src.width, src.height, params, segments);
+    return 0;
+}
+
+int HoughTransform::detectSegments(const EdgePoints &edges, int width, int height,
+				   const HoughParameters &params,
+				   std::vector<HoughSegment> *segments) {
+    if(prepareSegments(width, height, params, segments) != 0) {
+	return -1;
+    }
+
+    // the edge pixels of the list (in the order of the list)
+    edgeMask.assign((size_t) width * height, 0);
+    edgePoints.resize(edges.size());
+    for(size_t i = 0; i < edges.size(); i++) {
+	int point = edges.y[i] * width + edges.x[i];
+	edgeMask[point] = 1;
+	edgePoints[i] = point;
+    }
+
+    sampleSegments(width, height, params, segments);
+    return 0;
+}
+
+void HoughTransform::sampleSegments(int width, int height, const HoughParameters &params,
+				    std::vector<HoughSegment> *segments) {
+    // random order: a random one of the remaining pixels votes, the last
+    // remaining pixel takes its place
+    std::mt19937 random(1);
+    size_t remaining = edgePoints.size();
+    while(remaining > 0 && (params.maxLines <= 0 || (int) segments->size() < params.maxLines)) {
+	size_t pick = random() % remaining;
+	int point = edgePoints[pick];
+	edgePoints[pick] = edgePoints[--remaining];
+	if(edgeMask[point] != 1) {
+	    // removed with a segment
+	    continue;
+	}
+	int x = point % width;
+	int y = point / width;
+	edgeMask[point] = 2;
+	size_t best = votePoint(x, y, 1);
+	if(best == akku.size() || akku[best] < params.minVotes) {
+	    continue;
+	}
+
+	// follow the line of the counter, a short segment is removed from
+	// the image (it is not sampled again), a long one from the
+	// accumulator too
+	HoughSegment segment;
+	int theta = (int) (best / rhos);
+	segment.rho = rhoOf((int) (best % rhos));
+	segment.theta = thetaOf(theta);
+	segment.votes = akku[best];
+	walkLine(width, height, x, y, theta, params.maxGap, &segment);
+	bool longEnough = hypot(segment.x2 - segment.x1, segment.y2 - segment.y1) >= params.minLength;
+	clearLine(width, height, x, y, theta, segment, longEnough);
+	if(longEnough) {
+	    segments->push_back(segment);
+	}
+    }
+}
@@ -0,0 +1,378 @@
+#ifndef HOUGH_H
+#define HOUGH_H
+
+#include <vector>
+#include "imageplane.h"
+#include "roi.h"
+#include "gradient.h"
+#include "canny.h"
+
+/**
+  * line found by the Hough transformation
+  * (rho = x * cos(theta) + y * sin(theta))
+  */
+struct HoughLine {
+    double rho; ///< distance to the upper left corner in pixels
+    double theta; ///< angle of the normal in degree
+    int votes; ///< counter of the line in the accumulator
+};
+
+/**
+  * line segment found by the progressive probabilistic Hough transformation
+  */
+struct HoughSegment {
+    int x1; ///< column of the first end point
+    int y1; ///< row of the first end point
+    int x2; ///< column of the second end point
+    int y2; ///< row of the second end point
+    double rho; ///< distance of the line to the upper left corner in pixels
+    double theta; ///< angle of the normal of the line in degree
+    int votes; ///< counter of the line when it was found
+};
+
+/**
+  * range of slopes (y = m * x + b) for the line filter
+  */
+struct SlopeRange {
+    double low; ///< lines with m > low ...
+    double high; ///< ... and m < high pass
+};
+
+/**
+  * parameters of the Hough transformation for lines
+  */
+struct HoughParameters {
+    double thetaFirst; ///< first angle in degree
+    double thetaStep; ///< distance of two angles in degree
+    int thetaCount; ///< number of angles (180 degree are enough with signedRho)
+    double rhoStep; ///< distance of two rhos in pixels
+    bool signedRho; ///< true -> negative distances are counted too
+    double rhoFirst; ///< first rho in pixels (only with rhoCount > 0)
+    int rhoCount; ///< number of rhos (0 -> all distances of the image)
+    int grayThreshold; ///< pixels darker than this gray value vote
+    int minVotes; ///< minimal votes of a line
+    int interval; ///< x and y size of the window for local maxima (odd)
+    int maxLines; ///< maximal number of lines, the ones with most votes (0 -> all)
+    int minLength; ///< minimal length of a segment in pixels (progressive transformation)
+    int maxGap; ///< maximal gap within a segment in pixels (progressive transformation)
+    int minMagnitude; ///< pixels with at least this gradient magnitude vote (oriented voting)
+    int thetaWindow; ///< angles within +- thetaWindow degree of the gradient vote (oriented voting)
+    const Roi *roi; ///< only pixels of this region vote (prepared for the image, 0 -> all)
+    std::vector<SlopeRange> slopes; ///< only lines within one of the ranges (empty -> all)
+
+    /**
+      * 360 angles of one degree, one pixel per rho (all distances), no
+      * slope filter, segments of at least 30 pixels with gaps up to 3 pixels,
+      * oriented voting of magnitudes from 100 within +- 8 degree (the Sobel
+      * orientation of a staircase edge varies by some degree)
+      */
+    HoughParameters();
+};
+
+/**
+  * Hough transformation for lines
+  *
+  * sin and cos are precomputed once per angle resolution as fixed point
+  * numbers, so a vote needs only integer multiplications and additions
+  * the accumulator is stored angle by angle (one row of rhos per angle),
+  * votes of neighbouring pixels hit neighbouring counters
+  *
+  * the accumulator and the tables are kept between two calls and only
+  * reallocated if they grow
+  */
+class HoughTransform
+{
+private:
+    static const int fixedBits = 30; ///< fraction bits of the sin/cos tables
+
+    double thetaFirst; ///< first angle in degree
+    double thetaStep; ///< distance of two angles in degree
+    int thetas; ///< number of angles
+    double rhoStep; ///< distance of two rhos in pixels
+    int rhos; ///< number of rhos
+    int rhoOffset; ///< index of rho 0
+    bool mirrorRho; ///< true -> all signed rhos, theta + 180 degree is rho mirrored at rhoOffset
+    std::vector<long long> cosTable; ///< cos(theta) / rhoStep * 2^fixedBits
+    std::vector<long long> sinTable; ///< sin(theta) / rhoStep * 2^fixedBits
+    std::vector<int> akku; ///< counters (size: thetas x rhos)
+    std::vector<int> bandAkku; ///< counters of the bands (if more than one)
+    std::vector<long long> line; ///< keys of one angle with padding
+    std::vector<long long> rowMax; ///< maxima along rho (thetas + padding rows)
+    std::vector<long long> windowMax; ///< maxima of the whole window
+    std::vector<long long> prefix; ///< block prefix maxima of the sliding maximum
+    std::vector<long long> suffix; ///< block suffix maxima of the sliding maximum
+    std::vector<uint8_t> edgeMask; ///< pixels of the progressive transformation (0 -> none, 1 -> edge, 2 -> voted edge)
+    std::vector<int> edgePoints; ///< edge pixels (y * width + x) which are not sampled yet
+    std::vector<int> angles; ///< indices of the angles which pass the slope filter
+    std::vector<int> orientedStart; ///< first entry of orientedAngles of every orientation (361 entries)
+    std::vector<int> orientedAngles; ///< indices of the angles near every orientation (oriented voting)
+
+    /**
+      * unique key of a counter: more votes -> higher key, equal votes ->
+      * the lower index has the higher key
+      */
+    long long key(size_t index) const {
+        return (long long) akku[index] * (long long) akku.size() + (long long) (akku.size()-1 - index);
+    }
+
+    /**
+      * sliding maximum of parallel sequences (van Herk / Gil-Werman, three
+      * comparisons per value independent of the window size)
+      * dst[i] = max(src[i] .. src[i + 2*radius]), the source has radius
+      * padding values before and after the n values
+      *
+      * @param src source (size: (n + 2*radius) x lanes)
+      * @param dst maxima (size: n x lanes)
+      * @param n number of values per lane
+      * @param radius values left and right of the center
+      * @param lanes number of sequences (value i of lane l at i*lanes + l)
+      */
+    void slidingMax(const long long *src, long long *dst, int n, int radius, int lanes);
+
+    /**
+      * add the accumulators of the bands (bandAkku) to the accumulator
+      *
+      * @param bands number of bands
+      */
+    void addBands(int bands);
+
+    /**
+      * check the slope filter of the parameters
+      */
+    static bool slopeAllowed(const HoughParameters &params, double theta);
+
+    /**
+      * index of the rho of a pixel for an angle (may be outside of the
+      * accumulator)
+      */
+    long long rhoIndex(int x, int y, int theta) const {
+        return ((y * sinTable[theta] + x * cosTable[theta] + (1LL << (fixedBits-1))) >> fixedBits) + rhoOffset;
+    }
+
+    /**
+      * add (delta 1) or remove (delta -1) the votes of a pixel for all
+      * angles of the slope filter
+      *
+      * @return  index of the counter with most votes (after adding)
+      */
+    size_t votePoint(int x, int y, int delta);
+
+    /**
+      * steps along a line: one pixel along the major axis and the fraction
+      * (16 bits) along the other one
+      *
+      * @param theta index of the angle of the normal
+      * @param stepX step of the column (fixed point)
+      * @param stepY step of the row (fixed point)
+      * @return  true -> x is the major axis
+      */
+    bool lineSteps(int theta, long long *stepX, long long *stepY) const;
+
+    /**
+      * walk along a line from a pixel in both directions up to the last
+      * edge pixels before a gap of more than maxGap pixels (edge pixels of
+      * the corridor count, like in clearLine)
+      *
+      * @param width width of the image
+      * @param height height of the image
+      * @param x column of the start pixel
+      * @param y row of the start pixel
+      * @param theta index of the angle of the normal
+      * @param maxGap maximal gap in pixels
+      * @param segment found ends (x1, y1 and x2, y2)
+      */
+    void walkLine(int width, int height, int x, int y, int theta, int maxGap, HoughSegment *segment);
+
+    /**
+      * remove the edge pixels of the corridor of a segment (3 pixels across
+      * the line, walked like walkLine)
+      *
+      * @param width width of the image
+      * @param height height of the image
+      * @param x column of the start pixel
+      * @param y row of the start pixel
+      * @param theta index of the angle of the normal
+      * @param segment ends of the segment
+      * @param takeBack true -> the removed pixels which have voted take
+      *                 their votes back
+      */
+    void clearLine(int width, int height, int x, int y, int theta, const HoughSegment &segment,
+                   bool takeBack);
+
+    /**
+      * check the parameters of the progressive transformation, prepare the
+      * accumulator and the angles of the slope filter
+      *
+      * @return  0 -> prepared
+      *         -1 -> wrong parameters
+      */
+    int prepareSegments(int width, int height, const HoughParameters &params,
+                        std::vector<HoughSegment> *segments);
+
+    /**
+      * sample the edge pixels (edgeMask and edgePoints) in random order
+      * and collect the segments (see detectSegments)
+      */
+    void sampleSegments(int width, int height, const HoughParameters &params,
+                        std::vector<HoughSegment> *segments);
+
+public:
+    HoughTransform();
+
+    /**
+      * set the resolution and the size of the image and clear all counters,
+      * the tables are only calculated again if the angles change
+      * with a rho range (rhoCount > 0) only the counters of the range exist,
+      * votes outside of it are dropped
+      *
+      * @param width width of the image
+      * @param height height of the image
+      * @param params angles and rho resolution
+      * @return  0 -> prepared
+      *         -1 -> wrong parameters
+      */
+    int prepare(int width, int height, const HoughParameters &params);
+
+    /**
+      * add the votes of all pixels darker than threshold (the first row and
+      * column are ignored), the image is visited row by row in parallel
+      * bands, every band votes into its own accumulator
+      *
+      * @param src image (size: as prepared)
+      * @param threshold threshold of gray value
+      * @param roi only pixels of this region vote (prepared for the size of
+      *            src, 0 -> all)
+      */
+    void vote(const ImageView &src, int threshold, const Roi *roi = 0);
+
+    /**
+      * add the votes of the pixels of an edge list (e.g. of Canny), only
+      * the edge pixels are visited, the list is split into parallel bands
+      * which vote into their own accumulators
+      *
+      * @param edges edge pixels (inside of the prepared size)
+      */
+    void vote(const EdgePoints &edges);
+
+    /**
+      * add the votes of all pixels with a strong gradient, a pixel votes
+      * only for the angles near its gradient orientation (the normal of
+      * the edge, both directions), so it needs a handful of votes instead
+      * of one per angle
+      *
+      * @param gradient gradient of the image (size: as prepared)
+      * @param params minimal magnitude, window of angles (+- thetaWindow
+      *               degree), slope filter and region
+      */
+    void voteOriented(const Gradient &gradient, const HoughParameters &params);
+
+    /**
+      * search the local maxima of the accumulator: a counter is a line, if
+      * it is the maximum of the window (interval x interval) around it
+      * (non-maximum suppression, equal counters: the first one wins)
+      * the angles wrap around for 360 degree (same rho) and for 180 degree
+      * with signed rhos (mirrored rho)
+      * the search needs a constant number of operations per counter
+      *
+      * @param params interval, minimal votes, maximal lines and slope filter
+      * @param lines found lines (most votes first)
+      * @return  0 -> search complete
+      *         -1 -> wrong parameters
+      */
+    int findLines(const HoughParameters &params, std::vector<HoughLine> *lines);
+
+    /**
+      * prepare, vote and find the lines of an image
+      *
+      * @param src image
+      * @param params parameters of the transformation
+      * @param lines found lines
+      * @return  0 -> detection complete
+      *         -1 -> wrong parameters
+      */
+    int detect(const ImageView &src, const HoughParameters &params, std::vector<HoughLine> *lines);
+
+    /**
+      * prepare, vote (oriented) and find the lines of the gradient of an
+      * image
+      *
+      * @param gradient gradient of the image
+      * @param params parameters of the transformation
+      * @param lines found lines
+      * @return  0 -> detection complete
+      *         -1 -> wrong parameters
+      */
+    int detectOriented(const Gradient &gradient, const HoughParameters &params,
+                       std::vector<HoughLine> *lines);
+
+    /**
+      * prepare, vote and find the lines of an edge list (the region and the
+      * gray threshold of the parameters are not used, the list is already
+      * restricted)
+      *
+      * @param edges edge pixels
+      * @param width width of the image
+      * @param height height of the image
+      * @param params parameters of the transformation
+      * @param lines found lines
+      * @return  0 -> detection complete
+      *         -1 -> wrong parameters
+      */
+    int detect(const EdgePoints &edges, int width, int height, const HoughParameters &params,
+               std::vector<HoughLine> *lines);
+
+    /**
+      * progressive probabilistic Hough transformation (Matas et al.): the
+      * edge pixels vote one by one in random order, as soon as a counter
+      * reaches minVotes the line is followed through the image, a long
+      * enough segment is stored and its pixels are removed from the image
+      * and from the accumulator
+      * only a fraction of the edge pixels votes, so the time depends on the
+      * number of lines rather than on the number of edge pixels
+      * the random order is the same for every call (same segments for the
+      * same image)
+      *
+      * @param src image (pixels darker than grayThreshold are edges)
+      * @param params angles, rhos, slope filter, region, minimal votes,
+      *               minimal length, maximal gap and maximal segments
+      *               (maxLines)
+      * @param segments found segments (in the order they were found)
+      * @return  0 -> detection complete
+      *         -1 -> wrong parameters
+      */
+    int detectSegments(const ImageView &src, const HoughParameters &params,
+                       std::vector<HoughSegment> *segments);
+
+    /**
+      * progressive probabilistic Hough transformation of an edge list (see
+      * above, the region and the gray threshold of the parameters are not
+      * used)
+      *
+      * @param edges edge pixels
+      * @param width width of the image
+      * @param height height of the image
+      * @param params angles, rhos, slope filter, minimal votes, minimal
+      *               length, maximal gap and maximal segments (maxLines)
+      * @param segments found segments (in the order they were found)
+      * @return  0 -> detection complete
+      *         -1 -> wrong parameters
+      */
+    int detectSegments(const EdgePoints &edges, int width, int height,
+                       const HoughParameters &params, std::vector<HoughSegment> *segments);
+
+    int thetaCount() const { return thetas; } ///< number of angles
+    int rhoCount() const { return rhos; } ///< number of rhos
+    double thetaOf(int theta) const { return thetaFirst + theta * thetaStep; } ///< angle of an index
+    double rhoOf(int rho) const { return (rho - rhoOffset) * rhoStep; } ///< distance of an index
+
+    /**
+      * get the counter of a rho and an angle
+      *
+      * @param rho index of the rho (0 .. rhoCount-1)
+      * @param theta index of the angle (0 .. thetaCount-1)
+      * @return  number of votes
+      */
+    int votes(int rho, int theta) const { return akku[(size_t) theta * rhos + rho]; }
+};
+
+#endif // HOUGH_H
@@ -0,0 +1,69 @@
+#include "imageplane.h"
+#include <string.h>
+
+ImagePlane::ImagePlane() {
+    pixels = own.view();
+    foreign = false;
+}
+
+ImagePlane::~ImagePlane() {
+    release();
+}
+
+int ImagePlane::allocate(int width, int height) {
+    // the own buffer is reused if the size is the same
+    if(foreign) {
+	release();
+    }
+    if(own.allocate(width, height) != 0) {
+	release();
+	return -1;
+    }
+    pixels = own.view();
+    return 0;
+}
+
+void ImagePlane::wrap(const uint8_t *data, int width, int height, int stride) {
+    release();
+    ImageView wrapped = { (uint8_t*) data, width, height, stride };
+    pixels = wrapped;
+    foreign = true;
+}
+
+int ImagePlane::detach() {
+    if(!foreign) {
+	return 0;
+    }
+
+    // copy row by row into an own buffer, without memory the wrapped
+    // pixels stay
+    Plane<uint8_t> copy;
+    if(copy.allocate(pixels.width, pixels.height) != 0) {
+	return -1;
+    }
+    for(int y = 0; y < pixels.height; y++) {
+	memcpy(copy.row(y), pixels.row(y), pixels.width);
+    }
+    own.swap(copy);
+    pixels = own.view();
+    foreign = false;
+    return 0;
+}
+
+void ImagePlane::release() {
+    own.release();
+    pixels = own.view();
+    foreign = false;
+}
+
+ImageView ImagePlane::view() {
+    if(writable() != 0) {
+	ImageView empty = { 0, 0, 0, 0 };
+	return empty;
+    }
+    return pixels;
+}
+
+ImageView ImagePlane::constView() const {
+    return pixels;
+}
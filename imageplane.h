@@ -0,0 +1,275 @@
+#ifndef IMAGEPLANE_H
+#define IMAGEPLANE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include "alignedblock.h"
+
+/**
+  * view on an image with pixels of type T (uint8_t, int16_t, float, ...)
+  * with an explicit stride (the view does not own the pixels)
+  */
+template<typename T>
+struct PlaneView {
+    T *data; ///< first pixel of the first row
+    int width; ///< width of the image
+    int height; ///< height of the image
+    int stride; ///< distance between two rows in pixels
+
+    /**
+      * get a pointer to the first pixel of a row
+      *
+      * @param y row of the image
+      * @return  pointer to the row
+      */
+    T *row(int y) const { return data + (ptrdiff_t) y * stride; }
+};
+
+/**
+  * view on an 8 bit gray image (stride in bytes)
+  */
+typedef PlaneView<uint8_t> ImageView;
+
+/**
+  * contiguous image with pixels of type T in one 64 byte aligned allocation,
+  * e.g. the signed or fixed point result of an operation which is consumed
+  * by the next one without rescaling it to 8 bit
+  * every row starts on an aligned address
+  */
+template<typename T>
+class Plane
+{
+private:
+    void *block; ///< memory block returned by malloc
+    T *buffer; ///< first pixel (aligned in block)
+    int planeWidth; ///< width of the image
+    int planeHeight; ///< height of the image
+    int planeStride; ///< distance between two rows in pixels
+
+    // a plane owns its buffer, so it cannot be copied
+    Plane(const Plane &);
+    Plane &operator=(const Plane &);
+
+public:
+    static const int alignment = 64; ///< alignment of the buffer and every row
+
+    Plane() : block(0), buffer(0), planeWidth(0), planeHeight(0), planeStride(0) {}
+    ~Plane() { release(); }
+
+    /**
+      * allocate the plane for the given size, the old buffer is reused
+      * when the size does not change (the content is undefined)
+      *
+      * @param width width of the image
+      * @param height height of the image
+      * @return  0 -> plane allocated successfully
+      *         -1 -> out of memory
+      */
+    int allocate(int width, int height) {
+        if(buffer != 0 && width == planeWidth && height == planeHeight) {
+            return 0;
+        }
+        release();
+        if(width <= 0 || height <= 0) {
+            return 0;
+        }
+
+        // every row starts on an aligned address (a size which does not
+        // fit in int or size_t cannot be allocated either)
+        const int perLine = alignment / sizeof(T);
+        if(width > INT_MAX - perLine) {
+            return -1;
+        }
+        int stride = (width + perLine - 1) / perLine * perLine;
+        if((size_t) stride > ((size_t) -1 - alignment) / sizeof(T) / height) {
+            return -1;
+        }
+        buffer = (T*) alignedAllocate((size_t) stride * height * sizeof(T), alignment, &block);
+        if(buffer == 0) {
+            return -1;
+        }
+        planeWidth = width;
+        planeHeight = height;
+        planeStride = stride;
+        return 0;
+    }
+
+    /**
+      * free the buffer of the plane
+      */
+    void release() {
+        free(block);
+        block = 0;
+        buffer = 0;
+        planeWidth = 0;
+        planeHeight = 0;
+        planeStride = 0;
+    }
+
+    /**
+      * exchange the buffers of two planes (no copy)
+      *
+      * @param other other plane
+      */
+    void swap(Plane &other) {
+        void *otherBlock = other.block;
+        T *otherBuffer = other.buffer;
+        int otherWidth = other.planeWidth;
+        int otherHeight = other.planeHeight;
+        int otherStride = other.planeStride;
+        other.block = block;
+        other.buffer = buffer;
+        other.planeWidth = planeWidth;
+        other.planeHeight = planeHeight;
+        other.planeStride = planeStride;
+        block = otherBlock;
+        buffer = otherBuffer;
+        planeWidth = otherWidth;
+        planeHeight = otherHeight;
+        planeStride = otherStride;
+    }
+
+    T *row(int y) { return buffer + (ptrdiff_t) y * planeStride; } ///< first pixel of a row
+    const T *constRow(int y) const { return buffer + (ptrdiff_t) y * planeStride; } ///< first pixel of a row
+
+    /**
+      * get a view on the whole plane
+      *
+      * @return  view on the plane
+      */
+    PlaneView<T> view() {
+        PlaneView<T> v = { buffer, planeWidth, planeHeight, planeStride };
+        return v;
+    }
+
+    /**
+      * get a view on the whole plane for reading only
+      *
+      * @return  view on the plane
+      */
+    PlaneView<T> constView() const {
+        PlaneView<T> v = { buffer, planeWidth, planeHeight, planeStride };
+        return v;
+    }
+
+    int width() const { return planeWidth; } ///< width of the image
+    int height() const { return planeHeight; } ///< height of the image
+    int stride() const { return planeStride; } ///< distance between two rows in pixels
+    bool isEmpty() const { return buffer == 0; } ///< true if no buffer is allocated
+};
+
+/**
+  * contiguous 8 bit gray image in one 64 byte aligned allocation (an 8 bit
+  * Plane which can also wrap foreign pixels)
+  * every row starts on an aligned address (stride is a multiple of 64)
+  *
+  * the plane can also wrap foreign read-only pixels (e.g. a mapped file),
+  * they are copied into an own buffer on the first write access
+  */
+class ImagePlane
+{
+private:
+    Plane<uint8_t> own; ///< own pixels (empty while foreign pixels are wrapped)
+    ImageView pixels; ///< pixels in use (own or foreign)
+    bool foreign; ///< true -> pixels are wrapped and not owned by the plane
+
+    // a plane owns its buffer, so it cannot be copied
+    ImagePlane(const ImagePlane &);
+    ImagePlane &operator=(const ImagePlane &);
+
+public:
+    static const int alignment = Plane<uint8_t>::alignment; ///< alignment of the buffer and every row
+
+    ImagePlane();
+    ~ImagePlane();
+
+    /**
+      * allocate the plane for the given size, the old buffer is reused
+      * when the size does not change (the content is undefined)
+      *
+      * @param width width of the image
+      * @param height height of the image
+      * @return  0 -> plane allocated successfully
+      *         -1 -> out of memory
+      */
+    int allocate(int width, int height);
+
+    /**
+      * wrap foreign pixels without a copy, the pixels must stay valid until
+      * the plane is released, reallocated or detached
+      *
+      * @param data first pixel of the first row
+      * @param width width of the image
+      * @param height height of the image
+      * @param stride distance between two rows in bytes
+      */
+    void wrap(const uint8_t *data, int width, int height, int stride);
+
+    /**
+      * copy wrapped pixels into an own aligned buffer
+      *
+      * @return  0 -> plane owns its pixels
+      *         -1 -> out of memory (the wrapped pixels are kept)
+      */
+    int detach();
+
+    /**
+      * make the pixels writable (wrapped pixels are copied), this must
+      * succeed before the plane is changed through row or view
+      *
+      * @return  0 -> pixels can be written
+      *         -1 -> out of memory (the wrapped pixels are kept)
+      */
+    int writable() { return foreign ? detach() : 0; }
+
+    /**
+      * free the buffer of the plane
+      */
+    void release();
+
+    /**
+      * get a pointer to the first pixel of a row for writing
+      * (wrapped pixels are copied before, see writable)
+      *
+      * @param y row of the image
+      * @return  pointer to the row (0 -> no memory for the copy)
+      */
+    uint8_t *row(int y) {
+        if(writable() != 0) {
+            return 0;
+        }
+        return pixels.row(y);
+    }
+
+    /**
+      * get a pointer to the first pixel of a row for reading
+      *
+      * @param y row of the image
+      * @return  pointer to the row
+      */
+    const uint8_t *constRow(int y) const { return pixels.row(y); }
+
+    /**
+      * get a view on the whole plane for writing
+      * (wrapped pixels are copied before, see writable)
+      *
+      * @return  view on the plane (empty -> no memory for the copy)
+      */
+    ImageView view();
+
+    /**
+      * get a view on the whole plane for reading only
+      *
+      * @return  view on the plane
+      */
+    ImageView constView() const;
+
+    int width() const { return pixels.width; } ///< width of the image
+    int height() const { return pixels.height; } ///< height of the image
+    int stride() const { return pixels.stride; } ///< distance between two rows in bytes
+    bool isEmpty() const { return pixels.data == 0; } ///< true if no buffer is allocated
+    bool isWrapped() const { return foreign; } ///< true if foreign pixels are wrapped
+};
+
+#endif // IMAGEPLANE_H
@@ -0,0 +1,125 @@
+#include "kernels.h"
+#include <stdlib.h>
+
+int **Kernels::allocate(int size) {
+    int **kernel = (int**) malloc(sizeof(int*) * size);
+    if(kernel == NULL) {
+	return 0;
+    }
+    for(int i = 0; i < size; i++){
+	kernel[i] = (int*) malloc(sizeof(int) * size);
+	if(kernel[i] == NULL) {
+	    release(kernel, i);
+	    return 0;
+	}
+    }
+    return kernel;
+}
+
+void Kernels::release(int **kernel, int size) {
+    if(kernel == 0) {
+	return;
+    }
+    for(int i = 0; i < size; i++){
+	free(kernel[i]);
+    }
+    free(kernel);
+}
+
+void Kernels::gauss(int **kernel, int kSize) {
+    // init borders (top left quarter)
+    kernel[0][0] = 1;
+    for(int i = 1; i < (kSize+1)/2; i++) {
+	kernel[0][i] = kernel[0][i-1] * 2;
+	kernel[i][0] = kernel[0][i-1] * 2;
+    }
+    // init the rest on top left quarter
+    for(int row = 1; row < (kSize+1)/2; row++) {
+	for(int col = 1; col < (kSize+1)/2; col++) {
+	    kernel[col][row] = kernel[row-1][col] * 2;
+	    kernel[row][col] = kernel[row-1][col] * 2;
+	}
+    }
+    // mirror this quarter to the others
+    for(int row = 0; row < (kSize-1)/2; row++) {
+	for(int col = 0; col < (kSize-1)/2; col++) {
+	    kernel[kSize-1-col][row] = kernel[row][col];
+	    kernel[col][kSize-1-row] = kernel[row][col];
+	    kernel[kSize-1-col][kSize-1-row] = kernel[row][col];
+	}
+    }
+    // fill the rest (borders of the bottom right quarter)
+    for(int i = 0; i < (kSize-1)/2; i++) {
+	kernel[kSize-1-i][(kSize-1)/2] = kernel[i][(kSize-1)/2];
+	kernel[(kSize-1)/2][kSize-1-i] = kernel[i][(kSize-1)/2];
+    }
+}
+
+void Kernels::kirsch(int **kernel) {
+    fill<KirschStencil>(kernel);
+}
+
+void Kernels::laplace(int **kernel) {
+    fill<LaplaceStencil>(kernel);
+}
+
+void Kernels::prewitt1(int **kernel) {
+    fill<Prewitt1Stencil>(kernel);
+}
+
+void Kernels::prewitt2(int **kernel) {
+    fill<Prewitt2Stencil>(kernel);
+}
+
+void Kernels::sobel(int **kernel) {
+    fill<SobelStencil>(kernel);
+}
+
+void Kernels::sobelVertical(int **kernel) {
+    fill<SobelVerticalStencil>(kernel);
+}
+
+void Kernels::fill(int **kernel, Builtin builtin) {
+    switch(builtin) {
+    case Kirsch:
+	kirsch(kernel);
+	break;
+    case Laplace:
+	laplace(kernel);
+	break;
+    case Prewitt1:
+	prewitt1(kernel);
+	break;
+    case Prewitt2:
+	prewitt2(kernel);
+	break;
+    case Sobel:
+	sobel(kernel);
+	break;
+    case SobelVertical:
+	sobelVertical(kernel);
+	break;
+    }
+}
+
+int Kernels::size(Builtin builtin) {
+    return builtin == Laplace ? LaplaceStencil::width : 3;
+}
+
+bool Kernels::rotating(Builtin builtin) {
+    switch(builtin) {
+    case Kirsch:
+	return Traits<Kirsch>::rotating;
+    case Laplace:
+	return Traits<Laplace>::rotating;
+    case Prewitt1:
+	return Traits<Prewitt1>::rotating;
+    case Prewitt2:
+	return Traits<Prewitt2>::rotating;
+    case Sobel:
+	return Traits<Sobel>::rotating;
+    case SobelVertical:
+	return Traits<SobelVertical>::rotating;
+    }
+    return false;
+}
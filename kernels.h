@@ -0,0 +1,151 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "stencil.h"
+
+/**
+  * kernels for the convolution (used by the GUI and the batch tool)
+  * a kernel is a matrix of [size][size] values allocated with malloc
+  *
+  * the coefficients of the built-in kernels are stencils known at compile
+  * time, Convolution(Builtin) applies them unrolled, the functions below
+  * fill a kernel with the same values for the generic convolution
+  */
+class Kernels
+{
+public:
+    /**
+      * built-in kernels
+      */
+    enum Builtin {
+        Kirsch, ///< Kirsch, 3x3, rotating
+        Laplace, ///< Laplacian of the Gaussian, 5x5, non-rotating
+        Prewitt1, ///< Prewitt 1, 3x3, rotating
+        Prewitt2, ///< Prewitt 2, 3x3, rotating
+        Sobel, ///< Sobel, 3x3, rotating
+        SobelVertical ///< Sobel for vertical edges, 3x3, non-rotating
+    };
+
+    typedef Stencil<3, 3,
+                     5,  5,  5,
+                    -3,  0, -3,
+                    -3, -3, -3> KirschStencil;
+    typedef Stencil<5, 5,
+                     0,  0, -1,  0,  0,
+                     0, -1, -2, -1,  0,
+                    -1, -2, 16, -2, -1,
+                     0, -1, -2, -1,  0,
+                     0,  0, -1,  0,  0> LaplaceStencil;
+    typedef Stencil<3, 3,
+                     1,  1,  1,
+                     1, -2,  1,
+                    -1, -1, -1> Prewitt1Stencil;
+    typedef Stencil<3, 3,
+                     1,  1,  1,
+                     0,  0,  0,
+                    -1, -1, -1> Prewitt2Stencil;
+    typedef Stencil<3, 3,
+                     1,  2,  1,
+                     0,  0,  0,
+                    -1, -2, -1> SobelStencil;
+    typedef Stencil<3, 3,
+                     1,  0, -1,
+                     2,  0, -2,
+                     1,  0, -1> SobelVerticalStencil;
+
+    /**
+      * stencil and rotation of a built-in kernel (specialized below)
+      */
+    template<Builtin B>
+    struct Traits;
+
+    static const int maxBuiltinSize = 5; ///< x and y size of the largest built-in kernel
+
+    /**
+      * fill a kernel with a stencil
+      *
+      * @param kernel kernel to fill (size: S::width x S::height)
+      */
+    template<typename S>
+    static void fill(int **kernel) {
+        for(int k = 0; k < S::height; k++) {
+            for(int l = 0; l < S::width; l++) {
+                kernel[k][l] = S::at(k, l);
+            }
+        }
+    }
+
+    /**
+      * allocate a kernel
+      *
+      * @param size x and y size of the kernel
+      * @return  kernel (0 -> out of memory)
+      */
+    static int **allocate(int size);
+
+    /**
+      * free a kernel
+      *
+      * @param kernel kernel (may be 0)
+      * @param size x and y size of the kernel
+      */
+    static void release(int **kernel, int size);
+
+    /**
+      * fill a kernel with Gauss (non-rotating)
+      *
+      * @param kernel kernel to fill
+      * @param kSize x and y size of the kernel (odd)
+      */
+    static void gauss(int **kernel, int kSize);
+
+    static void kirsch(int **kernel); ///< Kirsch, 3x3, rotating
+    static void laplace(int **kernel); ///< Laplacian of the Gaussian, 5x5, non-rotating
+    static void prewitt1(int **kernel); ///< Prewitt 1, 3x3, rotating
+    static void prewitt2(int **kernel); ///< Prewitt 2, 3x3, rotating
+    static void sobel(int **kernel); ///< Sobel, 3x3, rotating
+    static void sobelVertical(int **kernel); ///< Sobel for vertical edges, 3x3, non-rotating
+
+    /**
+      * fill a kernel with a built-in kernel
+      *
+      * @param kernel kernel to fill (size: size(builtin))
+      * @param builtin built-in kernel
+      */
+    static void fill(int **kernel, Builtin builtin);
+
+    static int size(Builtin builtin); ///< x and y size of a built-in kernel
+    static bool rotating(Builtin builtin); ///< true if a built-in kernel is rotating
+};
+
+template<> struct Kernels::Traits<Kernels::Kirsch> {
+    typedef KirschStencil Stencil;
+    static const bool rotating = true;
+};
+
+template<> struct Kernels::Traits<Kernels::Laplace> {
+    typedef LaplaceStencil Stencil;
+    static const bool rotating = false;
+};
+
+template<> struct Kernels::Traits<Kernels::Prewitt1> {
+    typedef Prewitt1Stencil Stencil;
+    static const bool rotating = true;
+};
+
+template<> struct Kernels::Traits<Kernels::Prewitt2> {
+    typedef Prewitt2Stencil Stencil;
+    static const bool rotating = true;
+};
+
+template<> struct Kernels::Traits<Kernels::Sobel> {
+    typedef SobelStencil Stencil;
+    static const bool rotating = true;
+};
+
+template<> struct Kernels::Traits<Kernels::SobelVertical> {
+    typedef SobelVerticalStencil Stencil;
+    static const bool rotating = false;
+};
+
+#endif // KERNELS_H
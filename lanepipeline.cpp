@@ -0,0 +1,157 @@
+#include "lanepipeline.h"
+#include "pgmstream.h"
+#include "kernels.h"
+#include <thread>
+#include <math.h>
+
+LanePipeline::LanePipeline(int queueSize) {
+    this->queueSize = queueSize > 0 ? queueSize : 1;
+    tracking = false;
+    gaussKernel = Kernels::allocate(7);
+    if(gaussKernel != 0) {
+	Kernels::gauss(gaussKernel, 7);
+    }
+}
+
+LanePipeline::~LanePipeline() {
+    Kernels::release(gaussKernel, 7);
+}
+
+int LanePipeline::filter(LaneFrame *frame) {
+    int ret = frame->image.convolution(gaussKernel, 7, false);
+    if(ret == 0) {
+	ret = frame->image.convolutionLD(Kernels::SobelVertical);
+    }
+    return ret;
+}
+
+int LanePipeline::hough(LaneFrame *frame) {
+    int ret = frame->image.houghLD(&frame->lines, tracking ? &tracker : 0);
+    if(ret != 0) {
+	return ret;
+    }
+
+    // strongest line of each slope range (y grows downwards, so the left
+    // lane line falls to the right)
+    for(size_t i = 0; i < frame->lines.size(); i++) {
+	double radian = frame->lines[i].theta*M_PI/180;
+	double m = (-1) * cos(radian) / sin(radian);
+	if(m < 0 && frame->left < 0) {
+	    frame->left = (int) i;
+	} else if(m > 0 && frame->right < 0) {
+	    frame->right = (int) i;
+	}
+    }
+    return 0;
+}
+
+int LanePipeline::dye(LaneFrame *frame) {
+    return frame->image.dyeLD(&frame->lane);
+}
+
+void LanePipeline::readFrames(const QStringList &inputs, FrameQueue *freeFrames,
+			      FrameQueue *out) {
+    PgmStream stream;
+    long number = 0;
+    LaneFrame *frame;
+    for(int i = 0; i < inputs.size(); i++) {
+	int ret = stream.open(inputs[i]);
+	while(freeFrames->pop(&frame)) {
+	    frame->number = number++;
+	    frame->source = inputs[i];
+	    frame->ret = 0;
+	    frame->failedStage = QString();
+	    frame->lines.clear();
+	    frame->left = -1;
+	    frame->right = -1;
+	    frame->lane.area = 0;
+	    frame->latency = 0;
+
+	    // the latency starts when the whole frame is read
+	    const uint8_t *data = 0;
+	    size_t size = 0;
+	    if(ret == 0) {
+		ret = stream.next(&data, &size);
+	    }
+	    frame->timer.start();
+	    if(ret == 0) {
+		frame->ret = frame->image.loadPgm(data, size);
+		frame->failedStage = "load";
+	    } else if(ret < 0) {
+		// input cannot be opened or the stream is broken
+		frame->ret = ret;
+		frame->failedStage = "read";
+	    } else {
+		// end of the input, the frame is used for the next one
+		number--;
+		freeFrames->push(frame);
+		break;
+	    }
+	    out->push(frame);
+	    if(ret < 0) {
+		break;
+	    }
+	}
+    }
+    out->close();
+}
+
+void LanePipeline::runStage(const char *name, int (LanePipeline::*stage)(LaneFrame*),
+			    FrameQueue *in, FrameQueue *out) {
+    LaneFrame *frame;
+    while(in->pop(&frame)) {
+	if(frame->ret == 0) {
+	    frame->ret = (this->*stage)(frame);
+	    frame->failedStage = name;
+	}
+	out->push(frame);
+    }
+    out->close();
+}
+
+int LanePipeline::run(const QStringList &inputs, const FrameFunction &done) {
+    if(gaussKernel == 0) {
+	return -4;
+    }
+
+    tracker.reset();
+
+    // one frame for every stage (read, filter, hough, dye and done) and
+    // for every slot of the four queues between them
+    std::vector<LaneFrame> frames(5 + 4 * queueSize);
+    FrameQueue freeFrames(frames.size());
+    for(size_t i = 0; i < frames.size(); i++) {
+	frames[i].image.setRoi(roi);
+	freeFrames.push(&frames[i]);
+    }
+
+    // read -> filter -> hough -> dye -> done
+    FrameQueue filterIn(queueSize);
+    FrameQueue houghIn(queueSize);
+    FrameQueue dyeIn(queueSize);
+    FrameQueue doneIn(queueSize);
+    std::thread reader(&LanePipeline::readFrames, this, inputs, &freeFrames, &filterIn);
+    std::thread filterStage(&LanePipeline::runStage, this, "filter", &LanePipeline::filter,
+			    &filterIn, &houghIn);
+    std::thread houghStage(&LanePipeline::runStage, this, "hough", &LanePipeline::hough,
+			   &houghIn, &dyeIn);
+    std::thread dyeStage(&LanePipeline::runStage, this, "dye", &LanePipeline::dye,
+			 &dyeIn, &doneIn);
+
+    int ret = 0;
+    LaneFrame *frame;
+    while(doneIn.pop(&frame)) {
+	frame->latency = frame->timer.nsecsElapsed();
+	if(frame->ret != 0) {
+	    ret = 1;
+	}
+	done(*frame);
+	freeFrames.push(frame);
+    }
+
+    reader.join();
+    filterStage.join();
+    houghStage.join();
+    dyeStage.join();
+    return ret;
+}
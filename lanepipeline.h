@@ -0,0 +1,122 @@
+#ifndef LANEPIPELINE_H
+#define LANEPIPELINE_H
+
+#include <QString>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <functional>
+#include <vector>
+#include "pgmimage.h"
+#include "boundedqueue.h"
+#include "lanetracker.h"
+
+/**
+  * one frame of the lane detection and its result
+  */
+struct LaneFrame {
+    long number; ///< number of the frame (from 0, over all inputs)
+    QString source; ///< input of the frame (file or "-" for stdin)
+    int ret; ///< 0 -> ok, otherwise error code of the failed stage
+    QString failedStage; ///< name of the failed stage
+    PgmImage image; ///< image of the frame (with lines and dyed lane when done)
+    std::vector<HoughLine> lines; ///< lines found by houghLD (most votes first)
+    int left; ///< index of the left lane line in lines (-1 -> not found)
+    int right; ///< index of the right lane line in lines (-1 -> not found)
+    FillResult lane; ///< dyed lane (area 0 -> seed not on the lane)
+    QElapsedTimer timer; ///< started when the frame is read
+    qint64 latency; ///< nanoseconds from read until the frame is done
+};
+
+/**
+  * lane detection on a sequence of frames (Gauss, convolutionLD, houghLD
+  * and dyeLD per frame)
+  *
+  * the frames are read from pgm files or from a stream of concatenated pgm
+  * images (stdin), every stage runs in an own thread and hands the frame
+  * over to the next stage in a bounded queue, so frame n can be dyed while
+  * frame n+1 is transformed and frame n+2 is filtered
+  * the frames are recycled, only one frame per stage and queue slot is in
+  * flight (a slow stage stops the reader instead of filling the memory)
+  */
+class LanePipeline
+{
+public:
+    /**
+      * function for a done frame (called in the thread of run, in the order
+      * of the frames)
+      */
+    typedef std::function<void(LaneFrame &frame)> FrameFunction;
+
+private:
+    typedef BoundedQueue<LaneFrame*> FrameQueue;
+
+    int queueSize; ///< frames per queue between two stages
+    bool tracking; ///< true -> lanes are tracked from frame to frame
+    LaneTracker tracker; ///< tracker of the lanes (used by the hough stage)
+    Roi roi; ///< region of interest of all frames
+    int **gaussKernel; ///< Gauss 7x7 (Sobel for vertical edges is built-in)
+
+    // stages (return 0 -> ok, otherwise error code)
+    int filter(LaneFrame *frame); ///< Gauss and convolutionLD
+    int hough(LaneFrame *frame); ///< houghLD and selection of the lane lines
+    int dye(LaneFrame *frame); ///< dyeLD
+
+    /**
+      * read all frames of the inputs into free frames
+      */
+    void readFrames(const QStringList &inputs, FrameQueue *freeFrames, FrameQueue *out);
+
+    /**
+      * run a stage for all frames of a queue (frames with an error pass)
+      */
+    void runStage(const char *name, int (LanePipeline::*stage)(LaneFrame*),
+                  FrameQueue *in, FrameQueue *out);
+
+    // the kernels are owned by the pipeline, so it cannot be copied
+    LanePipeline(const LanePipeline &);
+    LanePipeline &operator=(const LanePipeline &);
+
+public:
+    /**
+      * @param queueSize frames per queue between two stages (at least 1)
+      */
+    explicit LanePipeline(int queueSize = 2);
+    ~LanePipeline();
+
+    /**
+      * track the lanes from frame to frame (search only around the lanes of
+      * the last frame, full search if a lane is lost)
+      *
+      * @param enabled true -> track the lanes, false -> full search per frame
+      */
+    void setTracking(bool enabled) { tracking = enabled; }
+
+    /**
+      * set the region of interest of all frames (e.g. the road)
+      *
+      * @param region region of interest (whole image -> no restriction)
+      */
+    void setRoi(const Roi &region) { roi = region; }
+
+    /**
+      * get the tracker of the lanes (e.g. for its counters)
+      *
+      * @return  tracker of the lanes
+      */
+    const LaneTracker &laneTracker() const { return tracker; }
+
+    /**
+      * run the lane detection for all frames of the inputs, the call
+      * returns when the last frame is done
+      * with tracking all inputs are one video (the tracker starts empty)
+      *
+      * @param inputs pgm files, "-" reads a stream of pgm images from stdin
+      * @param done function for every done frame (also for failed frames)
+      * @return  0 -> all frames done
+      *          1 -> at least one frame or input failed
+      *         -4 -> out of memory
+      */
+    int run(const QStringList &inputs, const FrameFunction &done);
+};
+
+#endif // LANEPIPELINE_H
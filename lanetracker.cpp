@@ -0,0 +1,126 @@
+#include "lanetracker.h"
+#include <math.h>
+
+LaneTracker::LaneTracker() {
+    alpha = 0.5;
+    beta = 0.1;
+    thetaBand = 5;
+    rhoBand = 20;
+    maxMisses = 3;
+    searchInterval = 10;
+    reset();
+}
+
+void LaneTracker::reset() {
+    tracks.clear();
+    framesSinceSearch = searchInterval;
+    fullSearches = 0;
+    bandSearches = 0;
+}
+
+void LaneTracker::update(Track *track, const HoughLine *line) {
+    double rho = track->rho + track->rhoRate;
+    double theta = track->theta + track->thetaRate;
+    if(line != 0) {
+	// correct the prediction with the measurement
+	double rhoError = line->rho - rho;
+	double thetaError = line->theta - theta;
+	rho += alpha * rhoError;
+	theta += alpha * thetaError;
+	track->rhoRate += beta * rhoError;
+	track->thetaRate += beta * thetaError;
+	track->votes = line->votes;
+	track->misses = 0;
+    } else {
+	// keep the prediction, a lane without measurements is lost
+	track->votes = 0;
+	track->misses++;
+	if(track->misses > maxMisses) {
+	    track->valid = false;
+	    framesSinceSearch = searchInterval;
+	}
+    }
+    track->rho = rho;
+    track->theta = fmod(theta + 360, 360);
+}
+
+int LaneTracker::track(HoughTransform *hough, const ImageView &src, const HoughParameters &params,
+		       std::vector<HoughLine> *lines) {
+    if(tracks.size() != params.slopes.size()) {
+	Track lost = { false, 0, 0, 0, 0, 0, 0 };
+	tracks.assign(params.slopes.size(), lost);
+	framesSinceSearch = searchInterval;
+    }
+
+    // tracked lanes: small band around the prediction (on the grid of the
+    // full search), only the best counter of the band
+    std::vector<HoughLine> found;
+    for(size_t i = 0; i < tracks.size(); i++) {
+	Track &lane = tracks[i];
+	if(!lane.valid) {
+	    continue;
+	}
+	HoughParameters band = params;
+	int halfThetas = (int) ceil(thetaBand / params.thetaStep);
+	int halfRhos = (int) ceil(rhoBand / params.rhoStep);
+	double theta = lane.theta + lane.thetaRate;
+	double rho = lane.rho + lane.rhoRate;
+	band.thetaFirst = params.thetaFirst
+	    + (floor((theta - params.thetaFirst) / params.thetaStep + 0.5) - halfThetas) * params.thetaStep;
+	band.thetaCount = 2*halfThetas + 1;
+	band.rhoFirst = (floor(rho / params.rhoStep + 0.5) - halfRhos) * params.rhoStep;
+	band.rhoCount = 2*halfRhos + 1;
+	band.interval = params.interval < band.thetaCount ? params.interval : band.thetaCount;
+	band.maxLines = 1;
+	band.slopes.assign(1, params.slopes[i]);
+	if(hough->detect(src, band, &found) != 0) {
+	    return -1;
+	}
+	bandSearches++;
+	update(&lane, found.empty() ? 0 : &found[0]);
+    }
+
+    // lost lanes: full search (at once and then every searchInterval frames)
+    bool lost = false;
+    for(size_t i = 0; i < tracks.size(); i++) {
+	lost = lost || !tracks[i].valid;
+    }
+    if(lost && framesSinceSearch >= searchInterval) {
+	if(hough->detect(src, params, &found) != 0) {
+	    return -1;
+	}
+	fullSearches++;
+	framesSinceSearch = 0;
+
+	// start a track with the line with most votes of the lane
+	for(size_t i = 0; i < tracks.size(); i++) {
+	    if(tracks[i].valid) {
+		continue;
+	    }
+	    for(size_t l = 0; l < found.size(); l++) {
+		double radian = found[l].theta*M_PI/180;
+		if(sin(radian) == 0.0) {
+		    continue;
+		}
+		double m = (-1) * cos(radian) / sin(radian);
+		if(m > params.slopes[i].low && m < params.slopes[i].high) {
+		    Track lane = { true, found[l].rho, found[l].theta, 0, 0, found[l].votes, 0 };
+		    tracks[i] = lane;
+		    break;
+		}
+	    }
+	}
+    } else if(lost) {
+	framesSinceSearch++;
+    }
+
+    // estimates of the tracked lanes
+    lines->clear();
+    for(size_t i = 0; i < tracks.size(); i++) {
+	if(tracks[i].valid) {
+	    HoughLine line = { tracks[i].rho, tracks[i].theta, tracks[i].votes };
+	    lines->push_back(line);
+	}
+    }
+    return 0;
+}
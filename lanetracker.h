@@ -0,0 +1,85 @@
+#ifndef LANETRACKER_H
+#define LANETRACKER_H
+
+#include <vector>
+#include "hough.h"
+
+/**
+  * tracking of lane lines over the frames of a video
+  *
+  * every slope range of the Hough parameters is one lane with its own
+  * alpha-beta filter on rho and theta (position and change per frame)
+  * a tracked lane only votes in a small band of angles and rhos around its
+  * prediction, which needs a fraction of the full transformation
+  * a lane which is not found for some frames is lost and searched again in
+  * the whole accumulator (at once and then every searchInterval frames)
+  */
+class LaneTracker
+{
+public:
+    /**
+      * state of one lane
+      */
+    struct Track {
+        bool valid; ///< true -> lane is tracked
+        double rho; ///< estimated distance in pixels
+        double theta; ///< estimated angle in degree
+        double rhoRate; ///< change of rho per frame
+        double thetaRate; ///< change of theta per frame
+        int votes; ///< votes of the last measurement (0 -> predicted only)
+        int misses; ///< frames without a measurement in a row
+    };
+
+    double alpha; ///< weight of the measurement for the position (0 - 1)
+    double beta; ///< weight of the measurement for the change per frame (0 - 1)
+    double thetaBand; ///< half size of the angle band in degree
+    double rhoBand; ///< half size of the rho band in pixels
+    int maxMisses; ///< frames without a measurement until a lane is lost
+    int searchInterval; ///< frames between two full searches for lost lanes
+
+private:
+    std::vector<Track> tracks; ///< one track per slope range
+    int framesSinceSearch; ///< frames since the last full search
+    long fullSearches; ///< number of full searches
+    long bandSearches; ///< number of band searches
+
+    /**
+      * update a track with a measurement (or with the prediction only)
+      *
+      * @param track track to update
+      * @param line measured line (0 -> not found)
+      */
+    void update(Track *track, const HoughLine *line);
+
+public:
+    /**
+      * alpha 0.5, beta 0.1, band of +-5 degree and +-20 pixels, a lane is
+      * lost after 3 frames and searched every 10 frames
+      */
+    LaneTracker();
+
+    /**
+      * forget all lanes (e.g. for a new video)
+      */
+    void reset();
+
+    /**
+      * find the lanes of the next frame and update their tracks
+      *
+      * @param hough Hough transformation to use
+      * @param src image of the frame
+      * @param params parameters of the full search, one lane per slope range
+      * @param lines estimated lines of the tracked lanes (in the order of
+      *              the slope ranges, votes 0 -> predicted only)
+      * @return  0 -> lanes updated
+      *         -1 -> wrong parameters
+      */
+    int track(HoughTransform *hough, const ImageView &src, const HoughParameters &params,
+              std::vector<HoughLine> *lines);
+
+    const std::vector<Track> &lanes() const { return tracks; } ///< tracks of the lanes
+    long fullSearchCount() const { return fullSearches; } ///< number of full searches
+    long bandSearchCount() const { return bandSearches; } ///< number of band searches
+};
+
+#endif // LANETRACKER_H
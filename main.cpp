@@ -4,7 +4,6 @@
 
 /** TODO
  * -> global error codes
- * -> source kernel out
  * -> file headers
  */
 
@@ -15,6 +15,8 @@ MainWindow::MainWindow(PgmImage *pgmImage, QWidget *parent) :
     connect(ui->btnLoad,SIGNAL(clicked()),this,SLOT(load()));
     connect(ui->btnHistogram,SIGNAL(clicked()),this,SLOT(histogram()));
     connect(ui->btnInvert,SIGNAL(clicked()),this,SLOT(invert()));
+    connect(ui->btnEqualize,SIGNAL(clicked()),this,SLOT(equalize()));
+    connect(ui->btnThreshold,SIGNAL(clicked()),this,SLOT(threshold()));
     connect(ui->btnConvolution,SIGNAL(clicked()),this,SLOT(convolution()));
     connect(ui->btnHough,SIGNAL(clicked()),this,SLOT(hough()));
     connect(ui->btnSave,SIGNAL(clicked()),this,SLOT(save()));
@@ -25,6 +27,10 @@ MainWindow::MainWindow(PgmImage *pgmImage, QWidget *parent) :
 
     // init other things
     rotateKernel = false;
+    useBuiltin = false;
+    builtin = Kernels::Sobel;
+    filter = NoFilter;
+    compassOperator = Compass::Kirsch;
 }
 
 MainWindow::~MainWindow() {
@@ -55,7 +61,7 @@ void MainWindow::load() {
 	    statusBar()->showMessage("cannot handle this pgm file");
 	    break;
 	case -4:
-	    statusBar()->showMessage("error while writing temporary file");
+	    statusBar()->showMessage("out of memory");
 	    break;
 	default:
 	    statusBar()->showMessage("unkown error while loading image");
@@ -64,12 +70,13 @@ void MainWindow::load() {
     }
 
     // show image
-    QPixmap pixmap(pgmImage->getTmpFilePath());
-    ui->imageLabel->setPixmap(pixmap);
+    showImage();
 
     // enable the other buttons
     ui->btnHistogram->setEnabled(true);
     ui->btnInvert->setEnabled(true);
+    ui->btnEqualize->setEnabled(true);
+    ui->btnThreshold->setEnabled(true);
     ui->btnSave->setEnabled(true);
     ui->btnConvolution->setEnabled(true);
     ui->btnHough->setEnabled(true);
@@ -89,8 +96,7 @@ void MainWindow::histogram() {
     }
 
     // show chart
-    QPixmap pixmap(pgmImage->getTmpFilePath());
-    ui->imageLabel->setPixmap(pixmap);
+    showImage();
 
     statusBar()->showMessage("histogram created successfully",3000);
 }
@@ -104,8 +110,33 @@ void MainWindow::invert() {
     } else {
 	statusBar()->showMessage("image inverted successfully",3000);
 	// show image
-	QPixmap pixmap(pgmImage->getTmpFilePath());
-	ui->imageLabel->setPixmap(pixmap);
+	showImage();
+    }
+}
+
+void MainWindow::equalize() {
+    statusBar()->showMessage("equalize histogram");
+
+    // equalize image
+    if(pgmImage->equalize() != 0) {
+	statusBar()->showMessage("error while equalizing histogram");
+    } else {
+	statusBar()->showMessage("histogram equalized successfully",3000);
+	// show image
+	showImage();
+    }
+}
+
+void MainWindow::threshold() {
+    statusBar()->showMessage("binarize image");
+
+    // binarize image with the threshold of Otsu
+    if(pgmImage->threshold() != 0) {
+	statusBar()->showMessage("error while binarizing image");
+    } else {
+	statusBar()->showMessage("image binarized successfully",3000);
+	// show image
+	showImage();
     }
 }
 
@@ -118,21 +149,51 @@ void MainWindow::convolution() {
 	return;
     }
 
-    // covolution between the image and the given matrix
-    if(pgmImage->convolution(kernel, kSize, rotateKernel) != 0) {
+    // filters have no kernel
+    if(filter != NoFilter) {
+	int ret;
+	if(filter == BoxFilter) {
+	    ret = pgmImage->box(kSize);
+	} else if(filter == MedianFilter) {
+	    ret = pgmImage->median(kSize);
+	} else if(filter == CompassFilter) {
+	    ret = pgmImage->compass(compassOperator);
+	} else if(filter == CannyFilter) {
+	    ret = pgmImage->canny();
+	} else {
+	    ret = pgmImage->bilateral(kSize);
+	}
+	if(ret != 0) {
+	    statusBar()->showMessage("error while filtering");
+	    return;
+	}
+	showImage();
+	statusBar()->showMessage("filter calculated successfully",3000);
+	return;
+    }
+
+    // covolution between the image and the given matrix (or built-in kernel)
+    int ret;
+    if(useBuiltin) {
+	ret = pgmImage->convolution(builtin);
+    } else {
+	ret = pgmImage->convolution(kernel, kSize, rotateKernel);
+    }
+    if(ret != 0) {
 	statusBar()->showMessage("error while calculating convolution");
 	return;
     }
 
     // free memory
-    for(int i = 0; i < kSize; i++){
-	free(kernel[i]);
+    if(!useBuiltin) {
+	for(int i = 0; i < kSize; i++){
+	    free(kernel[i]);
+	}
+	free(kernel);
     }
-    free(kernel);
 
-    // show chart
-    QPixmap pixmap(pgmImage->getTmpFilePath());
-    ui->imageLabel->setPixmap(pixmap);
+    // show image
+    showImage();
 
     statusBar()->showMessage("convolution calculated successfully",3000);
 }
@@ -146,11 +207,15 @@ void MainWindow::hough() {
     } else {
 	statusBar()->showMessage("Hough transformation complete",3000);
 	// show image
-	QPixmap pixmap(pgmImage->getTmpFilePath());
-	ui->imageLabel->setPixmap(pixmap);
+	showImage();
     }
 }
 
+void MainWindow::showImage() {
+    // the image shares its pixels with pgmImage, no temporary file needed
+    ui->imageLabel->setPixmap(QPixmap::fromImage(pgmImage->getImage()));
+}
+
 void MainWindow::save() {
     statusBar()->showMessage("save");
 
@@ -174,6 +239,10 @@ int MainWindow::generateKernel() {
     items << tr("Laplacian of the Gaussian (5x5)");
     items << tr("Prewitt 1 (rotating)") << tr("Prewitt 2 (rotating)");
     items << tr("Sobel (rotating)") << tr("other");
+    items << tr("Box (up to 51x51)") << tr("Median (up to 51x51)");
+    items << tr("Bilateral (up to 51x51)");
+    items << tr("Compass Kirsch (8 directions)") << tr("Compass Prewitt (8 directions)");
+    items << tr("Compass Robinson (8 directions)") << tr("Canny (edge map)");
 
     // ask user
     bool ok;
@@ -183,6 +252,8 @@ int MainWindow::generateKernel() {
 	return -1;
     }
     statusBar()->showMessage("choosen " + item);
+    filter = NoFilter;
+    useBuiltin = false;
 
     // interpret data
     switch(items.indexOf(item)) {
@@ -207,6 +278,28 @@ int MainWindow::generateKernel() {
     case 6: //other
 	return kernelOther();
 	break;
+    case 7: //Box
+	return kernelFilter(BoxFilter);
+	break;
+    case 8: //Median
+	return kernelFilter(MedianFilter);
+	break;
+    case 9: //Bilateral
+	return kernelFilter(BilateralFilter);
+	break;
+    case 10: //Compass Kirsch
+	return kernelCompass(Compass::Kirsch);
+	break;
+    case 11: //Compass Prewitt
+	return kernelCompass(Compass::Prewitt);
+	break;
+    case 12: //Compass Robinson
+	return kernelCompass(Compass::Robinson);
+	break;
+    case 13: //Canny
+	// default thresholds, no kernel and no window size
+	filter = CannyFilter;
+	break;
     default:
 	return -1;
     }
@@ -223,32 +316,7 @@ int MainWindow::kernelGauss() {
     mallocKernel();
 
     // init table with Gauss
-    // init borders (top left quarter)
-    kernel[0][0] = 1;
-    for(int i = 1; i < (kSize+1)/2; i++) {
-	kernel[0][i] = kernel[0][i-1] * 2;
-	kernel[i][0] = kernel[0][i-1] * 2;
-    }
-    // init the rest on top left quarter
-    for(int row = 1; row < (kSize+1)/2; row++) {
-	for(int col = 1; col < (kSize+1)/2; col++) {
-	    kernel[col][row] = kernel[row-1][col] * 2;
-	    kernel[row][col] = kernel[row-1][col] * 2;
-	}
-    }
-    // mirror this quarter to the others
-    for(int row = 0; row < (kSize-1)/2; row++) {
-	for(int col = 0; col < (kSize-1)/2; col++) {
-	    kernel[kSize-1-col][row] = kernel[row][col];
-	    kernel[col][kSize-1-row] = kernel[row][col];
-	    kernel[kSize-1-col][kSize-1-row] = kernel[row][col];
-	}
-    }
-    // fill the rest (borders of the bottom right quarter)
-    for(int i = 0; i < (kSize-1)/2; i++) {
-	kernel[kSize-1-i][(kSize-1)/2] = kernel[i][(kSize-1)/2];
-	kernel[(kSize-1)/2][kSize-1-i] = kernel[i][(kSize-1)/2];
-    }
+    Kernels::gauss(kernel, kSize);
 
     // this kernel is a non-rotating kernel
     rotateKernel = false;
@@ -256,89 +324,55 @@ int MainWindow::kernelGauss() {
 }
 
 int MainWindow::kernelKirsch() {
-    // set size of kernel
-    kSize = 3;
-
-    // allocate memory for kernel
-    mallocKernel();
-
-    // init kernel
-    kernel[0][0] =  5; kernel[0][1] =  5; kernel[0][2] =  5;
-    kernel[1][0] = -3; kernel[1][1] =  0; kernel[1][2] = -3;
-    kernel[2][0] = -3; kernel[2][1] = -3; kernel[2][2] = -3;
-
-    // this kernel is a rotating kernel
-    rotateKernel = true;
+    // built-in kernel (rotating), no matrix needed
+    builtin = Kernels::Kirsch;
+    useBuiltin = true;
     return 0;
 }
 
 int MainWindow::kernelLaplace() {
-    // set size of kernel
-    kSize = 5;
-
-    // allocate memory for kernel
-    mallocKernel();
-
-    // init kernel
-    kernel[0][0] =  0; kernel[0][1] =  0; kernel[0][2] = -1; kernel[0][3] =  0; kernel[0][4] =  0;
-    kernel[1][0] =  0; kernel[1][1] = -1; kernel[1][2] = -2; kernel[1][3] = -1; kernel[1][4] =  0;
-    kernel[2][0] = -1; kernel[2][1] = -2; kernel[2][2] = 16; kernel[2][3] = -2; kernel[2][4] = -1;
-    kernel[3][0] =  0; kernel[3][1] = -1; kernel[3][2] = -2; kernel[3][3] = -1; kernel[3][4] =  0;
-    kernel[4][0] =  0; kernel[4][1] =  0; kernel[4][2] = -1; kernel[4][3] =  0; kernel[4][4] =  0;
-
-    // this kernel is a non-rotating kernel
-    rotateKernel = false;
+    // built-in kernel (non-rotating), no matrix needed
+    builtin = Kernels::Laplace;
+    useBuiltin = true;
     return 0;
 }
 
 int MainWindow::kernelPrewitt1() {
-    // set size of kernel
-    kSize = 3;
-
-    // allocate memory for kernel
-    mallocKernel();
-
-    // init kernel
-    kernel[0][0] =  1; kernel[0][1] =  1; kernel[0][2] =  1;
-    kernel[1][0] =  1; kernel[1][1] = -2; kernel[1][2] =  1;
-    kernel[2][0] = -1; kernel[2][1] = -1; kernel[2][2] = -1;
-
-    // this kernel is a rotating kernel
-    rotateKernel = true;
+    // built-in kernel (rotating), no matrix needed
+    builtin = Kernels::Prewitt1;
+    useBuiltin = true;
     return 0;
 }
 
 int MainWindow::kernelPrewitt2() {
-    // set size of kernel
-    kSize = 3;
-
-    // allocate memory for kernel
-    mallocKernel();
-
-    // init kernel
-    kernel[0][0] =  1; kernel[0][1] =  1; kernel[0][2] =  1;
-    kernel[1][0] =  0; kernel[1][1] =  0; kernel[1][2] =  0;
-    kernel[2][0] = -1; kernel[2][1] = -1; kernel[2][2] = -1;
-
-    // this kernel is a rotating kernel
-    rotateKernel = true;
+    // built-in kernel (rotating), no matrix needed
+    builtin = Kernels::Prewitt2;
+    useBuiltin = true;
     return 0;
 }
 
 int MainWindow::kernelSobel() {
-    // set size of kernel
-    kSize = 3;
+    // built-in kernel (rotating), no matrix needed
+    builtin = Kernels::Sobel;
+    useBuiltin = true;
+    return 0;
+}
 
-    // allocate memory for kernel
-    mallocKernel();
+int MainWindow::kernelFilter(Filter type) {
+    // ask user for the size of the window
+    if(sizeOfFilter() != 0) {
+	return -1; //filter canceled
+    }
 
-    // init kernel
-    kernel[0][0] =  1; kernel[0][1] =  2; kernel[0][2] =  1;
-    kernel[1][0] =  0; kernel[1][1] =  0; kernel[1][2] =  0;
-    kernel[2][0] = -1; kernel[2][1] = -2; kernel[2][2] = -1;
+    // no kernel, the image calculates the filter
+    filter = type;
+    return 0;
+}
 
-    // this kernel is a rotating kernel
-    rotateKernel = true;
+int MainWindow::kernelCompass(Compass::Operator op) {
+    // all 8 directions of the mask, no kernel and no window size
+    filter = CompassFilter;
+    compassOperator = op;
     return 0;
 }
 
@@ -382,6 +416,22 @@ int MainWindow::sizeOfKernel() {
     return 0;
 }
 
+int MainWindow::sizeOfFilter() {
+    bool ok;
+    kSize = QInputDialog::getInt(this,	tr("Size of the filter"),
+					tr("Size of the filter window:"),
+					3, 3, 51, 2, &ok);
+    if (!ok) {
+	return -1;
+    }
+
+    // only odd values
+    if((kSize % 2) != 1) {
+	kSize -= 1;
+    }
+    return 0;
+}
+
 int MainWindow::contentOfKernel() {
     // create dialog with layout
     QDialog dialog(this);
@@ -468,32 +518,7 @@ void MainWindow::laneDetection() {
     mallocKernel();
 
     // init table with Gauss
-    // init borders (top left quarter)
-    kernel[0][0] = 1;
-    for(int i = 1; i < (kSize+1)/2; i++) {
-	kernel[0][i] = kernel[0][i-1] * 2;
-	kernel[i][0] = kernel[0][i-1] * 2;
-    }
-    // init the rest on top left quarter
-    for(int row = 1; row < (kSize+1)/2; row++) {
-	for(int col = 1; col < (kSize+1)/2; col++) {
-	    kernel[col][row] = kernel[row-1][col] * 2;
-	    kernel[row][col] = kernel[row-1][col] * 2;
-	}
-    }
-    // mirror this quarter to the others
-    for(int row = 0; row < (kSize-1)/2; row++) {
-	for(int col = 0; col < (kSize-1)/2; col++) {
-	    kernel[kSize-1-col][row] = kernel[row][col];
-	    kernel[col][kSize-1-row] = kernel[row][col];
-	    kernel[kSize-1-col][kSize-1-row] = kernel[row][col];
-	}
-    }
-    // fill the rest (borders of the bottom right quarter)
-    for(int i = 0; i < (kSize-1)/2; i++) {
-	kernel[kSize-1-i][(kSize-1)/2] = kernel[i][(kSize-1)/2];
-	kernel[(kSize-1)/2][kSize-1-i] = kernel[i][(kSize-1)/2];
-    }
+    Kernels::gauss(kernel, kSize);
 
     // this kernel is a non-rotating kernel
     rotateKernel = false;
@@ -510,36 +535,14 @@ void MainWindow::laneDetection() {
     }
     free(kernel);
 
-    // SOBEL (vertical)
-    // set size of kernel
-    kSize = 3;
-
-    // allocate memory for kernel
-    mallocKernel();
-
-    // init kernel
-    kernel[0][0] =  1; kernel[0][1] =  0; kernel[0][2] = -1;
-    kernel[1][0] =  2; kernel[1][1] =  0; kernel[1][2] = -2;
-    kernel[2][0] =  1; kernel[2][1] =  0; kernel[2][2] = -1;
-
-    // this kernel is a non-rotating kernel
-    rotateKernel = false;
-
-    // covolution between the image and the given matrix
-    if(pgmImage->convolutionLD(kernel, kSize, rotateKernel) != 0) {
+    // SOBEL (vertical, built-in non-rotating kernel)
+    if(pgmImage->convolutionLD(Kernels::SobelVertical) != 0) {
 	statusBar()->showMessage("error while calculating convolution");
 	return;
     }
 
-    // free memory
-    for(int i = 0; i < kSize; i++){
-	free(kernel[i]);
-    }
-    free(kernel);
-
     // show image
-    QPixmap pixmap(pgmImage->getTmpFilePath());
-    ui->imageLabel->setPixmap(pixmap);
+    showImage();
 
     statusBar()->showMessage("lane detection complete",3000);
 }
@@ -554,8 +557,7 @@ void MainWindow::laneDetection2() {
     }
 
     // show image
-    QPixmap pixmap(pgmImage->getTmpFilePath());
-    ui->imageLabel->setPixmap(pixmap);
+    showImage();
 }
 
 void MainWindow::laneDetection3() {
@@ -568,8 +570,7 @@ void MainWindow::laneDetection3() {
     }
 
     // show image
-    QPixmap pixmap(pgmImage->getTmpFilePath());
-    ui->imageLabel->setPixmap(pixmap);
+    showImage();
 
     statusBar()->showMessage("lane detection complete",3000);
 }
@@ -612,6 +613,5 @@ void MainWindow::railDetection() {
     }
 
     // show image
-    QPixmap pixmap(pgmImage->getTmpFilePath());
-    ui->imageLabel->setPixmap(pixmap);
+    showImage();
 }
@@ -9,6 +9,7 @@
 #include <QStandardItemModel>
 #include <QMessageBox>
 #include "pgmimage.h"
+#include "kernels.h"
 
 namespace Ui {
     class MainWindow;
@@ -29,6 +30,11 @@ private:
     int** kernel;
     int kSize; ///< size of kernel
     bool rotateKernel;
+    bool useBuiltin; ///< true -> built-in kernel instead of kernel
+    Kernels::Builtin builtin; ///< chosen built-in kernel (applied with its stencil)
+    enum Filter { NoFilter, BoxFilter, MedianFilter, BilateralFilter, CompassFilter, CannyFilter };
+    Filter filter; ///< chosen filter (window size kSize) instead of a kernel
+    Compass::Operator compassOperator; ///< mask of the compass filter
     int generateKernel(); ///< ask user for type of kernel
     int kernelFreiChen(); ///< user chose "Frei & Chen" kernel
     int kernelGauss(); ///< user chose "Gauss" kernel
@@ -37,15 +43,21 @@ private:
     int kernelPrewitt1(); ///< user chose "Prewitt 1" kernel
     int kernelPrewitt2(); ///< user chose "Prewitt 2" kernel
     int kernelSobel(); ///< user chose "Sobel" kernel
+    int kernelFilter(Filter type); ///< user chose "Box", "Median" or "Bilateral" filter
+    int kernelCompass(Compass::Operator op); ///< user chose a "Compass" operator
     int kernelOther(); ///< user chose "other" kernel
     int sizeOfKernel(); ///< ask user for size of kernel
+    int sizeOfFilter(); ///< ask user for size of the filter window
     int contentOfKernel(); ///< ask user for content of kernel
     void mallocKernel(); ///< allocate memory for kernel
+    void showImage(); ///< show the current image of pgmImage
 
 private slots:
     void load(); ///< load a pgm image and show it
     void histogram(); ///< create a histogram of the pgm image and show it
     void invert(); ///< invert the pgm image and show it
+    void equalize(); ///< equalize the histogram of the pgm image and show it
+    void threshold(); ///< binarize the pgm image (Otsu) and show it
     void convolution(); ///< convolution between the image and a matrix
     void hough(); ///< Hough transformation
     void laneDetection(); ///< Lane detection part 1
@@ -0,0 +1,182 @@
+#include "pgmformat.h"
+#include <string.h>
+
+/**
+  * check for whitespace as defined by the Netpbm format
+  */
+static bool isSpace(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+  * skip whitespace and comments (# until the end of the line)
+  *
+  * @return  position of the next token
+  */
+static size_t skipSpace(const uint8_t *data, size_t pos, size_t size) {
+    while(pos < size) {
+	if(data[pos] == '#') {
+	    while(pos < size && data[pos] != '\n' && data[pos] != '\r') {
+		pos++;
+	    }
+	} else if(isSpace(data[pos])) {
+	    pos++;
+	} else {
+	    break;
+	}
+    }
+    return pos;
+}
+
+/**
+  * read an unsigned decimal number
+  *
+  * @return  0 -> number read
+  *         -3 -> no number or number too big
+  *         -5 -> end of data reached
+  */
+static int readNumber(const uint8_t *data, size_t *pos, size_t size, int *value) {
+    size_t p = skipSpace(data, *pos, size);
+    if(p >= size) {
+	return -5;
+    }
+    if(data[p] < '0' || data[p] > '9') {
+	return -3;
+    }
+    long number = 0;
+    while(p < size && data[p] >= '0' && data[p] <= '9') {
+	number = number * 10 + (data[p] - '0');
+	if(number > 0x7fffffff) {
+	    return -3;
+	}
+	p++;
+    }
+    *value = (int) number;
+    *pos = p;
+    return 0;
+}
+
+PgmFormat::PgmFormat() {
+    magic = 0;
+    width = 0;
+    height = 0;
+    maxValue = 0;
+    dataOffset = 0;
+    dataSize = 0;
+}
+
+int PgmFormat::parseHeader(const uint8_t *data, size_t size) {
+    // magic number
+    if(size < 2) {
+	return -5;
+    }
+    if(data[0] != 'P' || (data[1] != '2' && data[1] != '5')) {
+	return -2;
+    }
+    magic = data[1] - '0';
+
+    // width, height and max value of a pixel
+    size_t pos = 2;
+    int ret;
+    if((ret = readNumber(data, &pos, size, &width)) != 0
+       || (ret = readNumber(data, &pos, size, &height)) != 0
+       || (ret = readNumber(data, &pos, size, &maxValue)) != 0) {
+	return ret == -3 ? -2 : ret;
+    }
+    if(width <= 0 || height <= 0 || maxValue <= 0 || maxValue > 65535) {
+	return -3;
+    }
+
+    // exactly one whitespace between header and pixels
+    if(pos >= size) {
+	return -5;
+    }
+    if(!isSpace(data[pos])) {
+	return -2;
+    }
+    dataOffset = pos + 1;
+
+    // size of the pixels (binary format)
+    dataSize = 0;
+    if(magic == 5) {
+	dataSize = (size_t) width * height * (maxValue > 255 ? 2 : 1);
+    }
+    return 0;
+}
+
+int PgmFormat::decode(const uint8_t *data, size_t size, const ImageView &dst) const {
+    // lookup table to scale small max values (P5 with 8 bit)
+    uint8_t scale[256];
+    for(int i = 0; i < 256; i++) {
+	scale[i] = i > maxValue ? 255 : (uint8_t) ((i * 255 + maxValue / 2) / maxValue);
+    }
+
+    if(magic == 5) {
+	if(size < dataOffset + dataSize) {
+	    return -3;
+	}
+	const uint8_t *src = data + dataOffset;
+	for(int y = 0; y < height; y++) {
+	    uint8_t *row = dst.row(y);
+	    if(maxValue == 255) {
+		memcpy(row, src, width);
+		src += width;
+	    } else if(maxValue < 256) {
+		for(int x = 0; x < width; x++) {
+		    row[x] = scale[*src++];
+		}
+	    } else {
+		// 16 bit, most significant byte first
+		for(int x = 0; x < width; x++) {
+		    unsigned int value = (src[0] << 8) | src[1];
+		    if(value > (unsigned int) maxValue) {
+			value = maxValue;
+		    }
+		    row[x] = (uint8_t) ((value * 255 + maxValue / 2) / maxValue);
+		    src += 2;
+		}
+	    }
+	}
+	return 0;
+    }
+
+    // plain format: decimal numbers separated by whitespace
+    size_t pos = dataOffset;
+    for(int y = 0; y < height; y++) {
+	uint8_t *row = dst.row(y);
+	for(int x = 0; x < width; x++) {
+	    int value;
+	    if(readNumber(data, &pos, size, &value) != 0) {
+		return -3;
+	    }
+	    if(value > maxValue) {
+		value = maxValue;
+	    }
+	    row[x] = (uint8_t) (((long) value * 255 + maxValue / 2) / maxValue);
+	}
+    }
+    return 0;
+}
+
+int PgmFormat::imageSize(const uint8_t *data, size_t size, size_t *frameSize) const {
+    if(magic == 5) {
+	*frameSize = dataOffset + dataSize;
+	return size < *frameSize ? -5 : 0;
+    }
+
+    // plain format: skip all numbers, the last one must be complete
+    size_t pos = dataOffset;
+    long count = (long) width * height;
+    for(long i = 0; i < count; i++) {
+	int value;
+	int ret = readNumber(data, &pos, size, &value);
+	if(ret != 0) {
+	    return ret;
+	}
+    }
+    if(pos >= size) {
+	return -5;
+    }
+    *frameSize = pos;
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef PGMFORMAT_H
+#define PGMFORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "imageplane.h"
+
+/**
+  * header of a pgm image (Netpbm format P2 or P5) and the decoder for its
+  * pixels, works on a complete image in memory (e.g. a mapped file)
+  */
+class PgmFormat
+{
+public:
+    int magic; ///< 2 -> plain pgm (P2, ASCII), 5 -> raw pgm (P5, binary)
+    int width; ///< width of the image
+    int height; ///< height of the image
+    int maxValue; ///< maximal gray value (1 - 65535)
+    size_t dataOffset; ///< offset of the first pixel after the header
+    size_t dataSize; ///< size of the pixels in bytes (only for P5)
+
+    PgmFormat();
+
+    /**
+      * parse the header of a pgm image
+      * comments (#) and arbitrary whitespace are allowed between the fields
+      *
+      * @param data first byte of the image
+      * @param size size of the available data
+      * @return  0 -> header parsed successfully
+      *         -2 -> no pgm file-format
+      *         -3 -> cannot handle this pgm file
+      *         -5 -> header is incomplete (more data needed)
+      */
+    int parseHeader(const uint8_t *data, size_t size);
+
+    /**
+      * check if the pixels can be used as they are (P5 with 8 bit per pixel
+      * and maximal gray value 255)
+      *
+      * @return  true -> no decoding needed
+      */
+    bool isDirect() const { return magic == 5 && maxValue == 255; }
+
+    /**
+      * decode the pixels to 8 bit gray values (scaled to 0 - 255)
+      *
+      * @param data first byte of the image (not of the pixels)
+      * @param size size of the available data
+      * @param dst allocated image with the size of the pgm image
+      * @return  0 -> pixels decoded successfully
+      *         -3 -> pixel data is incomplete or invalid
+      */
+    int decode(const uint8_t *data, size_t size, const ImageView &dst) const;
+
+    /**
+      * get the size of the whole image (header and pixels), needed to find
+      * the next image in a stream of concatenated images
+      *
+      * @param data first byte of the image (not of the pixels)
+      * @param size size of the available data
+      * @param frameSize size of the image in bytes
+      * @return  0 -> size found
+      *         -3 -> pixel data is invalid
+      *         -5 -> image is incomplete (more data needed)
+      */
+    int imageSize(const uint8_t *data, size_t size, size_t *frameSize) const;
+};
+
+#endif // PGMFORMAT_H
@@ -1,19 +1,54 @@
 #include "pgmimage.h"
+#include "pgmformat.h"
+#include "convolution.h"
+#include "threadpool.h"
+#include "raster.h"
+#include "pointops.h"
+#include <vector>
+#include <string.h>
 
 PgmImage::PgmImage() {
     tmpFile = new QTemporaryFile();
+    mappedFile = 0;
+    mappedData = 0;
     imageHeight = 0;
     imageWidth = 0;
+    chartShown = false;
+    overlayUsed = false;
+    responseShift = 0;
+    responseBound = 255;
+    responsePending = false;
 }
 
-PgmImage::~PgmImage() {
-    // free imageData memory
-    if(imageHeight > 0) {
-	for(int i = 0; i < imageHeight; i++){
-	    free(imageData[i]);
-	}
-	free(imageData);
+/**
+  * get the whole part of a fixed point value (cut towards zero like an
+  * integer division, negative values get 2^shift - 1 before the shift)
+  */
+static inline int wholePart(int value, int shift) {
+    return (value + ((value >> 31) & ((1 << shift) - 1))) >> shift;
+}
+
+/**
+  * get the most fraction bits of a 16 bit fixed point value
+  *
+  * @param bound maximal absolute value
+  * @return  fraction bits (-1 -> bound does not fit in 16 bit)
+  */
+static int fractionBits(long long bound) {
+    if(bound > 32767) {
+	return -1;
+    }
+    int shift = 0;
+    while(shift < 14 && (bound << (shift+1)) <= 32767) {
+	shift++;
     }
+    return shift;
+}
+
+PgmImage::~PgmImage() {
+    // the image may point into the mapped file
+    image.release();
+    unmapFile();
 
     // close and delete tmpFile
     tmpFile->close();
@@ -21,297 +56,516 @@ PgmImage::~PgmImage() {
 }
 
 int PgmImage::loadPgm(QString path) {
-    QString str;
-    QStringList strList;
-    char headerLine[200];
-
     // open original image
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly)) {
+    QFile *file = new QFile(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+	delete file;
 	return -1;
     }
 
+    // map the whole file, read it at once if it cannot be mapped
+    QByteArray content;
+    qint64 size = file->size();
+    uchar *mapping = size > 0 ? file->map(0, size) : 0;
+    const uint8_t *data = mapping;
+    if(mapping == 0) {
+	content = file->readAll();
+	data = (const uint8_t*) content.constData();
+	size = content.size();
+    }
+
     // read header
-    // magic number
-    file.readLine(headerLine, 5);
-    if (QString::compare("P5\n",headerLine,Qt::CaseSensitive) != 0) {
-	return -2;
+    PgmFormat format;
+    int ret = format.parseHeader(data, size);
+    if(ret != 0) {
+	delete file;
+	return ret == -2 ? -2 : -3;
     }
-    // comments
-    while(true) {
-	file.readLine(headerLine, 200);
-	if (QString::compare("#",QString(headerLine[0]),Qt::CaseSensitive) != 0) {
 
-	    // width and height
-	    str = headerLine;
-	    strList = str.split(" ");
-	    if(strList.size() != 2) {
-		return -2;
-	    }
-	    this->imageWidth = strList.at(0).toInt();
-	    this->imageHeight = strList.at(1).toInt();
-	    break;
+    if(format.isDirect()) {
+	if((qint64) (format.dataOffset + format.dataSize) > size) {
+	    delete file;
+	    return -3;
 	}
-    }
-    // max value of a pixel
-    file.readLine(headerLine, 5);
-    if (QString::compare("255\n",headerLine,Qt::CaseSensitive) != 0) {
-	return -3;
-    }
 
-    // read data
-    imageData = (char**) malloc(sizeof(char*) * imageHeight);
-    for(int i = 0; i < imageHeight; i++){
-	imageData[i] = (char*) malloc(sizeof(char) * imageWidth);
-	file.read(imageData[i], imageWidth);
+	// use the pixels in the file without a copy
+	image.release();
+	unmapFile();
+	mappedFile = file;
+	mappedData = mapping;
+	fileContent = content;
+	image.wrap(data + format.dataOffset, format.width, format.height, format.width);
+    } else {
+	// decode the pixels (one allocation for the whole image)
+	if(image.allocate(format.width, format.height) != 0) {
+	    delete file;
+	    return -4;
+	}
+	unmapFile();
+	ret = format.decode(data, size, image.view());
+	delete file;
+	if(ret != 0) {
+	    image.release();
+	    imageWidth = 0;
+	    imageHeight = 0;
+	    return -3;
+	}
     }
+    imageWidth = format.width;
+    imageHeight = format.height;
+    clearOverlay();
+    responsePending = false;
 
-    // close file
-    file.close();
-
-    // save it in temporary file
-    if(saveInTmpPgm() != 0) {
-	return -4;
-    }
+    showImage();
     return 0;
 }
 
-int PgmImage::histogram() {
+int PgmImage::loadPgm(const uint8_t *data, size_t size) {
+    // read header
+    PgmFormat format;
+    int ret = format.parseHeader(data, size);
+    if(ret != 0) {
+	return ret == -2 ? -2 : -3;
+    }
 
-    // create and clean a array for the histogram data
-    int histogramData[256];
-    for(int i = 0; i < 256; i++) {
-	histogramData[i] = 0;
+    // decode the pixels into an own buffer (reused for images of same size)
+    if(image.allocate(format.width, format.height) != 0) {
+	return -4;
     }
+    unmapFile();
+    if(format.decode(data, size, image.view()) != 0) {
+	image.release();
+	imageWidth = 0;
+	imageHeight = 0;
+	return -3;
+    }
+    imageWidth = format.width;
+    imageHeight = format.height;
+    clearOverlay();
+    responsePending = false;
+
+    showImage();
+    return 0;
+}
 
-    // analyse data and count this pixels in array
-    for(int i = 0; i < imageHeight; i++) {
-	for(int j = 0; j < imageWidth; j++) {
-	    histogramData[(unsigned char) imageData[i][j]]++;
+void PgmImage::unmapFile() {
+    if(mappedFile != 0) {
+	if(mappedData != 0) {
+	    mappedFile->unmap(mappedData);
 	}
+	mappedFile->close();
+	delete mappedFile;
     }
+    mappedFile = 0;
+    mappedData = 0;
+    fileContent.clear();
+}
 
-    // search for maximum pixel count
-    int max = 0;
-    for(int i = 0; i < 256; i++) {
-	if(histogramData[i] > max) {
-	    max = histogramData[i];
-	}
+int PgmImage::histogram() {
+    if(materialize() != 0) {
+	return -4;
     }
 
+    // count the pixels of the region
+    roi.prepare(imageWidth, imageHeight);
+    imageHistogram.compute(image.constView(), &roi);
+    int max = imageHistogram.maxCount();
+
     // create chart with width 256 and height 500
     // width is the gray-value
     // height is the count of pixel with this value
-    char **histogramChart;
-    histogramChart = (char**) malloc(sizeof(char*) * 500);
-    for(int i = 0; i < 500; i++){
-	histogramChart[i] = (char*) malloc(sizeof(char) * 256);
+    if(chart.allocate(256, 500) != 0) {
+	return -4;
     }
 
-    // go column by column throught the chart
+    // height of every column, then the chart row by row: white above the
+    // column, black in the column
+    int heights[256];
     for(int i = 0; i < 256; i++) {
-	// fill the upper part with white bytes
-	for(int j = 0; j < 500 - histogramData[i]*500/max; j++) {
-	    histogramChart[j][i] = (unsigned char) 255;
-	}
-	// fill the lower part with black bytes
-	for(int j = 500 - histogramData[i]*500/max +1; j < 500; j++) {
-	    histogramChart[j][i] = (unsigned char) 0;
+	heights[i] = max > 0 ? (int) ((long long) imageHistogram.count(i) * 500 / max) : 0;
+    }
+    for(int j = 0; j < 500; j++) {
+	uint8_t *row = chart.row(j);
+	for(int i = 0; i < 256; i++) {
+	    row[i] = j < 500 - heights[i] ? 255 : 0;
 	}
     }
 
-    // save the chart in the tmpFile
-    int ret = saveInTmpPgm(histogramChart, 256, 500);
+    // show the chart instead of the image
+    chartShown = true;
+    return 0;
+}
 
-    // free memory
-    for(int i = 0; i < 500; i++){
-	free(histogramChart[i]);
+int PgmImage::invert() {
+    if(materialize() != 0 || image.writable() != 0) {
+	return -4;
     }
-    free(histogramChart);
 
-    return ret;
+    // invert data of the region (16 pixels at a time)
+    roi.prepare(imageWidth, imageHeight);
+    PointOps::apply(image.view(), roi, PointOps::Invert());
+
+    showImage();
+    return 0;
 }
 
-int PgmImage::invert() {
-    // invert data
-    for(int i = 0; i < imageHeight; i++) {
-	for(int j = 0; j < imageWidth; j++) {
-	    imageData[i][j] = 255 - (unsigned char) imageData[i][j];
-	}
+int PgmImage::equalize() {
+    if(materialize() != 0 || image.writable() != 0) {
+	return -4;
     }
 
-    // save it in temporary file
-    return saveInTmpPgm();
+    // table of the equalization of the region
+    roi.prepare(imageWidth, imageHeight);
+    imageHistogram.compute(image.constView(), &roi);
+    uint8_t table[256];
+    imageHistogram.equalization(table);
+
+    PointOps::apply(image.view(), roi, PointOps::Lookup(table));
+    showImage();
+    return 0;
 }
 
-int PgmImage::convolution(int** kernel, int size, bool rotate) {
-    int lOfC = (size-1)/2; // one pixel left of center
+int PgmImage::threshold() {
+    if(materialize() != 0 || image.writable() != 0) {
+	return -4;
+    }
 
-    // create a new image with the size of the old
-    int cImage[imageHeight][imageWidth];
+    // threshold of Otsu of the region
+    roi.prepare(imageWidth, imageHeight);
+    imageHistogram.compute(image.constView(), &roi);
+    int otsu = imageHistogram.otsu();
 
-    // calculate sum of the kernel
-    int kernelSum = 0;
-    for(int i = 0; i < size; i++) {
-	for(int j = 0; j < size; j++) {
-	    kernelSum += kernel[i][j];
-	}
-    }
+    PointOps::apply(image.view(), roi, PointOps::Threshold(otsu));
+    showImage();
+    return 0;
+}
 
-    // convolute image with the given kernel
-    // pixel by pixel in the image
-    for(int i = 0; i < imageHeight; i++) {
-	for(int j = 0; j < imageWidth; j++) {
-
-	    long valueSum = 0;
-	    // array by array in the kernel
-	    for(int k = 0; k < size; k++) {
-		for(int l = 0; l < size; l++) {
-
-		    // attention: borders
-		    if((i-lOfC + k) > 0 && (i-lOfC + k) < imageHeight
-		       && (j-lOfC + l) > 0 && (j-lOfC + l) < imageWidth) {
-			// multiplize kernel with a pixel of the image
-			if(rotate) {
-			    valueSum += kernel[k][l] * (unsigned char) imageData[i-lOfC + k][j-lOfC + l];
-			    valueSum += kernel[l][size-1-k] * (unsigned char) imageData[i-lOfC + k][j-lOfC + l];
-			} else {
-			    valueSum += kernel[k][l] * (unsigned char) imageData[i-lOfC + k][j-lOfC + l];
-			}
-		    } else {
-			// multiplize kernel with the color white (for borders)
-			valueSum += kernel[k][l] * 255; // white
-		    }
-		}
-	    }
+int PgmImage::convolution(int** kernel, int size, bool rotate) {
+    return convolute(Convolution(kernel, size, rotate));
+}
 
-	    // scale and save it in the new image
-	    if(kernelSum == 0) {
-		cImage[i][j] = valueSum;
-	    } else if (!rotate){
-		cImage[i][j] = valueSum / kernelSum;
-	    } else {
-		cImage[i][j] = valueSum / (kernelSum*2);
+int PgmImage::convolution(Kernels::Builtin kernel) {
+    return convolute(Convolution(kernel));
+}
+
+int PgmImage::convolute(const Convolution &conv) {
+    roi.prepare(imageWidth, imageHeight);
+
+    // the result of the whole image stays in 16 bit fixed point (as many
+    // fraction bits as fit) until the 8 bit pixels are needed
+    long long bound = conv.bound(responsePending ? responseBound : 255);
+    int shift = fractionBits(bound);
+    if(roi.isWhole() && shift >= 0) {
+	// the arena is needed when the response is scaled to 8 bit
+	if(beginScratch() != 0 || response.allocate(imageWidth, imageHeight) != 0) {
+	    return -4;
+	}
+	if(responsePending) {
+	    if(nextResponse.allocate(imageWidth, imageHeight) != 0) {
+		return -4;
 	    }
+	    conv.apply(response.constView(), responseShift, nextResponse.view(), shift, &roi);
+	    response.swap(nextResponse);
+	} else {
+	    conv.apply(image.constView(), response.view(), shift, &roi);
 	}
+	responseShift = shift;
+	responseBound = bound > 255 ? bound : 255;
+	responsePending = true;
+
+	showImage();
+	return 0;
     }
 
-    // scale cImage
+    // convolute the region of the image with the given kernel
+    int *cImage;
+    if(image.writable() != 0 || convoluteToScratch(conv, &cImage) != 0) {
+	return -4;
+    }
+
+    // scale cImage and copy it to the original (only the region)
+    PlaneView<int> values = { cImage, imageWidth, imageHeight, imageWidth };
     int max = 0;
     int min = 0;
-    for(int i = 0; i < imageHeight; i++) {
-	for(int j = 0; j < imageWidth; j++) {
-	    if(cImage[i][j] > max) {
-		max = cImage[i][j];
-	    } else if(cImage[i][j] < min) {
-		min = cImage[i][j];
+    scaleRange(values, 0, &min, &max);
+    writeScaled(values, 0, min, max);
+
+    showImage();
+    return 0;
+}
+
+int PgmImage::hough() {
+    if(materialize() != 0) {
+	return -4;
+    }
+
+    // dark pixels vote, maxima in windows of 15 x 15 with at least 33 votes
+    HoughParameters params;
+    params.grayThreshold = 20;
+    params.interval = 15;
+    params.minVotes = 33;
+
+    roi.prepare(imageWidth, imageHeight);
+    params.roi = &roi;
+    std::vector<HoughLine> lines;
+    if(houghLines(params, &lines) != 0) {
+	return -3;
+    }
+
+    // draw lines in orginial image
+    drawLines(lines);
+
+    showImage();
+    return 0;
+}
+
+template<typename RowFunction>
+void PgmImage::drawStrength(RowFunction strengthRow) {
+    // maximum of the region
+    int max = 0;
+    int top = roi.top();
+    for(int y = top; y < roi.bottom(); y++) {
+	const int16_t *strength = strengthRow(y);
+	int count;
+	const RoiSpan *span = roi.row(y, &count);
+	for(int s = 0; s < count; s++) {
+	    for(int x = span[s].left; x < span[s].right; x++) {
+		max = strength[x] > max ? strength[x] : max;
 	    }
 	}
     }
-    if(min < 0 || max > 255) {
-	for(int i = 0; i < imageHeight; i++) {
-	    for(int j = 0; j < imageWidth; j++) {
-		cImage[i][j] = (cImage[i][j] - min) * 255 / (max - min);
+
+    // strong edges dark, no edge white
+    ImageView dst = image.view();
+    ThreadPool::instance()->parallelBands(roi.bottom() - top, [&](int begin, int end, int) {
+	for(int y = begin+top; y < end+top; y++) {
+	    uint8_t *row = dst.row(y);
+	    const int16_t *strength = strengthRow(y);
+	    int count;
+	    const RoiSpan *span = roi.row(y, &count);
+	    for(int s = 0; s < count; s++) {
+		for(int x = span[s].left; x < span[s].right; x++) {
+		    int value = strength[x] > 0 ? strength[x] : 0;
+		    row[x] = (uint8_t) (max > 0 ? 255 - value * 255 / max : 255);
+		}
 	    }
 	}
+    });
+}
+
+int PgmImage::gradient() {
+    if(materialize() != 0 || image.writable() != 0) {
+	return -4;
     }
 
-    // copy the new image to the original
-    for(int i = 0; i < imageHeight; i++) {
-	for(int j = 0; j < imageWidth; j++) {
-	    imageData[i][j] = (unsigned char) cImage[i][j];
-	}
+    roi.prepare(imageWidth, imageHeight);
+    sobelGradient.compute(image.constView(), &roi);
+    drawStrength([&](int y) { return sobelGradient.magnitudeRow(y); });
+
+    showImage();
+    return 0;
+}
+
+int PgmImage::compass(Compass::Operator op) {
+    if(materialize() != 0 || image.writable() != 0) {
+	return -4;
+    }
+
+    // all 8 directions in one pass, the image shows the maximal response
+    roi.prepare(imageWidth, imageHeight);
+    if(compassEdges.compute(image.constView(), op, 8, &roi) != 0) {
+	return -4;
     }
+    drawStrength([&](int y) { return compassEdges.responseRow(y); });
 
-    // save the chart in the tmpFile
-    return saveInTmpPgm();
+    showImage();
+    return 0;
 }
 
-int PgmImage::hough() {
-    // threshold of gray value
-    int threshold = 20;
-    // intervall for local maxima - must be odd
-    int intervall = 15;
-
-    // create and init akku
-    int akkuHeight = sqrt(imageHeight*imageHeight + imageWidth*imageWidth) + 1;
-    int akkuWidth = 360;
-    int **akku;
-    akku = (int**) malloc(sizeof(int*) * akkuHeight);
-    for(int i = 0; i < akkuHeight; i++){
-	akku[i] = (int*) malloc(sizeof(int) * akkuWidth);
-    }
-    for(int row = 0; row < akkuHeight; row++) {
-	for(int col = 0; col < akkuWidth; col++) {
-	    akku[row][col] = 0;
-	}
+int PgmImage::box(int size) {
+    ImageView dst;
+    int ret = filterView(size, &dst);
+    if(ret != 0) {
+	return ret;
     }
+    smoothing.box(image.constView(), dst, size / 2, &roi);
+    takeFiltered();
 
-    // write akku
-    for(int x = 1; x < imageWidth; x++) {
-	for(int y = 1; y < imageHeight; y++) {
-	    if(threshold > (unsigned char) imageData[y][x]) {
-		for(int t = 0; t < akkuWidth; t++) {
-		    double radian = t * M_PI / 180;
-		    int r = round(x*cos(radian) + y*sin(radian));
-		    if(r >= 0 && r < akkuHeight) {
-			akku[r][t]++;
-		    }
-		}
-	    }
-	}
+    showImage();
+    return 0;
+}
+
+int PgmImage::median(int size) {
+    ImageView dst;
+    int ret = filterView(size, &dst);
+    if(ret != 0) {
+	return ret;
     }
+    smoothing.median(image.constView(), dst, size / 2, &roi);
+    takeFiltered();
 
-    // find local maximas
-    int maxR, maxT;
-    QList<QPoint> list;
-    for(int r = (intervall-1)/2; r < akkuHeight; r += intervall) {
-	for(int t = (intervall-1)/2; t < akkuWidth; t += intervall) {
-	    int ret = localMaxima(akku, akkuHeight, akkuWidth, t, r, &maxT, &maxR, intervall);
-	    if(ret == 0) {
-		// maxima found - save it, when it isn't in the list
-		if(!list.contains(QPoint(maxT, maxR))) {
-		    list.append(QPoint(maxT, maxR));
-		}
-	    } else if(ret == 1) {
-		// no maxima found
-		continue;
-	    } else {
-		// error while calculation
-		return -3;
-	    }
-	}
+    showImage();
+    return 0;
+}
+
+int PgmImage::bilateral(int size, int sigma) {
+    ImageView dst;
+    int ret = filterView(size, &dst);
+    if(ret != 0) {
+	return ret;
     }
+    if(smoothing.bilateral(image.constView(), dst, size / 2, sigma, &roi) != 0) {
+	return -1;
+    }
+    takeFiltered();
+
+    showImage();
+    return 0;
+}
 
-    qDebug() << list;
+int PgmImage::houghGradient() {
+    if(materialize() != 0) {
+	return -4;
+    }
+
+    // pixels with a magnitude of at least 100 vote within +- 8 degree of
+    // their orientation, maxima in windows of 15 x 15 with at least 33 votes
+    HoughParameters params;
+    params.minMagnitude = 100;
+    params.thetaWindow = 8;
+    params.interval = 15;
+    params.minVotes = 33;
+
+    roi.prepare(imageWidth, imageHeight);
+    params.roi = &roi;
+    sobelGradient.compute(image.constView(), &roi);
+    std::vector<HoughLine> lines;
+    if(houghTransform.detectOriented(sobelGradient, params, &lines) != 0) {
+	return -3;
+    }
 
     // draw lines in orginial image
-    foreach(QPoint point, list) {
-	double sample = 1000;
-	double radian = point.x()*M_PI/180;
-	if(radian != 0.0) {
-	    double m = (-1) * (double) (cos(radian) / sin(radian));
-	    double b = (double) (point.y() / (sin(radian)));
-	    for(int x = 0; x < imageWidth*sample; x++) {
-		int y = round(m * (double) (x/sample) + b);
-		if(y >= 0 && y < imageHeight) {
-		    imageData[y][(int) round(x/sample)] = 0;
+    drawLines(lines);
+
+    showImage();
+    return 0;
+}
+
+int PgmImage::houghP() {
+    if(materialize() != 0) {
+	return -4;
+    }
+
+    // dark pixels vote, segments of at least 30 pixels with at least 20 votes
+    HoughParameters params;
+    params.grayThreshold = 20;
+    params.minVotes = 20;
+    params.minLength = 30;
+    params.maxGap = 3;
+
+    std::vector<HoughSegment> segments;
+    if(houghSegments(params, &segments) != 0) {
+	return -3;
+    }
+
+    // draw segments in orginial image
+    drawSegments(segments);
+
+    showImage();
+    return 0;
+}
+
+int PgmImage::canny(int low, int high) {
+    if(materialize() != 0 || image.writable() != 0) {
+	return -4;
+    }
+
+    roi.prepare(imageWidth, imageHeight);
+    int ret = cannyEdges.detect(image.constView(), low, high, &roi);
+    if(ret != 0) {
+	return ret;
+    }
+
+    // edges black, the rest of the region white
+    ImageView dst = image.view();
+    int top = roi.top();
+    ThreadPool::instance()->parallelBands(roi.bottom() - top, [&](int begin, int end, int) {
+	for(int y = begin+top; y < end+top; y++) {
+	    uint8_t *row = dst.row(y);
+	    const uint8_t *edges = cannyEdges.edgeRow(y);
+	    int count;
+	    const RoiSpan *span = roi.row(y, &count);
+	    for(int s = 0; s < count; s++) {
+		for(int x = span[s].left; x < span[s].right; x++) {
+		    row[x] = edges[x] == Canny::edge ? 0 : 255;
 		}
 	    }
 	}
+    });
+
+    showImage();
+    return 0;
+}
+
+int PgmImage::houghCanny() {
+    if(materialize() != 0) {
+	return -4;
+    }
+
+    // only the Canny edges of the region vote, maxima in windows of 15 x 15
+    // with at least 33 votes
+    roi.prepare(imageWidth, imageHeight);
+    if(cannyEdges.detect(image.constView(), cannyLow, cannyHigh, &roi) != 0) {
+	return -4;
+    }
+    HoughParameters params;
+    params.interval = 15;
+    params.minVotes = 33;
+    std::vector<HoughLine> lines;
+    if(houghTransform.detect(cannyEdges.edges(), imageWidth, imageHeight, params, &lines) != 0) {
+	return -3;
+    }
+
+    // draw lines in orginial image
+    drawLines(lines);
+
+    showImage();
+    return 0;
+}
+
+int PgmImage::houghPCanny() {
+    if(materialize() != 0) {
+	return -4;
     }
 
-    // free akku
-    for(int i = 0; i < akkuHeight; i++){
-	free(akku[i]);
+    // only the Canny edges of the region are sampled, segments of at least
+    // 30 pixels with at least 20 votes
+    roi.prepare(imageWidth, imageHeight);
+    if(cannyEdges.detect(image.constView(), cannyLow, cannyHigh, &roi) != 0) {
+	return -4;
+    }
+    HoughParameters params;
+    params.minVotes = 20;
+    params.minLength = 30;
+    params.maxGap = 3;
+    std::vector<HoughSegment> segments;
+    if(houghTransform.detectSegments(cannyEdges.edges(), imageWidth, imageHeight, params,
+				     &segments) != 0) {
+	return -3;
     }
-    free(akku);
 
-    // save it in temporary file
-    return saveInTmpPgm();
+    // draw segments in orginial image
+    drawSegments(segments);
+
+    showImage();
+    return 0;
 }
 
 int PgmImage::savePgm(QString path) {
+    if(materialize() != 0) {
+	return -4;
+    }
+
     // workaround for Windows
     delete tmpFile;
     tmpFile = new QTemporaryFile();
@@ -322,20 +576,97 @@ int PgmImage::savePgm(QString path) {
 	return -1;
     }
 
-    // save it with standard data
-    return savePgm(&file, imageData, imageWidth, imageHeight);
+    // save it with standard data (and the drawn lines)
+    return savePgm(&file, composedImage().constView());
 }
 
 QString PgmImage::getTmpFilePath() {
+    // write the shown image only on request
+    if(materialize() != 0
+       || saveInTmpPgm(chartShown ? chart.constView() : composedImage().constView()) != 0) {
+	return QString();
+    }
     return tmpFile->fileName();
 }
 
-int PgmImage::saveInTmpPgm() {
-    // save it with standard data
-    return saveInTmpPgm(imageData, imageWidth, imageHeight);
+#ifndef CV_NO_GUI
+QImage PgmImage::getImage() {
+    if(materialize() != 0) {
+	return QImage();
+    }
+
+    // QImage expects rows aligned to 4 bytes (a mapped file may have other rows)
+    if(!chartShown && image.stride() % 4 != 0 && image.detach() != 0) {
+	return QImage();
+    }
+
+    const ImagePlane &shown = chartShown ? chart : composedImage();
+    if(shown.isEmpty()) {
+	return QImage();
+    }
+
+    // wrap the plane without a copy
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+    return QImage(shown.constRow(0), shown.width(), shown.height(), shown.stride(),
+		  QImage::Format_Grayscale8);
+#else
+    static QVector<QRgb> grayTable;
+    if(grayTable.isEmpty()) {
+	for(int i = 0; i < 256; i++) {
+	    grayTable.append(qRgb(i, i, i));
+	}
+    }
+    QImage wrapper(shown.constRow(0), shown.width(), shown.height(), shown.stride(),
+		   QImage::Format_Indexed8);
+    wrapper.setColorTable(grayTable);
+    return wrapper;
+#endif
+}
+#endif
+
+void PgmImage::showImage() {
+    chartShown = false;
 }
 
-int PgmImage::saveInTmpPgm(char **data, int width, int height) {
+void PgmImage::clearOverlay() {
+    overlayUsed = false;
+}
+
+int PgmImage::overlayView(ImageView *marks) {
+    // allocated (or reused) and cleared on the first drawing of an image
+    if(!overlayUsed) {
+	if(overlay.allocate(imageWidth, imageHeight) != 0) {
+	    return -1;
+	}
+	for(int y = 0; y < imageHeight; y++) {
+	    memset(overlay.row(y), 0, imageWidth);
+	}
+	overlayUsed = true;
+    }
+    *marks = overlay.view();
+    return 0;
+}
+
+const ImagePlane &PgmImage::composedImage() {
+    if(!overlayUsed || composed.allocate(imageWidth, imageHeight) != 0) {
+	return image;
+    }
+
+    // drawn pixels are black
+    ThreadPool::instance()->parallelBands(imageHeight, [&](int begin, int end, int) {
+	for(int y = begin; y < end; y++) {
+	    const uint8_t *pixel = image.constRow(y);
+	    const uint8_t *mark = overlay.constRow(y);
+	    uint8_t *row = composed.row(y);
+	    for(int x = 0; x < imageWidth; x++) {
+		row[x] = mark[x] != 0 ? 0 : pixel[x];
+	    }
+	}
+    });
+    return composed;
+}
+
+int PgmImage::saveInTmpPgm(const ImageView &data) {
     // workaround for Windows
     delete tmpFile;
     tmpFile = new QTemporaryFile();
@@ -346,10 +677,10 @@ int PgmImage::saveInTmpPgm(char **data, int width, int height) {
     }
 
     // save it
-    return savePgm(tmpFile, data, width, height);
+    return savePgm(tmpFile, data);
 }
 
-int PgmImage::savePgm(QFile *file, char **data, int width, int height) {
+int PgmImage::savePgm(QFile *file, const ImageView &data) {
     // write header
     if(file->write(QByteArray("P5\n")) != 3) {
 	return -2;
@@ -357,17 +688,19 @@ int PgmImage::savePgm(QFile *file, char **data, int width, int height) {
 	return -2;
     }
     QByteArray tmpArray;
-    tmpArray.append(QString::number(width,10));
+    tmpArray.append(QString::number(data.width,10));
     tmpArray.append(" ");
-    tmpArray.append(QString::number(height,10));
+    tmpArray.append(QString::number(data.height,10));
     tmpArray.append("\n255\n");
     if (file->write(tmpArray) <= 0) {
 	return -2;
     }
 
     // write data
-    for(int i = 0; i < height; i++) {
-	file->write(data[i],width);
+    for(int i = 0; i < data.height; i++) {
+	if(file->write((const char*) data.row(i), data.width) != data.width) {
+	    return -2;
+	}
     }
 
     // close file
@@ -375,468 +708,509 @@ int PgmImage::savePgm(QFile *file, char **data, int width, int height) {
     return 0;
 }
 
-int PgmImage::localMaxima(int** akku, int height, int width, int oldX, int oldY, int *newX, int *newY, int intervall) {
-    int threshold = 33; // minimal value of an maxima
+int PgmImage::materialize() {
+    if(!responsePending) {
+	return 0;
+    }
 
-    // intervall must be odd
-    if(intervall % 2 == 0) {
-	return -1;
+    // a response is only kept for the whole image, the arena was sized for
+    // the image by the convolution, so it needs no memory here (a mapped
+    // image may need its copy), without memory the response stays pending
+    roi.prepare(imageWidth, imageHeight);
+    if(beginScratch() != 0 || image.writable() != 0) {
+	return -4;
     }
-    int hOfI = (intervall-1)/2;
+    PlaneView<int16_t> values = response.constView();
+    int max = 0;
+    int min = 0;
+    scaleRange(values, responseShift, &min, &max);
+    writeScaled(values, responseShift, min, max);
+    responsePending = false;
+    return 0;
+}
 
-    // space between upper left corner and start point
-    if(oldX < hOfI|| oldY < hOfI) {
-	return -1;
+int PgmImage::setRoi(const Roi &region) {
+    if(materialize() != 0) {
+	return -4;
     }
+    roi = region;
+    return 0;
+}
 
-    // current values
-    int max = akku[oldY][oldX];
-    *newX = oldX;
-    *newY = oldY;
+int PgmImage::convoluteToScratch(const Convolution &conv, int **values) {
+    // create a new image with the size of the old (in the arena)
+    if(beginScratch() != 0) {
+	return -4;
+    }
+    *values = scratch.take<int>((size_t) imageWidth * imageHeight);
 
-    // search if any point is greater than the current value
-    for(int x = oldX-hOfI; x < width && x < (oldX+hOfI); x++) {
-	for(int y = oldY-hOfI; y < height && y < (oldY+hOfI); y++) {
-	    if(max <= akku[y][x]) {
-		max = akku[y][x];
-		*newX = x;
-		*newY = y;
+    // a pending response is the image (and the region is the whole image)
+    roi.prepare(imageWidth, imageHeight);
+    if(responsePending) {
+	conv.apply(response.constView(), responseShift, *values, imageWidth, &roi);
+	responsePending = false;
+    } else {
+	conv.apply(image.constView(), *values, imageWidth, &roi);
+    }
+    return 0;
+}
+
+template<typename T>
+void PgmImage::writeScaled(const PlaneView<T> &values, int shift, int min, int max) {
+    bool scaled = min < 0 || max > 255;
+    int top = roi.top();
+    ImageView dst = image.view();
+    ThreadPool::instance()->parallelBands(roi.bottom() - top, [&](int begin, int end, int) {
+	for(int i = begin+top; i < end+top; i++) {
+	    uint8_t *row = dst.row(i);
+	    const T *valueRow = values.row(i);
+	    int count;
+	    const RoiSpan *span = roi.row(i, &count);
+	    for(int s = 0; s < count; s++) {
+		for(int j = span[s].left; j < span[s].right; j++) {
+		    int value = wholePart(valueRow[j], shift);
+		    if(scaled) {
+			value = (value - min) * 255 / (max - min);
+		    }
+		    row[j] = (uint8_t) value;
+		}
 	    }
 	}
-    }
+    });
+}
 
-    // if a greater point is found, repeat this procedure
-    if(oldX != *newX || oldY != *newY) {
-	if(*newX >= hOfI && *newY >= hOfI) {
-	    return localMaxima(akku, height, width, *newX, *newY, newX, newY, intervall);
+template<typename T>
+void PgmImage::scaleRange(const PlaneView<T> &values, int shift, int *min, int *max) {
+    // minimum and maximum of every band (pixels of the region)
+    ThreadPool *pool = ThreadPool::instance();
+    int top = roi.top();
+    int bands = pool->bandCount(roi.bottom() - top);
+    int *bandMin = scratch.take<int>(bands);
+    int *bandMax = scratch.take<int>(bands);
+    pool->parallelBands(roi.bottom() - top, [&](int begin, int end, int band) {
+	int bMin = 0;
+	int bMax = 0;
+	for(int i = begin+top; i < end+top; i++) {
+	    int count;
+	    const RoiSpan *span = roi.row(i, &count);
+	    for(int s = 0; s < count; s++) {
+		const T *valueRow = values.row(i);
+		for(int j = span[s].left; j < span[s].right; j++) {
+		    int value = wholePart(valueRow[j], shift);
+		    if(value > bMax) {
+			bMax = value;
+		    } else if(value < bMin) {
+			bMin = value;
+		    }
+		}
+	    }
 	}
+	bandMin[band] = bMin;
+	bandMax[band] = bMax;
+    });
+
+    for(int band = 0; band < bands; band++) {
+	*min = bandMin[band] < *min ? bandMin[band] : *min;
+	*max = bandMax[band] > *max ? bandMax[band] : *max;
+    }
+}
+
+int PgmImage::beginScratch() {
+    int bands = ThreadPool::instance()->bandCount(imageHeight);
+    size_t bytes = ScratchArena::bytesFor<int>((size_t) imageWidth * imageHeight)
+		   + ScratchArena::bytesFor<int>(imageHeight)
+		   + ScratchArena::bytesFor<int>(bands * Histogram::subCount * 256)
+		   + 2 * ScratchArena::bytesFor<int>(bands);
+    return scratch.begin(bytes) == 0 ? 0 : -4;
+}
+
+int PgmImage::filterView(int size, ImageView *dst) {
+    if(materialize() != 0 || image.writable() != 0) {
+	return -4;
     }
 
-    // if local maxima, which is found, is to small, ignore it
-    if(akku[oldY][oldX] < threshold) {
-	return 1;
+    if(size < 3 || size > 2 * Smoothing::maxRadius + 1 || size % 2 == 0) {
+	return -1;
+    }
+    if(filtered.allocate(imageWidth, imageHeight) != 0) {
+	return -4;
     }
+    roi.prepare(imageWidth, imageHeight);
+    *dst = filtered.view();
     return 0;
 }
 
-int PgmImage::convolutionLD(int** kernel, int size, bool rotate) {
-    int lOfC = (size-1)/2; // one pixel left of center
+void PgmImage::takeFiltered() {
+    int top = roi.top();
+    ImageView dst = image.view();
+    ThreadPool::instance()->parallelBands(roi.bottom() - top, [&](int begin, int end, int) {
+	for(int i = begin+top; i < end+top; i++) {
+	    const uint8_t *from = filtered.constRow(i);
+	    uint8_t *row = dst.row(i);
+	    int count;
+	    const RoiSpan *span = roi.row(i, &count);
+	    for(int s = 0; s < count; s++) {
+		memcpy(row + span[s].left, from + span[s].left, span[s].right - span[s].left);
+	    }
+	}
+    });
+}
 
-    // create a new image with the size of the old
-    int cImage[imageHeight][imageWidth];
+void PgmImage::drawLines(const std::vector<HoughLine> &lines) {
+    roi.prepare(imageWidth, imageHeight);
+    ImageView marks;
+    if(overlayView(&marks) != 0) {
+	return;
+    }
+    for(size_t i = 0; i < lines.size(); i++) {
+	qDebug() << "line: rho" << lines[i].rho << "theta" << lines[i].theta
+		 << "votes" << lines[i].votes;
+	Raster::drawLine(marks, lines[i].rho, lines[i].theta, 255, &roi);
+    }
+}
 
-    // calculate sum of the kernel
-    int kernelSum = 0;
-    for(int i = 0; i < size; i++) {
-	for(int j = 0; j < size; j++) {
-	    kernelSum += kernel[i][j];
-	}
+void PgmImage::drawSegments(const std::vector<HoughSegment> &segments) {
+    roi.prepare(imageWidth, imageHeight);
+    ImageView marks;
+    if(overlayView(&marks) != 0) {
+	return;
+    }
+    for(size_t i = 0; i < segments.size(); i++) {
+	const HoughSegment &segment = segments[i];
+	qDebug() << "segment:" << segment.x1 << segment.y1 << "-" << segment.x2 << segment.y2
+		 << "rho" << segment.rho << "theta" << segment.theta << "votes" << segment.votes;
+	Raster::drawSegment(marks, segment.x1, segment.y1, segment.x2, segment.y2, 255, &roi);
     }
+}
 
-    // convolute image with the given kernel
-    // pixel by pixel in the image
-    for(int i = 0; i < imageHeight; i++) {
-	for(int j = 0; j < imageWidth; j++) {
-
-	    long valueSum = 0;
-	    // array by array in the kernel
-	    for(int k = 0; k < size; k++) {
-		for(int l = 0; l < size; l++) {
-
-		    // attention: borders
-		    if((i-lOfC + k) > 0 && (i-lOfC + k) < imageHeight
-		       && (j-lOfC + l) > 0 && (j-lOfC + l) < imageWidth) {
-			// multiplize kernel with a pixel of the image
-			if(rotate) {
-			    valueSum += kernel[k][l] * (unsigned char) imageData[i-lOfC + k][j-lOfC + l];
-			    valueSum += kernel[l][size-1-k] * (unsigned char) imageData[i-lOfC + k][j-lOfC + l];
-			} else {
-			    valueSum += kernel[k][l] * (unsigned char) imageData[i-lOfC + k][j-lOfC + l];
-			}
-		    } else {
-			// multiplize kernel with the color white (for borders)
-			valueSum += kernel[k][l] * 255; // white
-		    }
-		}
-	    }
+int PgmImage::convolutionLD(int** kernel, int size, bool rotate) {
+    return convoluteLD(Convolution(kernel, size, rotate));
+}
 
-	    // scale and save it in the new image
-	    if(kernelSum == 0) {
-		cImage[i][j] = valueSum;
-	    } else if (!rotate){
-		cImage[i][j] = valueSum / kernelSum;
-	    } else {
-		cImage[i][j] = valueSum / (kernelSum*2);
-	    }
-	}
+int PgmImage::convolutionLD(Kernels::Builtin kernel) {
+    return convoluteLD(Convolution(kernel));
+}
+
+int PgmImage::convoluteLD(const Convolution &conv) {
+    // convolute the region of the image with the given kernel (a pending
+    // Gauss is read in fixed point)
+    int *cImage;
+    if(image.writable() != 0 || convoluteToScratch(conv, &cImage) != 0) {
+	return -4;
     }
 
     // scale cImage
+    PlaneView<int> range = { cImage, imageWidth, imageHeight, imageWidth };
     int max = 0;
     int min = 0;
-    for(int i = 0; i < imageHeight; i++) {
-	for(int j = 0; j < imageWidth; j++) {
-	    if(cImage[i][j] > max) {
-		max = cImage[i][j];
-	    } else if(cImage[i][j] < min) {
-		min = cImage[i][j];
-	    }
-	}
-    }
-    if(min < 0 || max > 255) {
-	for(int i = 0; i < imageHeight; i++) {
-	    for(int j = 0; j < imageWidth; j++) {
-		cImage[i][j] = (cImage[i][j] - min) * 255 / (max - min);
+    scaleRange(range, 0, &min, &max);
+
+    // scale and copy the new image to the original (only the region), the
+    // scaled values are counted while they are written
+    bool scaled = min < 0 || max > 255;
+    const int *values = cImage;
+    int top = roi.top();
+    ImageView dst = image.view();
+    ThreadPool *pool = ThreadPool::instance();
+    int bands = pool->bandCount(roi.bottom() - top);
+    int *sub = scratch.take<int>(bands * Histogram::subCount * 256);
+    memset(sub, 0, bands * Histogram::subCount * 256 * sizeof(int));
+    pool->parallelBands(roi.bottom() - top, [&](int begin, int end, int band) {
+	int *data = sub + band * Histogram::subCount * 256;
+	for(int i = begin+top; i < end+top; i++) {
+	    uint8_t *row = dst.row(i);
+	    int count;
+	    const RoiSpan *span = roi.row(i, &count);
+	    for(int s = 0; s < count; s++) {
+		for(int j = span[s].left; j < span[s].right; j++) {
+		    int value = values[(ptrdiff_t) i * imageWidth + j];
+		    if(scaled) {
+			value = (value - min) * 255 / (max - min);
+		    }
+		    row[j] = (uint8_t) value;
+		}
+		Histogram::countRow(row, span[s].left, span[s].right, data);
 	    }
 	}
-    }
+    });
+    imageHistogram.setCounts(sub, bands * Histogram::subCount);
 
-    // copy the new image to the original (filter gray values)
-    for(int i = 0; i < imageHeight; i++) {
-	for(int j = 0; j < imageWidth; j++) {
-	    //imageData[i][j] = (unsigned char) cImage[i][j];
-	    if( (unsigned char) cImage[i][j] < 120 ||  (unsigned char) cImage[i][j] > 135) {
-		imageData[i][j] = (unsigned char) 0;
-	    } else {
-		imageData[i][j] = (unsigned char) 255;
-	    }
-	}
+    // filter gray values: the most frequent value is the response of flat
+    // areas (no edge), the values next to it are white, edges are black
+    int mode = imageHistogram.mode();
+    uint8_t table[256];
+    for(int i = 0; i < 256; i++) {
+	table[i] = i < mode - 8 || i > mode + 7 ? 0 : 255;
     }
+    PointOps::apply(image.view(), roi, PointOps::Lookup(table));
 
-    // save the chart in the tmpFile
-    return saveInTmpPgm();
+    showImage();
+    return 0;
 }
 
-int PgmImage::houghLD() {
-    // threshold of gray value
-    int threshold = 20;
-    // intervall for local maxima - must be odd
-    int intervall = 21;
+int PgmImage::houghLines(const HoughParameters &params, std::vector<HoughLine> *lines) {
+    if(materialize() != 0) {
+	return -4;
+    }
 
-    // create and init akku
-    int akkuHeight = sqrt(imageHeight*imageHeight + imageWidth*imageWidth) + 1;
-    int akkuWidth = 360;
-    int **akku;
-    akku = (int**) malloc(sizeof(int*) * akkuHeight);
-    for(int i = 0; i < akkuHeight; i++){
-	akku[i] = (int*) malloc(sizeof(int) * akkuWidth);
+    // without an own region only the pixels of the image's region vote
+    HoughParameters region = params;
+    if(region.roi == 0) {
+	roi.prepare(imageWidth, imageHeight);
+	region.roi = &roi;
     }
-    for(int row = 0; row < akkuHeight; row++) {
-	for(int col = 0; col < akkuWidth; col++) {
-	    akku[row][col] = 0;
-	}
+    if(houghTransform.detect(image.constView(), region, lines) != 0) {
+	return -3;
     }
+    return 0;
+}
 
-    // write akku
-    for(int x = 1; x < imageWidth; x++) {
-	for(int y = 1; y < imageHeight; y++) {
-	    if(threshold > (unsigned char) imageData[y][x]) {
-		for(int t = 0; t < akkuWidth; t++) {
-		    double radian = t * M_PI / 180;
-		    int r = round(x*cos(radian) + y*sin(radian));
-		    if(r >= 0 && r < akkuHeight) {
-			akku[r][t]++;
-		    }
-		}
-	    }
-	}
+int PgmImage::houghSegments(const HoughParameters &params, std::vector<HoughSegment> *segments) {
+    if(materialize() != 0) {
+	return -4;
     }
 
-    // find local maximas
-    int maxR, maxT;
-    QList<QPoint> list;
-    for(int r = (intervall-1)/2; r < akkuHeight; r += intervall) {
-	for(int t = (intervall-1)/2; t < akkuWidth; t += intervall) {
-	    int ret = localMaximaLD(akku, akkuHeight, akkuWidth, t, r, &maxT, &maxR, intervall);
-	    if(ret == 0) {
-		// maxima found - save it, when it isn't in the list
-		if(!list.contains(QPoint(maxT, maxR))) {
-		    list.append(QPoint(maxT, maxR));
-		}
-	    } else if(ret == 1) {
-		// no maxima found
-		continue;
-	    } else {
-		// error while calculation
-		return -3;
-	    }
-	}
+    // without an own region only the pixels of the image's region vote
+    HoughParameters region = params;
+    if(region.roi == 0) {
+	roi.prepare(imageWidth, imageHeight);
+	region.roi = &roi;
     }
+    if(houghTransform.detectSegments(image.constView(), region, segments) != 0) {
+	return -3;
+    }
+    return 0;
+}
 
-    qDebug() << list;
+int PgmImage::houghLD(std::vector<HoughLine> *lines, LaneTracker *tracker) {
+    if(materialize() != 0) {
+	return -4;
+    }
 
-    // draw lines in orginial image
-    foreach(QPoint point, list) {
-	double sample = 1000;
-	double radian = point.x()*M_PI/180;
-	if(radian != 0.0) {
-	    double m = (-1) * (double) (cos(radian) / sin(radian));
-	    double b = (double) (point.y() / (sin(radian)));
-	    //if((b > -260 && b < -160) || (b > 600 && b < 700)) {
-		if((m > -0.85 && m < -0.55) || (m > 0.55 && m < 1.05)) {
-		    for(int x = 0; x < imageWidth*sample; x++) {
-			int y = round(m * (double) (x/sample) + b);
-			if(y >= 0 && y < imageHeight) {
-			    imageData[y][(int) round(x/sample)] = 0;
-			}
-		    }
-		}
-	    //}
+    // dark pixels vote, maxima in windows of 21 x 21 with at least 51 votes
+    HoughParameters params;
+    params.grayThreshold = 20;
+    params.interval = 21;
+    params.minVotes = 51;
+
+    // only the slopes of lanes
+    // left:  m = -0.7 && b =  650
+    // right: m =  0.8 && b = -210
+    SlopeRange left = { -0.85, -0.55 };
+    SlopeRange right = { 0.55, 1.05 };
+    params.slopes.push_back(left);
+    params.slopes.push_back(right);
+
+    roi.prepare(imageWidth, imageHeight);
+    params.roi = &roi;
+    std::vector<HoughLine> found;
+    if(tracker != 0) {
+	if(tracker->track(&houghTransform, image.constView(), params, &found) != 0) {
+	    return -3;
 	}
-
-	// left:  m = -0.7 && b =  650
-	// right: m =  0.8 && b = -210
+    } else if(houghLines(params, &found) != 0) {
+	return -3;
     }
 
-    // free akku
-    for(int i = 0; i < akkuHeight; i++){
-	free(akku[i]);
+    // draw lines in orginial image
+    drawLines(found);
+    if(lines != 0) {
+	*lines = found;
     }
-    free(akku);
 
-    // save it in temporary file
-    return saveInTmpPgm();
+    showImage();
+    return 0;
 }
 
-int PgmImage::localMaximaLD(int** akku, int height, int width, int oldX, int oldY, int *newX, int *newY, int intervall) {
-    int threshold = 51; // minimal value of an maxima
+int PgmImage::fill(int x, int y, int newValue, FloodFill::Connectivity connectivity,
+		   FillResult *result) {
+    if(materialize() != 0 || image.writable() != 0) {
+	return -4;
+    }
 
-    // intervall must be odd
-    if(intervall % 2 == 0) {
+    if(x < 0 || x >= imageWidth || y < 0 || y >= imageHeight) {
 	return -1;
     }
-    int hOfI = (intervall-1)/2;
 
-    // space between upper left corner and start point
-    if(oldX < hOfI|| oldY < hOfI) {
+    // the region has the gray value of the seed
+    uint8_t oldValue = image.constRow(y)[x];
+    roi.prepare(imageWidth, imageHeight);
+    if(oldValue == newValue || !roi.contains(x, y)) {
 	return -1;
     }
+    ImageView marks = overlay.constView();
+    floodFill.fill(image.view(), x, y, oldValue, (uint8_t) newValue, connectivity, result, &roi,
+		   overlayUsed ? &marks : 0);
 
-    // current values
-    int max = akku[oldY][oldX];
-    *newX = oldX;
-    *newY = oldY;
+    showImage();
+    return 0;
+}
 
-    // search if any point is greater than the current value
-    for(int x = oldX-hOfI; x < width && x < (oldX+hOfI); x++) {
-	for(int y = oldY-hOfI; y < height && y < (oldY+hOfI); y++) {
-	    if(max <= akku[y][x]) {
-		max = akku[y][x];
-		*newX = x;
-		*newY = y;
-	    }
-	}
+int PgmImage::dyeLD(FillResult *lane) {
+    if(materialize() != 0 || image.writable() != 0) {
+	return -4;
     }
 
-    // if a greater point is found, repeat this procedure
-    if(oldX != *newX || oldY != *newY) {
-	if(*newX >= hOfI && *newY >= hOfI) {
-	    return localMaxima(akku, height, width, *newX, *newY, newX, newY, intervall);
-	}
+    // seed in the middle of the region (without a region: below the upper
+    // border of the road images)
+    roi.prepare(imageWidth, imageHeight);
+    int seedX = imageWidth/2;
+    int seedY = 53;
+    if(!roi.isWhole()) {
+	int count;
+	seedY = (roi.top() + roi.bottom()) / 2;
+	const RoiSpan *span = roi.row(seedY, &count);
+	seedX = count > 0 ? (span[0].left + span[count-1].right) / 2 : -1;
     }
 
-    // if local maxima, which is found, is to small, ignore it
-    if(akku[oldY][oldX] < threshold) {
-	return 1;
+    // dye the white region of the lane (the drawn lines are its borders)
+    FillResult filled = { 0, 0, 0, -1, -1 };
+    ImageView marks = overlay.constView();
+    floodFill.fill(image.view(), seedX, seedY, 255, 128, FloodFill::Four, &filled, &roi,
+		   overlayUsed ? &marks : 0);
+    if(lane != 0) {
+	*lane = filled;
     }
-    return 0;
-}
-
-int PgmImage::dyeLD() {
-    // dye(imageWidth/2, imageHeight/2, 255, 128);
-    dye(imageWidth/2, 53, 255, 128);
 
     // calculate lane width
-    int laneWidth[imageHeight];
+    if(beginScratch() != 0) {
+	return -4;
+    }
+    int *laneWidth = scratch.take<int>(imageHeight);
     for(int y = 0; y < imageHeight; y++) {
 	laneWidth[y] = 0;
-	for(int x = 0; x < imageWidth; x++) {
-	    if((unsigned char) imageData[y][x] == 128) {
-		laneWidth[y]++;
+	int count;
+	const RoiSpan *span = roi.row(y, &count);
+	for(int s = 0; s < count; s++) {
+	    for(int x = span[s].left; x < span[s].right; x++) {
+		if(image.row(y)[x] == 128) {
+		    laneWidth[y]++;
+		}
 	    }
 	}
     }
 
     // calculate lane middle
     for(int y = 0; y < imageHeight; y++) {
-	for(int x = 0; x < imageWidth-10; x++) {
-	    if((unsigned char) imageData[y][x] == 128 && (unsigned char) imageData[y][x+10] == 128) {
+	int count;
+	const RoiSpan *span = roi.row(y, &count);
+	for(int s = 0; s < count; s++) {
+	    int x = span[s].left;
+	    while(x < span[s].right && x < imageWidth-10
+		  && (image.row(y)[x] != 128 || image.row(y)[x+10] != 128)) {
+		x++;
+	    }
+	    if(x < span[s].right && x < imageWidth-10) {
 		laneWidth[y] = x + laneWidth[y]/2;
 		break;
 	    }
 	}
     }
 
-    // paint lane middle
+    // paint lane middle into the overlay
+    // (mean of 21 rows, only the rows inside of the image at the top)
+    if(overlayView(&marks) != 0) {
+	return -4;
+    }
     for(int y = 5; y < imageHeight-10; y+=2) {
 	long lanePos = 0;
-	for(int i = 0; i < 21; i++) {
-	    lanePos += laneWidth[y+i-10];
+	int first = y-10 > 0 ? y-10 : 0;
+	for(int i = first; i <= y+10; i++) {
+	    lanePos += laneWidth[i];
 	}
-	lanePos /= 21;
+	lanePos /= y+10 - first + 1;
 	if(lanePos > 1 && lanePos < imageWidth-1) {
-	    imageData[y][lanePos-1] = (unsigned char) 0;
-	    imageData[y][lanePos]   = (unsigned char) 0;
-	    imageData[y][lanePos+1] = (unsigned char) 0;
+	    for(int x = lanePos-1; x <= lanePos+1; x++) {
+		if(roi.contains(x, y)) {
+		    marks.row(y)[x] = 255;
+		}
+	    }
 	}
     }
 
 
-    // save it in temporary file
-    return saveInTmpPgm();
-}
-
-void PgmImage::dye(int curX, int curY, int oldValue, int newValue) {
-    imageData[curY][curX] = newValue;
-    if(curX < (imageWidth-1) && (unsigned char) imageData[curY][curX+1] == oldValue) {
-	dye(curX+1, curY, oldValue, newValue);
-    }
-    if(curY < (imageHeight-1) && (unsigned char) imageData[curY+1][curX] == oldValue) {
-	dye(curX, curY+1, oldValue, newValue);
-    }
-    if(curX > 0 && (unsigned char) imageData[curY][curX-1] == oldValue) {
-	dye(curX-1, curY, oldValue, newValue);
-    }
+    showImage();
+    return 0;
 }
 
 int PgmImage::cutRD() {
-    // cut borders
-    // bottom
-    for(int y = 0; y < 15; y++) {
-	for(int x = 0; x < imageWidth; x++) {
-	   imageData[y][x] = (unsigned char) 0;
-	}
-    }
-    // top
-    for(int y = imageHeight-15; y < imageHeight; y++) {
-	for(int x = 0; x < imageWidth; x++) {
-	   imageData[y][x] = (unsigned char) 0;
-	}
-    }
-    // left
-    for(int y = 0; y < imageHeight; y++) {
-	for(int x = 0; x < 15; x++) {
-	   imageData[y][x] = (unsigned char) 0;
-	}
+    if(materialize() != 0 || image.writable() != 0) {
+	return -4;
     }
-    // right
-    for(int y = 0; y < imageHeight; y++) {
-	for(int x = imageWidth-15; x < imageWidth; x++) {
-	   imageData[y][x] = (unsigned char) 0;
-	}
+
+    // without a region the borders (15 pixels) are left out
+    Roi region = roi;
+    if(region.isWhole()) {
+	region.setRectangle(15, 15, imageWidth-15, imageHeight-15);
     }
+    region.prepare(imageWidth, imageHeight);
 
+    // cut all values up to the threshold of Otsu und invert it, the rails
+    // are a small bright class, so the bright class of the background is
+    // split again (brightest of three classes)
+    imageHistogram.compute(image.constView(), &region);
+    int otsu = imageHistogram.otsu(imageHistogram.otsu() + 1, 255);
 
-    // cut all lower values und invert it
-    for(int y = 0; y < imageHeight; y++) {
-	for(int x = 0; x < imageWidth; x++) {
-	    if((unsigned char) imageData[y][x] < 140) {
-		imageData[y][x] = (unsigned char) 255;
-	    } else {
-		imageData[y][x] = (unsigned char) 0;
-	    }
-	}
-    }
+    // threshold und invert in one pass over the region
+    PointOps::apply(image.view(), region,
+		    PointOps::chain(PointOps::Threshold(otsu), PointOps::Invert()));
 
     //hough
-    if(houghRD() != 0) {
-	return 3;
+    if(houghRD(region) != 0) {
+	return -3;
     }
 
-    // save it in temporary file
-    return saveInTmpPgm();
+    showImage();
+    return 0;
 }
 
-int PgmImage::houghRD() {
-    // threshold of gray value
-    int threshold = 40;
-    // intervall for local maxima - must be odd
-    int intervall = 15;
-
-    // create and init akku
-    int akkuHeight = sqrt(imageHeight*imageHeight + imageWidth*imageWidth) + 1;
-    int akkuWidth = 360;
-    int **akku;
-    akku = (int**) malloc(sizeof(int*) * akkuHeight);
-    for(int i = 0; i < akkuHeight; i++){
-	akku[i] = (int*) malloc(sizeof(int) * akkuWidth);
-    }
-    for(int row = 0; row < akkuHeight; row++) {
-	for(int col = 0; col < akkuWidth; col++) {
-	    akku[row][col] = 0;
-	}
-    }
-
-    // write akku
-    for(int x = 1; x < imageWidth; x++) {
-	for(int y = 1; y < imageHeight; y++) {
-	    if(threshold > (unsigned char) imageData[y][x]) {
-		for(int t = 0; t < akkuWidth; t++) {
-		    double radian = t * M_PI / 180;
-		    int r = round(x*cos(radian) + y*sin(radian));
-		    if(r >= 0 && r < akkuHeight) {
-			akku[r][t]++;
-		    }
-		}
-	    }
-	}
+int PgmImage::houghRD(const Roi &region) {
+    // dark pixels vote, only a part of them with the progressive
+    // transformation (after the cut most pixels are dark), it stops after
+    // 4 segments (both rails, a thick rail may give two segments)
+    HoughParameters params;
+    params.grayThreshold = 40;
+    params.minVotes = 50;
+    params.minLength = imageHeight / 4;
+    params.maxGap = 5;
+    params.maxLines = 4;
+    params.roi = &region;
+    std::vector<HoughSegment> segments;
+    if(houghTransform.detectSegments(image.constView(), params, &segments) != 0) {
+	return -3;
     }
 
-    // find two maximas
-    int maxLowR = 0;
-    int maxLowT = 0;
-    int maxHighR = 0;
-    int maxHighT = 0;
-    int maxHigh = 0;
-    for(int r = 0; r < akkuHeight; r++) {
-	for(int t = 0; t < akkuWidth; t++) {
-	    if(akku[r][t] > maxHigh) {
-		maxHigh = akku[r][t];
-		maxHighR = r;
-		maxHighT = t;
-	    }
-	}
-    }
-    maxHigh = 0;
-    for(int r = 0; r < akkuHeight; r++) {
-	for(int t = 0; t < akkuWidth; t++) {
-	    if(akku[r][t] > maxHigh) {
-		if(   (r > (maxHighR + 0.15*maxHighR)
-		    || r < (maxHighR - 0.15*maxHighR))
-		    &&(t < (maxHighT + 0.10*maxHighT)
-		    && t > (maxHighT - 0.10*maxHighT))) {
-		    maxLowR = r;
-		    maxLowT = t;
-		    maxHigh = akku[r][t];
-		}
-	    }
+    // first rail: longest segment
+    std::vector<HoughSegment> lines;
+    double longest = 0;
+    for(size_t i = 0; i < segments.size(); i++) {
+	double length = hypot(segments[i].x2 - segments[i].x1, segments[i].y2 - segments[i].y1);
+	if(length > longest) {
+	    longest = length;
+	    lines.assign(1, segments[i]);
 	}
     }
-    QList<QPoint> list;
-    list.append(QPoint(maxLowT, maxLowR));
-    list.append(QPoint(maxHighT, maxHighR));
-    qDebug() << list;
 
-    // draw lines in orginial image
-    foreach(QPoint point, list) {
-	double sample = 1000;
-	double radian = point.x()*M_PI/180;
-	if(radian != 0.0) {
-	    double m = (-1) * (double) (cos(radian) / sin(radian));
-	    double b = (double) (point.y() / (sin(radian)));
-	    for(int x = 0; x < imageWidth*sample; x++) {
-		int y = round(m * (double) (x/sample) + b);
-		if(y >= 0 && y < imageHeight) {
-		    imageData[y][(int) round(x/sample)] = 0;
-		}
+    // second rail: longest segment with an other rho (+- 15%) and a
+    // similar angle (+- 10%)
+    if(!lines.empty()) {
+	HoughSegment first = lines[0];
+	longest = 0;
+	for(size_t i = 0; i < segments.size(); i++) {
+	    double length = hypot(segments[i].x2 - segments[i].x1, segments[i].y2 - segments[i].y1);
+	    if(length > longest
+		&& (   segments[i].rho > (first.rho + 0.15*first.rho)
+		    || segments[i].rho < (first.rho - 0.15*first.rho))
+		&& (   segments[i].theta < (first.theta + 0.10*first.theta)
+		    && segments[i].theta > (first.theta - 0.10*first.theta))) {
+		longest = length;
+		lines.resize(1);
+		lines.push_back(segments[i]);
 	    }
 	}
     }
 
-    // free akku
-    for(int i = 0; i < akkuHeight; i++){
-	free(akku[i]);
-    }
-    free(akku);
+    // draw rails in orginial image
+    drawSegments(lines);
+    return 0;
 }
-
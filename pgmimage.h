@@ -3,227 +3,616 @@
 
 #include <QString>
 #include <QTemporaryFile>
+#ifndef CV_NO_GUI
+#include <QImage>
+#endif
+#include <QVector>
 #include <QStringList>
 #include <QList>
 #include <QPoint>
 #include <QDebug>
 #include <math.h>
+#include "imageplane.h"
+#include "hough.h"
+#include "floodfill.h"
+#include "lanetracker.h"
+#include "roi.h"
+#include "gradient.h"
+#include "compass.h"
+#include "canny.h"
+#include "smoothing.h"
+#include "histogram.h"
+#include "scratcharena.h"
+#include "kernels.h"
+
+class Convolution;
 
 /**
   * PGM Image with functions to invert, save and create a histogram
+  *
+  * found lines are drawn into an overlay and not into the pixels, so the
+  * next operation sees the image without them, the overlay is shown and
+  * saved over the image and is a border for the flood fill
+  *
+  * the result of a convolution of the whole image is kept in 16 bit fixed
+  * point (response), a following convolution reads it without rescaling
+  * (e.g. Sobel after Gauss), it is only scaled to 8 bit when another
+  * operation, the display or save needs the pixels
   */
 class PgmImage
 {
 private:
     QTemporaryFile *tmpFile; ///< temporary file for the image
+    QFile *mappedFile; ///< pgm file which is mapped into memory (or 0)
+    uchar *mappedData; ///< mapping of mappedFile (or 0)
+    QByteArray fileContent; ///< content of the pgm file, if it cannot be mapped
     int imageHeight; ///< height of the image
     int imageWidth; ///< width of the image
-    char **imageData; ///< image (size: [imageHeight][imageWidth])
+    ImagePlane image; ///< image (size: imageWidth x imageHeight, one aligned block)
+    ImagePlane chart; ///< histogram chart (size: 256 x 500)
+    Histogram imageHistogram; ///< histogram of the last operation which counted the pixels
+    bool chartShown; ///< true -> the histogram chart is shown instead of the image
+    HoughTransform houghTransform; ///< accumulator of the Hough transformation
+    FloodFill floodFill; ///< flood fill (keeps its stack)
+    Gradient sobelGradient; ///< magnitude and orientation of the image (kept between two calls)
+    Compass compassEdges; ///< maximal response and direction of the compass operator (kept between two calls)
+    Canny cannyEdges; ///< edge map and edge list of Canny (kept between two calls)
+    Smoothing smoothing; ///< box, median and bilateral filter (keeps its integral image)
+    ImagePlane filtered; ///< result of a filter (same size as image)
+    ImagePlane overlay; ///< drawn lines, pixels which are not zero are shown black (same size as image)
+    bool overlayUsed; ///< true -> something is drawn into the overlay of this image
+    ImagePlane composed; ///< image with the overlay (shown and saved)
+    Roi roi; ///< region of interest, the operations touch only its pixels
+    ScratchArena scratch; ///< intermediate buffers of the operations (sized for the image)
+    Plane<int16_t> response; ///< result of the last convolution in fixed point (if responsePending)
+    Plane<int16_t> nextResponse; ///< result of a convolution of response (swapped with it)
+    int responseShift; ///< fraction bits of response
+    long long responseBound; ///< maximal absolute value of response (without fraction bits)
+    bool responsePending; ///< true -> response is the image, the 8 bit pixels are outdated
 
 public:
+    static const int cannyLow = 80; ///< default low threshold of canny (Sobel magnitude)
+    static const int cannyHigh = 160; ///< default high threshold of canny (Sobel magnitude)
+
     PgmImage();
     ~PgmImage();
 
     /**
-      * load an pgm image and save it in a temporary file
+      * load an pgm image (P2 or P5, up to 16 bit per pixel)
+      * the file is mapped into memory, pixels of P5 images with max value 255
+      * are used without a copy (until the image is changed)
       *
       * @param path path of the original image
       * @return  0 -> image loaded successfully
       *         -1 -> no such file
       *         -2 -> no pgm file-format
       *         -3 -> cannot handle this pgm file
-      *         -4 -> error while writing temporary file
+      *         -4 -> out of memory
       */
     int loadPgm(QString path);
 
     /**
-      * create a histogram and save it in a temporary file
+      * load a pgm image from memory (e.g. a frame of a stream), the pixels
+      * are copied, so the data can be released after the call
+      * the buffer of the last image is reused if the size does not change
+      *
+      * @param data first byte of the image (header)
+      * @param size size of the image in bytes
+      * @return  0 -> image loaded successfully
+      *         -2 -> no pgm file-format
+      *         -3 -> cannot handle this pgm file
+      *         -4 -> out of memory
+      */
+    int loadPgm(const uint8_t *data, size_t size);
+
+    /**
+      * create a histogram chart and show it instead of the image
       *
       * @return  0 -> histogram created successfully
-      *         -1 -> error while opening temporary file
-      *         -2 -> error while writing temporary file
+      *         -4 -> out of memory
       */
     int histogram();
 
     /**
-      * invert the image and save it in a temporary file
+      * invert the image
       *
       * @return  0 -> image inverted successfully
-      *         -1 -> error while opening temporary file
-      *         -2 -> error while writing temporary file
+      *         -4 -> out of memory
       */
     int invert();
 
     /**
-      * convolute the image with a given kernel and save it in a temporary file
+      * equalize the histogram of the image (the gray values are spread
+      * by their cumulative distribution)
+      *
+      * @return  0 -> image equalized successfully
+      *         -4 -> out of memory
+      */
+    int equalize();
+
+    /**
+      * binarize the image with the threshold of Otsu (gray values up to the
+      * threshold black, the others white)
+      *
+      * @return  0 -> image binarized successfully
+      *         -4 -> out of memory
+      */
+    int threshold();
+
+    /**
+      * convolute the image with a given kernel
+      * without a region of interest the result is kept in 16 bit fixed
+      * point (if it fits), the next convolution reads it directly, it is
+      * scaled to 0 .. 255 only when the 8 bit pixels are needed
       *
       * @param kernel colvolute image with this kernel
       * @param size x and y size of the kernel
       * @param rotate convolute with the kernel and with the rotated kernel
       * @return  0 -> image convolute successfully
-      *         -1 -> error while opening temporary file
-      *         -2 -> error while writing temporary file
+      *         -4 -> out of memory
       */
     int convolution(int** kernel, int size, bool rotate);
 
     /**
-      * convolute the image with a given kernel and save it in a temporary file
-      * other scale algo than upper method
+      * convolute the image with a built-in kernel (see convolution above,
+      * the inner part is calculated with the stencil of the kernel)
+      *
+      * @param kernel built-in kernel
+      * @return  0 -> image convolute successfully
+      *         -4 -> out of memory
+      */
+    int convolution(Kernels::Builtin kernel);
+
+    /**
+      * convolute the image with a given kernel
+      * other scale algo than upper method: the gray values next to the most
+      * frequent one (flat areas) are white, the others black
       *
       * @param kernel colvolute image with this kernel
       * @param size x and y size of the kernel
       * @param rotate convolute with the kernel and with the rotated kernel
       * @return  0 -> image convolute successfully
-      *         -1 -> error while opening temporary file
-      *         -2 -> error while writing temporary file
+      *         -4 -> out of memory
       */
     int convolutionLD(int** kernel, int size, bool rotate);
 
     /**
-      * calculate the Hough transformation and save it in a temporary file
+      * convolute the image with a built-in kernel (see convolutionLD above)
+      *
+      * @param kernel built-in kernel
+      * @return  0 -> image convolute successfully
+      *         -4 -> out of memory
+      */
+    int convolutionLD(Kernels::Builtin kernel);
+
+    /**
+      * smooth the image with the mean of a window (integral image, the time
+      * does not depend on the size)
+      *
+      * @param size x and y size of the window (odd, 3 .. 51)
+      * @return  0 -> image filtered successfully
+      *         -1 -> wrong size
+      *         -4 -> out of memory
+      */
+    int box(int size);
+
+    /**
+      * smooth the image with the median of a window (running histograms,
+      * the time does not depend on the size)
+      *
+      * @param size x and y size of the window (odd, 3 .. 51)
+      * @return  0 -> image filtered successfully
+      *         -1 -> wrong size
+      *         -4 -> out of memory
+      */
+    int median(int size);
+
+    /**
+      * smooth the image with the mean of a window, the pixels are weighted
+      * by the difference of their gray value to the center, so edges are
+      * kept (running histograms, the time does not depend on the size)
+      *
+      * @param size x and y size of the window (odd, 3 .. 51)
+      * @param sigma sigma of the weights of the gray value difference
+      * @return  0 -> image filtered successfully
+      *         -1 -> wrong size or sigma
+      *         -4 -> out of memory
+      */
+    int bilateral(int size, int sigma = 20);
+
+    /**
+      * replace the image by the magnitude of its gradient (Sobel, scaled to
+      * the maximum, strong edges are dark like the edges of sobelLD)
+      *
+      * @return  0 -> gradient calculated
+      *         -4 -> out of memory
+      */
+    int gradient();
+
+    /**
+      * replace the image by the maximal response of a compass operator (all
+      * 8 directions of the mask, scaled to the maximum, strong edges are
+      * dark like the edges of gradient), the directions are kept (see
+      * getCompass)
+      *
+      * @param op mask of the operator
+      * @return  0 -> compass operator calculated
+      *         -4 -> out of memory
+      */
+    int compass(Compass::Operator op);
+
+    /**
+      * replace the image by the thin edges of Canny (edges black, the rest
+      * of the region white), the edge list is kept (see getCanny)
+      *
+      * @param low low threshold of the gradient magnitude (0 .. 1443)
+      * @param high high threshold of the gradient magnitude (low .. 1443)
+      * @return  0 -> edges detected
+      *         -1 -> wrong thresholds
+      *         -4 -> out of memory
+      */
+    int canny(int low = cannyLow, int high = cannyHigh);
+
+    /**
+      * calculate the Hough transformation of the gradient of the image, a
+      * pixel votes only for the angles near its gradient orientation, and
+      * draw the lines over the image
+      *
+      * @return  0 -> calculation of Hough transformation complete
+      *         -3 -> error while calculation
+      *         -4 -> out of memory
+      */
+    int houghGradient();
+
+    /**
+      * calculate the Hough transformation and draw the lines over the image
       *
       * @return  0 -> calculation of Hough transformation complete
-      *         -1 -> error while opening temporary file
-      *         -2 -> error while writing temporary file
       *         -3 -> error while calculation
+      *         -4 -> out of memory
       */
     int hough();
 
     /**
-      * calculate the Hough transformation (for lane detection) and save it in
-      * a temporary file
+      * calculate the Hough transformation (for lane detection) and draw the
+      * lines over the image
+      * with a tracker (frames of a video) only the bands around the lanes of
+      * the last frame are searched and the estimated lanes are drawn
       *
+      * @param lines found lane lines (may be 0)
+      * @param tracker tracker of the lanes (0 -> search the whole image)
       * @return  0 -> calculation of Hough transformation complete
-      *         -1 -> error while opening temporary file
-      *         -2 -> error while writing temporary file
       *         -3 -> error while calculation
+      *         -4 -> out of memory
       */
-    int houghLD();
+    int houghLD(std::vector<HoughLine> *lines = 0, LaneTracker *tracker = 0);
 
     /**
-      * dye image with gray and save it in a temporary file
+      * calculate the Hough transformation and find the lines (the image is
+      * not changed)
+      *
+      * @param params parameters of the transformation
+      * @param lines found lines (rho, theta and votes)
+      * @return  0 -> calculation of Hough transformation complete
+      *         -3 -> error while calculation (wrong parameters)
+      *         -4 -> out of memory
+      */
+    int houghLines(const HoughParameters &params, std::vector<HoughLine> *lines);
+
+    /**
+      * calculate the progressive probabilistic Hough transformation and
+      * draw the found segments over the image
+      *
+      * @return  0 -> calculation of Hough transformation complete
+      *         -3 -> error while calculation
+      *         -4 -> out of memory
+      */
+    int houghP();
+
+    /**
+      * calculate the Hough transformation of the Canny edges of the image
+      * (only the edge pixels vote, see canny) and draw the lines over the
+      * image
       *
       * @return  0 -> calculation of Hough transformation complete
-      *         -1 -> error while opening temporary file
-      *         -2 -> error while writing temporary file
       *         -3 -> error while calculation
+      *         -4 -> out of memory
       */
-    int dyeLD();
+    int houghCanny();
 
     /**
-      * save the image (pgm) to the given path
+      * calculate the progressive probabilistic Hough transformation of the
+      * Canny edges of the image and draw the found segments over the image
+      *
+      * @return  0 -> calculation of Hough transformation complete
+      *         -3 -> error while calculation
+      *         -4 -> out of memory
+      */
+    int houghPCanny();
+
+    /**
+      * calculate the progressive probabilistic Hough transformation and find
+      * the segments (the image is not changed)
+      *
+      * @param params parameters of the transformation
+      * @param segments found segments (end points, rho, theta and votes)
+      * @return  0 -> calculation of Hough transformation complete
+      *         -3 -> error while calculation (wrong parameters)
+      *         -4 -> out of memory
+      */
+    int houghSegments(const HoughParameters &params, std::vector<HoughSegment> *segments);
+
+    /**
+      * fill the region of the seed (the connected pixels with the gray value
+      * of the seed, the drawn lines are borders) with a new gray value
+      *
+      * @param x column of the seed
+      * @param y row of the seed
+      * @param newValue new gray value of the region
+      * @param connectivity neighbours of a pixel (4 or 8)
+      * @param result filled area and bounding box (may be 0)
+      * @return  0 -> region filled
+      *         -1 -> seed outside of the image (or of the region of interest)
+      *               or seed has already newValue
+      *         -4 -> out of memory
+      */
+    int fill(int x, int y, int newValue, FloodFill::Connectivity connectivity, FillResult *result);
+
+    /**
+      * dye image with gray, the lane is searched from the middle of the
+      * region of interest (without a region: (imageWidth/2, 53))
+      *
+      * @param lane dyed area and bounding box of the lane (may be 0)
+      * @return  0 -> calculation of Hough transformation complete
+      *         -3 -> error while calculation
+      *         -4 -> out of memory (the lane may already be dyed)
+      */
+    int dyeLD(FillResult *lane = 0);
+
+    /**
+      * save the image (pgm) with the drawn lines to the given path
       *
       * @param path path to save the image
       * @return  0 -> saved successfully
       *         -1 -> error while opening path
       *         -2 -> error while writing the file
+      *         -4 -> out of memory
       */
     int savePgm(QString path);
 
     /**
-      * get the path to the temporary file
+      * save the shown image (image or histogram chart) in a temporary file
+      * and get the path to it, only needed if a file is really required
       *
-      * @return  path to temporary file
+      * @return  path to temporary file (empty on error)
       */
     QString getTmpFilePath();
 
+#ifndef CV_NO_GUI
+    /**
+      * get the shown image (image or histogram chart) without a copy
+      * the QImage wraps the pixel buffer, so it is only valid until the next
+      * load of an image of another size
+      *
+      * @return  gray image which shares the pixels of the pgm image (null
+      *          -> out of memory)
+      */
+    QImage getImage();
+#endif
+
     /**
-      * cut lower values (0 - 139), invert and hough
+      * set the region of interest, the operations (histogram, invert,
+      * convolution, filters, Hough transformation and dye) read and change
+      * only the pixels of the region, the region is kept for the next images
+      *
+      * @param region region of interest (whole image -> no restriction)
+      * @return  0 -> region set
+      *         -4 -> out of memory (the region is not changed)
+      */
+    int setRoi(const Roi &region);
+
+    /**
+      * remove the drawn lines (loading an image removes them too)
+      */
+    void clearOverlay();
+
+    const Roi &getRoi() const { return roi; } ///< region of interest
+
+    int getWidth() const { return imageWidth; } ///< width of the image
+    int getHeight() const { return imageHeight; } ///< height of the image
+
+    const ScratchArena &getScratch() const { return scratch; } ///< intermediate buffers (high water mark, allocations)
+    const Compass &getCompass() const { return compassEdges; } ///< responses and directions of the last compass
+    const Canny &getCanny() const { return cannyEdges; } ///< edge map and edge list of the last Canny
+
+    /**
+      * cut lower values (up to the threshold of Otsu of the bright class),
+      * invert and hough
+      * (without a region of interest the borders of 15 pixels are left out)
       *
       * @return  0 -> successfully
-      *         -1 -> error while opening path
-      *         -2 -> error while writing the file
       *         -3 -> error while calculating
+      *         -4 -> out of memory
       */
     int cutRD();
 
 private:
     /**
-      * save the temporary pgm file with standard data
+      * show the image instead of the histogram chart
+      */
+    void showImage();
+
+    /**
+      * get the overlay for drawing, it is allocated (or reused) and cleared
+      * on the first drawing into an image
       *
-      * @return  0 -> saved successfully
-      *         -1 -> error while opening path
-      *         -2 -> error while writing the file
+      * @param marks view on the overlay
+      * @return  0 -> overlay ready
+      *         -1 -> out of memory
       */
-    int saveInTmpPgm();
+    int overlayView(ImageView *marks);
+
+    /**
+      * get the image with the overlay (the image itself if nothing is
+      * drawn), it is composed again on every call (a pending response must
+      * be materialized before)
+      *
+      * @return  image with the drawn lines
+      */
+    const ImagePlane &composedImage();
+
+    /**
+      * release the mapped pgm file (the image must not point into it)
+      */
+    void unmapFile();
 
     /**
       * save the temporary pgm file with the given data
       *
-      * @param data two dimension array which represents the pgm image
-      * @param width width of the pgm image
-      * @param height height of the pgm image
+      * @param data view on the pgm image
       * @return  0 -> saved successfully
       *         -1 -> error while opening path
       *         -2 -> error while writing the file
       */
-    int saveInTmpPgm(char **data, int width, int height);
+    int saveInTmpPgm(const ImageView &data);
 
     /**
       * save the pgm file with the given data
       *
       * @param file instance of QFile of the file to save
-      * @param data two dimension array which represents the pgm image
-      * @param width width of the pgm image
-      * @param height height of the pgm image
+      * @param data view on the pgm image
       * @return  0 -> saved successfully
       *         -1 -> error while opening path
       *         -2 -> error while writing the file
       */
-    int savePgm(QFile *file, char **data, int width, int height);
+    int savePgm(QFile *file, const ImageView &data);
+
+    /**
+      * start an operation with intermediate buffers, the arena is sized for
+      * the largest operation on an image of this size (one int image, one
+      * int per row and the counters of the parallel bands), so it is only
+      * allocated again if the size of the image grows
+      *
+      * @return  0 -> arena ready
+      *         -4 -> out of memory
+      */
+    int beginScratch();
+
+    /**
+      * scale a pending response to 8 bit (like an int result of a
+      * convolution) and write it into the image, every operation which
+      * uses the 8 bit pixels calls it first
+      *
+      * @return  0 -> the image is current
+      *         -4 -> out of memory (the response stays pending)
+      */
+    int materialize();
+
+    /**
+      * convolute the image (see convolution)
+      *
+      * @param conv prepared kernel
+      * @return  0 -> image convolute successfully
+      *         -4 -> out of memory
+      */
+    int convolute(const Convolution &conv);
+
+    /**
+      * convolute the image and filter the gray values (see convolutionLD)
+      *
+      * @param conv prepared kernel
+      * @return  0 -> image convolute successfully
+      *         -4 -> out of memory
+      */
+    int convoluteLD(const Convolution &conv);
 
     /**
-      * recursive function to find a local maxima (threshold = 30)
+      * convolute the image (the pending response or the 8 bit pixels) into
+      * an int image in scratch, the caller writes the region of interest
+      * into the image (the response is not pending any more)
       *
-      * @param akku pointer to matrix
-      * @param height height of the matrix
-      * @param width width of the matrix
-      * @param oldX startpoint (X) to search
-      * @param oldY startpoint (Y) to search
-      * @param newX pointer to found X-point of local maxima
-      * @param newY pointer to found Y-point of local maxima
-      * @param intervall array(intervall x intervall) to search
-      * @return  1 -> no maxima found
-      *          0 -> maxima found
-      *         -1 -> error while calculation
+      * @param conv prepared kernel
+      * @param values int image (size: imageWidth x imageHeight)
+      * @return  0 -> convoluted
+      *         -4 -> out of memory
+      */
+    int convoluteToScratch(const Convolution &conv, int **values);
+
+    /**
+      * search the minimum and maximum of a convoluted image (pixels of the
+      * region of interest), the counters of the bands are taken from scratch
+      *
+      * @param values convoluted image (size: imageWidth x imageHeight)
+      * @param shift fraction bits of the values (they are cut off)
+      * @param min pointer to the minimum (at most 0)
+      * @param max pointer to the maximum (at least 0)
+      */
+    template<typename T>
+    void scaleRange(const PlaneView<T> &values, int shift, int *min, int *max);
+
+    /**
+      * write a convoluted image into the image (pixels of the region of
+      * interest), it is scaled to 0 .. 255 if min or max is outside
+      *
+      * @param values convoluted image (size: imageWidth x imageHeight)
+      * @param shift fraction bits of the values (they are cut off)
+      * @param min minimum of scaleRange
+      * @param max maximum of scaleRange
+      */
+    template<typename T>
+    void writeScaled(const PlaneView<T> &values, int shift, int min, int max);
+
+    /**
+      * prepare filtered for a filter of the given size
+      *
+      * @param size x and y size of the window
+      * @param dst view on filtered
+      * @return  0 -> filtered allocated
+      *         -1 -> wrong size (odd, 3 .. 51)
+      *         -4 -> out of memory
+      */
+    int filterView(int size, ImageView *dst);
+
+    /**
+      * write the edge strength of the region into the image, scaled to the
+      * maximum of the region (strong edges dark, no edge white)
+      *
+      * @param strengthRow function of a row y which returns the strength
+      *                    of its pixels (values <= 0 -> no edge)
+      */
+    template<typename RowFunction>
+    void drawStrength(RowFunction strengthRow);
+
+    /**
+      * copy the pixels of the region of interest from filtered into the
+      * image
       */
-    int localMaxima(int** akku, int height, int width, int oldX, int oldY, int *newX, int *newY, int intervall);
+    void takeFiltered();
 
     /**
-      * recursive function to find a local maxima (threshold = 30)
-      * optimized for lane detection
+      * draw lines of the Hough transformation into the overlay (only into
+      * the region of interest)
       *
-      * @param akku pointer to matrix
-      * @param height height of the matrix
-      * @param width width of the matrix
-      * @param oldX startpoint (X) to search
-      * @param oldY startpoint (Y) to search
-      * @param newX pointer to found X-point of local maxima
-      * @param newY pointer to found Y-point of local maxima
-      * @param intervall array(intervall x intervall) to search
-      * @return  1 -> no maxima found
-      *          0 -> maxima found
-      *         -1 -> error while calculation
+      * @param lines lines to draw
       */
-    int localMaximaLD(int** akku, int height, int width, int oldX, int oldY, int *newX, int *newY, int intervall);
+    void drawLines(const std::vector<HoughLine> &lines);
 
     /**
-      * dye image
+      * draw segments into the overlay (only into the region of interest)
       *
-      * @param curX startpoint (X) to search and replace
-      * @param curY startpoint (Y) to search and replace
-      * @param oldValue old color value
-      * @param newValue new color value
+      * @param segments segments to draw
       */
-    void dye(int curX, int curY, int oldValue, int newValue);
+    void drawSegments(const std::vector<HoughSegment> &segments);
 
     /**
-      * calculate the Hough transformation for rail detection
+      * calculate the Hough transformation for rail detection (progressive,
+      * the rails are the longest segment and the longest one parallel to it)
       *
+      * @param region only the pixels of this region vote (prepared)
       * @return  0 -> calculation of Hough transformation complete
       *         -3 -> error while calculation
       */
-    int houghRD();
+    int houghRD(const Roi &region);
 };
 
 #endif // IMAGE_H
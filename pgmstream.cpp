@@ -0,0 +1,102 @@
+#include "pgmstream.h"
+#include "pgmformat.h"
+#include <stdio.h>
+
+PgmStream::PgmStream() {
+    consumed = 0;
+    endOfFile = false;
+    padded = false;
+}
+
+PgmStream::~PgmStream() {
+    close();
+}
+
+int PgmStream::open(const QString &path) {
+    close();
+    bool opened;
+    if(path == "-") {
+	opened = file.open(stdin, QIODevice::ReadOnly);
+    } else {
+	file.setFileName(path);
+	opened = file.open(QIODevice::ReadOnly);
+    }
+    return opened ? 0 : -1;
+}
+
+void PgmStream::close() {
+    file.close();
+    buffer.clear();
+    consumed = 0;
+    endOfFile = false;
+    padded = false;
+}
+
+bool PgmStream::readMore(qint64 wanted) {
+    if(endOfFile) {
+	return false;
+    }
+    int oldSize = buffer.size();
+    buffer.resize(oldSize + wanted);
+    qint64 count = file.read(buffer.data() + oldSize, wanted);
+    buffer.resize(oldSize + (count > 0 ? count : 0));
+    if(count <= 0) {
+	endOfFile = true;
+	return false;
+    }
+    return true;
+}
+
+int PgmStream::next(const uint8_t **data, size_t *size) {
+    // remove the last image
+    buffer.remove(0, consumed);
+    consumed = 0;
+
+    while(true) {
+	// skip whitespace between two images
+	int start = 0;
+	while(start < buffer.size() && (buffer[start] == ' ' || buffer[start] == '\t'
+					|| buffer[start] == '\n' || buffer[start] == '\r')) {
+	    start++;
+	}
+	buffer.remove(0, start);
+
+	// read header and search the end of the image
+	const uint8_t *bytes = (const uint8_t*) buffer.constData();
+	size_t available = buffer.size();
+	PgmFormat format;
+	size_t imageSize = 0;
+	int ret = format.parseHeader(bytes, available);
+	if(ret == 0) {
+	    ret = format.imageSize(bytes, available, &imageSize);
+	}
+	if(ret == 0) {
+	    consumed = (int) imageSize;
+	    *data = bytes;
+	    *size = imageSize;
+	    return 0;
+	}
+	if(ret != -5) {
+	    return ret == -2 ? -2 : -3;
+	}
+
+	// header: a few bytes, raw pixels: exactly the rest of the image
+	qint64 wanted = 64;
+	if(format.magic == 5 && format.dataOffset > 0) {
+	    wanted = format.dataOffset + format.dataSize - available;
+	} else if(format.magic == 2 && format.dataOffset > 0) {
+	    wanted = 65536;
+	}
+	if(!readMore(wanted)) {
+	    if(buffer.isEmpty()) {
+		return 1;
+	    }
+	    // the last number of a plain image may end with the file
+	    if(padded) {
+		return -3;
+	    }
+	    buffer.append('\n');
+	    padded = true;
+	}
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef PGMSTREAM_H
+#define PGMSTREAM_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+  * reads pgm images one by one from a file or from stdin
+  *
+  * a stream may contain several concatenated images (e.g. the frames of a
+  * video piped into stdin), whitespace between two images is skipped
+  * only the bytes of the current image are read if its size is known, so a
+  * live source is not blocked by a large read
+  */
+class PgmStream
+{
+private:
+    QFile file; ///< file or stdin
+    QByteArray buffer; ///< read bytes which are not returned yet
+    int consumed; ///< bytes of the last returned image at the start of buffer
+    bool endOfFile; ///< true -> nothing more to read
+    bool padded; ///< true -> whitespace appended after the end of the file
+
+    /**
+      * read more bytes into the buffer
+      *
+      * @param wanted number of bytes to read (at most)
+      * @return  true -> bytes read, false -> end of the file
+      */
+    bool readMore(qint64 wanted);
+
+public:
+    PgmStream();
+    ~PgmStream();
+
+    /**
+      * open a file, "-" opens stdin
+      *
+      * @param path path of the file
+      * @return  0 -> opened successfully
+      *         -1 -> no such file
+      */
+    int open(const QString &path);
+
+    /**
+      * close the file
+      */
+    void close();
+
+    /**
+      * read the next image of the stream
+      * the image is valid until the next call
+      *
+      * @param data first byte of the image (header)
+      * @param size size of the image in bytes
+      * @return  0 -> image read
+      *          1 -> end of the stream
+      *         -2 -> no pgm file-format
+      *         -3 -> cannot handle this pgm file (or image is incomplete)
+      */
+    int next(const uint8_t **data, size_t *size);
+};
+
+#endif // PGMSTREAM_H
@@ -0,0 +1,185 @@
+#ifndef POINTOPS_H
+#define POINTOPS_H
+
+#include <stdint.h>
+#include "imageplane.h"
+#include "roi.h"
+#include "threadpool.h"
+#if defined(__SSE2__)
+#define CV_POINTOPS_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+  * operations on single pixels which are composed at compile time
+  *
+  * an operation has an operator() for one pixel and, if vectorized is true,
+  * for 16 pixels in an SSE2 register, a chain of operations is one
+  * operation again (chain(Threshold(140), Invert())), so PointOps::apply
+  * runs the whole chain in one pass over the image, the pixels of a vectorized
+  * chain are processed 16 at a time (SSE2 is part of every x86-64 cpu)
+  */
+namespace PointOps {
+
+/**
+  * invert a pixel (255 - value)
+  */
+struct Invert {
+    static const bool vectorized = true;
+    uint8_t operator()(uint8_t value) const { return (uint8_t) (255 - value); }
+#ifdef CV_POINTOPS_SSE2
+    __m128i operator()(__m128i value) const { return _mm_xor_si128(value, _mm_set1_epi8((char) 0xff)); }
+#endif
+};
+
+/**
+  * binarize a pixel: values up to level get low, the others high
+  */
+struct Threshold {
+    static const bool vectorized = true;
+    int level; ///< highest value which gets low
+    uint8_t low; ///< new value of the pixels up to level
+    uint8_t high; ///< new value of the pixels above level
+
+    Threshold(int level, uint8_t low = 0, uint8_t high = 255) : level(level), low(low), high(high) {}
+    uint8_t operator()(uint8_t value) const { return value <= level ? low : high; }
+#ifdef CV_POINTOPS_SSE2
+    __m128i operator()(__m128i value) const {
+        if(level >= 255) {
+            return _mm_set1_epi8((char) low);
+        }
+        // value > level <=> max(value, level+1) == value (unsigned)
+        __m128i above = _mm_cmpeq_epi8(_mm_max_epu8(value, _mm_set1_epi8((char) (level + 1))), value);
+        return _mm_or_si128(_mm_and_si128(above, _mm_set1_epi8((char) high)),
+                            _mm_andnot_si128(above, _mm_set1_epi8((char) low)));
+    }
+#endif
+};
+
+/**
+  * limit a pixel to a range
+  */
+struct Clamp {
+    static const bool vectorized = true;
+    uint8_t low; ///< lowest value
+    uint8_t high; ///< highest value
+
+    Clamp(uint8_t low, uint8_t high) : low(low), high(high) {}
+    uint8_t operator()(uint8_t value) const { return value < low ? low : (value > high ? high : value); }
+#ifdef CV_POINTOPS_SSE2
+    __m128i operator()(__m128i value) const {
+        return _mm_min_epu8(_mm_max_epu8(value, _mm_set1_epi8((char) low)), _mm_set1_epi8((char) high));
+    }
+#endif
+};
+
+/**
+  * replace a pixel by a table (not vectorized, the table must stay valid
+  * during apply)
+  */
+struct Lookup {
+    static const bool vectorized = false;
+    const uint8_t *table; ///< new value of every value (size: 256)
+
+    explicit Lookup(const uint8_t *table) : table(table) {}
+    uint8_t operator()(uint8_t value) const { return table[value]; }
+};
+
+/**
+  * first one operation, then the other one
+  */
+template<typename First, typename Second>
+struct Chain {
+    static const bool vectorized = First::vectorized && Second::vectorized;
+    First first; ///< operation on the original pixel
+    Second second; ///< operation on the result of first
+
+    Chain(const First &first, const Second &second) : first(first), second(second) {}
+    uint8_t operator()(uint8_t value) const { return second(first(value)); }
+#ifdef CV_POINTOPS_SSE2
+    __m128i operator()(__m128i value) const { return second(first(value)); }
+#endif
+};
+
+/**
+  * compose two operations (nested calls compose longer chains)
+  *
+  * @param first operation on the original pixel
+  * @param second operation on the result of first
+  * @return  composed operation
+  */
+template<typename First, typename Second>
+Chain<First, Second> chain(const First &first, const Second &second) {
+    return Chain<First, Second>(first, second);
+}
+
+/**
+  * loop over 16 pixels at a time, selected at compile time (only a
+  * vectorized operation has an operator() for 16 pixels)
+  */
+template<bool vectorized>
+struct VectorLoop {
+    /**
+      * @return  first pixel which is not changed
+      */
+    template<typename Op>
+    static int run(uint8_t *, int left, int, const Op &) { return left; }
+};
+
+#ifdef CV_POINTOPS_SSE2
+template<>
+struct VectorLoop<true> {
+    template<typename Op>
+    static int run(uint8_t *row, int left, int right, const Op &op) {
+        int x = left;
+        for(; x + 16 <= right; x += 16) {
+            __m128i *pixels = (__m128i *) (row + x);
+            _mm_storeu_si128(pixels, op(_mm_loadu_si128(pixels)));
+        }
+        return x;
+    }
+};
+#endif
+
+/**
+  * run an operation on a part of a row
+  *
+  * @param row first pixel of the row
+  * @param left first pixel to change
+  * @param right pixel after the last one
+  * @param op operation
+  */
+template<typename Op>
+void applyRow(uint8_t *row, int left, int right, const Op &op) {
+    int x = VectorLoop<Op::vectorized>::run(row, left, right, op);
+    for(; x < right; x++) {
+        row[x] = op(row[x]);
+    }
+}
+
+/**
+  * run an operation on the pixels of a region in one pass, the rows are
+  * changed in parallel bands
+  *
+  * @param image image to change
+  * @param region region to change (prepared for the size of image)
+  * @param op operation
+  */
+template<typename Op>
+void apply(const ImageView &image, const Roi &region, const Op &op) {
+    int top = region.top();
+    ThreadPool::instance()->parallelBands(region.bottom() - top, [&](int begin, int end, int) {
+        for(int y = begin+top; y < end+top; y++) {
+            uint8_t *row = image.row(y);
+            int count;
+            const RoiSpan *span = region.row(y, &count);
+            for(int s = 0; s < count; s++) {
+                applyRow(row, span[s].left, span[s].right, op);
+            }
+        }
+    });
+}
+
+}
+
+#endif // POINTOPS_H
@@ -0,0 +1,105 @@
+#include "raster.h"
+#include <math.h>
+#include <stdlib.h>
+
+bool Raster::clip(double *x1, double *y1, double *x2, double *y2, int width, int height) {
+    // parameter range [low, high] of x1 + t * dx inside of every border
+    double dx = *x2 - *x1;
+    double dy = *y2 - *y1;
+    double low = 0;
+    double high = 1;
+    double p[4] = { -dx, dx, -dy, dy };
+    double q[4] = { *x1, width-1 - *x1, *y1, height-1 - *y1 };
+    for(int i = 0; i < 4; i++) {
+	if(p[i] == 0) {
+	    // parallel to the border
+	    if(q[i] < 0) {
+		return false;
+	    }
+	    continue;
+	}
+	double t = q[i] / p[i];
+	if(p[i] < 0) {
+	    low = t > low ? t : low;
+	} else {
+	    high = t < high ? t : high;
+	}
+    }
+    if(low > high) {
+	return false;
+    }
+
+    double startX = *x1;
+    double startY = *y1;
+    *x1 = startX + low * dx;
+    *y1 = startY + low * dy;
+    *x2 = startX + high * dx;
+    *y2 = startY + high * dy;
+    return true;
+}
+
+int Raster::drawSegment(const ImageView &dst, int x1, int y1, int x2, int y2, uint8_t value,
+			const Roi *roi) {
+    // end points outside of the image are moved to the border
+    if(x1 < 0 || x1 >= dst.width || y1 < 0 || y1 >= dst.height
+	|| x2 < 0 || x2 >= dst.width || y2 < 0 || y2 >= dst.height) {
+	double cx1 = x1;
+	double cy1 = y1;
+	double cx2 = x2;
+	double cy2 = y2;
+	if(!clip(&cx1, &cy1, &cx2, &cy2, dst.width, dst.height)) {
+	    return 0;
+	}
+	x1 = (int) floor(cx1 + 0.5);
+	y1 = (int) floor(cy1 + 0.5);
+	x2 = (int) floor(cx2 + 0.5);
+	y2 = (int) floor(cy2 + 0.5);
+    }
+
+    // Bresenham: the error decides the step along x, y or both
+    bool whole = roi == 0 || roi->isWhole();
+    int dx = abs(x2 - x1);
+    int dy = -abs(y2 - y1);
+    int stepX = x1 < x2 ? 1 : -1;
+    int stepY = y1 < y2 ? 1 : -1;
+    int error = dx + dy;
+    int drawn = 0;
+    for(;;) {
+	if(whole || roi->contains(x1, y1)) {
+	    dst.row(y1)[x1] = value;
+	    drawn++;
+	}
+	if(x1 == x2 && y1 == y2) {
+	    break;
+	}
+	int twice = 2 * error;
+	if(twice >= dy) {
+	    error += dy;
+	    x1 += stepX;
+	}
+	if(twice <= dx) {
+	    error += dx;
+	    y1 += stepY;
+	}
+    }
+    return drawn;
+}
+
+int Raster::drawLine(const ImageView &dst, double rho, double theta, uint8_t value,
+		     const Roi *roi) {
+    // the point of the line next to the corner and the direction of the
+    // line, every pixel is nearer than the diagonal to this point
+    double radian = theta * M_PI / 180;
+    double x0 = rho * cos(radian);
+    double y0 = rho * sin(radian);
+    double reach = hypot(dst.width, dst.height) + 1;
+    double x1 = x0 + reach * sin(radian);
+    double y1 = y0 - reach * cos(radian);
+    double x2 = x0 - reach * sin(radian);
+    double y2 = y0 + reach * cos(radian);
+    if(!clip(&x1, &y1, &x2, &y2, dst.width, dst.height)) {
+	return 0;
+    }
+    return drawSegment(dst, (int) floor(x1 + 0.5), (int) floor(y1 + 0.5),
+		       (int) floor(x2 + 0.5), (int) floor(y2 + 0.5), value, roi);
+}
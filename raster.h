@@ -0,0 +1,62 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "imageplane.h"
+#include "roi.h"
+
+/**
+  * rasterization of lines and segments with integer steps (Bresenham)
+  *
+  * a line or segment is clipped to the image before the first step, so it
+  * costs one step per drawn pixel, every pixel is 8-connected to the next
+  * one (a line is a barrier for a 4-connected flood fill)
+  */
+class Raster
+{
+public:
+    /**
+      * clip a segment to the pixel centers of an image (Liang-Barsky)
+      *
+      * @param x1 column of the first end point (moved into the image)
+      * @param y1 row of the first end point (moved into the image)
+      * @param x2 column of the second end point (moved into the image)
+      * @param y2 row of the second end point (moved into the image)
+      * @param width width of the image
+      * @param height height of the image
+      * @return  true -> a part of the segment is inside of the image
+      */
+    static bool clip(double *x1, double *y1, double *x2, double *y2, int width, int height);
+
+    /**
+      * draw a segment
+      *
+      * @param dst image to draw into
+      * @param x1 column of the first end point
+      * @param y1 row of the first end point
+      * @param x2 column of the second end point
+      * @param y2 row of the second end point
+      * @param value gray value of the segment
+      * @param roi only the pixels of this region are drawn (prepared for the
+      *            size of dst, 0 -> whole image)
+      * @return  number of drawn pixels
+      */
+    static int drawSegment(const ImageView &dst, int x1, int y1, int x2, int y2, uint8_t value,
+                           const Roi *roi = 0);
+
+    /**
+      * draw a line through the whole image
+      * (rho = x * cos(theta) + y * sin(theta))
+      *
+      * @param dst image to draw into
+      * @param rho distance to the upper left corner in pixels
+      * @param theta angle of the normal in degree
+      * @param value gray value of the line
+      * @param roi only the pixels of this region are drawn (prepared for the
+      *            size of dst, 0 -> whole image)
+      * @return  number of drawn pixels
+      */
+    static int drawLine(const ImageView &dst, double rho, double theta, uint8_t value,
+                        const Roi *roi = 0);
+};
+
+#endif // RASTER_H
@@ -0,0 +1,113 @@
+#include "roi.h"
+#include <math.h>
+#include <algorithm>
+
+Roi::Roi() {
+    spanWidth = -1;
+    spanHeight = -1;
+    firstRow = 0;
+    lastRow = 0;
+    pixels = 0;
+}
+
+void Roi::clear() {
+    corners.clear();
+    spanWidth = -1;
+    spanHeight = -1;
+}
+
+void Roi::setRectangle(int left, int top, int right, int bottom) {
+    RoiPoint points[4] = { { (double) left, (double) top }, { (double) right, (double) top },
+			   { (double) right, (double) bottom }, { (double) left, (double) bottom } };
+    setPolygon(std::vector<RoiPoint>(points, points + 4));
+}
+
+void Roi::setPolygon(const std::vector<RoiPoint> &points) {
+    corners = points;
+    if(corners.size() < 3) {
+	// no area, but not the whole image
+	RoiPoint none = { 0, 0 };
+	corners.assign(1, none);
+    }
+    spanWidth = -1;
+    spanHeight = -1;
+}
+
+void Roi::prepare(int width, int height) {
+    if(width == spanWidth && height == spanHeight) {
+	return;
+    }
+    spanWidth = width;
+    spanHeight = height;
+    rowStart.assign(height + 1, 0);
+    spans.clear();
+    firstRow = height;
+    lastRow = 0;
+    pixels = 0;
+
+    std::vector<double> crossings;
+    for(int y = 0; y < height; y++) {
+	rowStart[y] = (int) spans.size();
+	if(corners.empty()) {
+	    // whole image
+	    RoiSpan span = { 0, width };
+	    spans.push_back(span);
+	} else if(corners.size() >= 3) {
+	    // crossings of the edges with the center of the row, every pair of
+	    // crossings encloses pixels of the polygon
+	    double center = y + 0.5;
+	    crossings.clear();
+	    for(size_t i = 0; i < corners.size(); i++) {
+		const RoiPoint &a = corners[i];
+		const RoiPoint &b = corners[(i+1) % corners.size()];
+		if((a.y <= center && center < b.y) || (b.y <= center && center < a.y)) {
+		    crossings.push_back(a.x + (center - a.y) * (b.x - a.x) / (b.y - a.y));
+		}
+	    }
+	    std::sort(crossings.begin(), crossings.end());
+	    for(size_t i = 0; i + 1 < crossings.size(); i += 2) {
+		// pixels with the center in [crossing, next crossing)
+		int left = (int) ceil(crossings[i] - 0.5);
+		int right = (int) ceil(crossings[i+1] - 0.5);
+		left = left > 0 ? left : 0;
+		right = right < width ? right : width;
+		if(left >= right) {
+		    continue;
+		}
+		if(!spans.empty() && (int) spans.size() > rowStart[y] && spans.back().right >= left) {
+		    spans.back().right = right > spans.back().right ? right : spans.back().right;
+		} else {
+		    RoiSpan span = { left, right };
+		    spans.push_back(span);
+		}
+	    }
+	}
+
+	for(int i = rowStart[y]; i < (int) spans.size(); i++) {
+	    pixels += spans[i].right - spans[i].left;
+	}
+	if(rowStart[y] < (int) spans.size()) {
+	    firstRow = y < firstRow ? y : firstRow;
+	    lastRow = y + 1;
+	}
+    }
+    rowStart[height] = (int) spans.size();
+    if(firstRow >= lastRow) {
+	firstRow = 0;
+	lastRow = 0;
+    }
+}
+
+bool Roi::contains(int x, int y) const {
+    if(y < 0 || y >= spanHeight) {
+	return false;
+    }
+    int count;
+    const RoiSpan *span = row(y, &count);
+    for(int i = 0; i < count; i++) {
+	if(x >= span[i].left && x < span[i].right) {
+	    return true;
+	}
+    }
+    return false;
+}
@@ -0,0 +1,108 @@
+#ifndef ROI_H
+#define ROI_H
+
+#include <vector>
+
+/**
+  * corner of a polygon in pixel coordinates (the center of pixel (x, y) is
+  * at (x + 0.5, y + 0.5))
+  */
+struct RoiPoint {
+    double x; ///< column
+    double y; ///< row
+};
+
+/**
+  * pixels [left, right) of a row
+  */
+struct RoiSpan {
+    int left; ///< first column
+    int right; ///< column after the last one
+};
+
+/**
+  * region of interest: a rectangle, a polygon or the whole image
+  *
+  * the region is stored as spans of pixels per row for the size of an
+  * image, so the operations visit the pixels of the region only (and not
+  * every pixel with a check)
+  * a pixel belongs to a polygon if its center is inside (even-odd rule)
+  */
+class Roi
+{
+private:
+    std::vector<RoiPoint> corners; ///< corners of the polygon (empty -> whole image)
+    int spanWidth; ///< width of the image of the spans
+    int spanHeight; ///< height of the image of the spans
+    std::vector<int> rowStart; ///< index of the first span of a row (size: height + 1)
+    std::vector<RoiSpan> spans; ///< spans of all rows, left to right
+    int firstRow; ///< first row with a span
+    int lastRow; ///< row after the last row with a span
+    long pixels; ///< number of pixels of the region
+
+public:
+    /**
+      * whole image
+      */
+    Roi();
+
+    /**
+      * use the whole image
+      */
+    void clear();
+
+    /**
+      * use a rectangle, the pixels [left, right) x [top, bottom)
+      *
+      * @param left first column
+      * @param top first row
+      * @param right column after the last one
+      * @param bottom row after the last one
+      */
+    void setRectangle(int left, int top, int right, int bottom);
+
+    /**
+      * use a polygon
+      *
+      * @param points corners of the polygon (at least 3, otherwise the
+      *               region is empty)
+      */
+    void setPolygon(const std::vector<RoiPoint> &points);
+
+    /**
+      * calculate the spans for the size of an image (nothing to do if the
+      * size does not change), needed before the spans are used
+      *
+      * @param width width of the image
+      * @param height height of the image
+      */
+    void prepare(int width, int height);
+
+    bool isWhole() const { return corners.empty(); } ///< true if the whole image is used
+    int top() const { return firstRow; } ///< first row with pixels
+    int bottom() const { return lastRow; } ///< row after the last row with pixels
+    long area() const { return pixels; } ///< number of pixels
+
+    /**
+      * get the spans of a row
+      *
+      * @param y row (0 .. height-1 of the prepared size)
+      * @param count number of spans
+      * @return  first span of the row
+      */
+    const RoiSpan *row(int y, int *count) const {
+        *count = rowStart[y+1] - rowStart[y];
+        return spans.empty() ? 0 : &spans[rowStart[y]];
+    }
+
+    /**
+      * check if a pixel belongs to the region
+      *
+      * @param x column
+      * @param y row
+      * @return  true -> pixel is inside
+      */
+    bool contains(int x, int y) const;
+};
+
+#endif // ROI_H
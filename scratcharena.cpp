@@ -0,0 +1,44 @@
+#include "scratcharena.h"
+#include "alignedblock.h"
+#include <stdlib.h>
+
+ScratchArena::ScratchArena() {
+    block = 0;
+    buffer = 0;
+    capacity = 0;
+    used = 0;
+    highWaterMark = 0;
+    allocationCount = 0;
+    operationAllocations = 0;
+}
+
+ScratchArena::~ScratchArena() {
+    release();
+}
+
+int ScratchArena::begin(size_t bytes) {
+    used = 0;
+    operationAllocations = 0;
+    if(bytes <= capacity) {
+	return 0;
+    }
+
+    // a new block (plus space to align it), the old buffers are not needed
+    release();
+    buffer = (char*) alignedAllocate(bytes, alignment, &block);
+    if(buffer == 0) {
+	return -1;
+    }
+    capacity = bytes;
+    allocationCount++;
+    operationAllocations = 1;
+    return 0;
+}
+
+void ScratchArena::release() {
+    free(block);
+    block = 0;
+    buffer = 0;
+    capacity = 0;
+    used = 0;
+}
@@ -0,0 +1,90 @@
+#ifndef SCRATCHARENA_H
+#define SCRATCHARENA_H
+
+#include <stddef.h>
+
+/**
+  * memory for the intermediate buffers of an operation (e.g. the int image
+  * of a convolution) in one 64 byte aligned block
+  *
+  * an operation starts with begin and the size it needs at most, then it
+  * takes its buffers one after the other, the buffers are valid until the
+  * next begin, the block grows only if an operation needs more than all
+  * operations before, so repeated operations on images of the same size do
+  * not allocate memory
+  * the arena is not thread safe, the buffers are taken before the parallel
+  * bands start
+  */
+class ScratchArena
+{
+private:
+    void *block; ///< memory block returned by malloc
+    char *buffer; ///< first aligned byte in block
+    size_t capacity; ///< usable bytes of buffer
+    size_t used; ///< bytes taken since the last begin
+    size_t highWaterMark; ///< most bytes taken by one operation
+    long allocationCount; ///< blocks allocated since the arena was created
+    int operationAllocations; ///< blocks allocated by the last begin (0 or 1)
+
+    // the arena owns its block, so it cannot be copied
+    ScratchArena(const ScratchArena &);
+    ScratchArena &operator=(const ScratchArena &);
+
+public:
+    static const int alignment = 64; ///< alignment of every buffer
+
+    ScratchArena();
+    ~ScratchArena();
+
+    /**
+      * get the bytes of a buffer in the arena (rounded up to the alignment)
+      *
+      * @param count number of elements
+      * @return  bytes needed for count elements of type T
+      */
+    template<typename T>
+    static size_t bytesFor(size_t count) {
+        return (count * sizeof(T) + alignment - 1) / alignment * alignment;
+    }
+
+    /**
+      * start an operation, all buffers of the last one are given back
+      *
+      * @param bytes most bytes the operation takes (sum of bytesFor)
+      * @return  0 -> arena ready
+      *         -1 -> out of memory
+      */
+    int begin(size_t bytes);
+
+    /**
+      * take an aligned buffer (content undefined)
+      *
+      * @param count number of elements
+      * @return  buffer for count elements of type T (0 -> more than given to begin)
+      */
+    template<typename T>
+    T *take(size_t count) {
+        size_t bytes = bytesFor<T>(count);
+        if(bytes > capacity - used) {
+            return 0;
+        }
+        T *result = (T*) (buffer + used);
+        used += bytes;
+        if(used > highWaterMark) {
+            highWaterMark = used;
+        }
+        return result;
+    }
+
+    /**
+      * free the block of the arena (the counters are kept)
+      */
+    void release();
+
+    size_t size() const { return capacity; } ///< usable bytes of the block
+    size_t highWater() const { return highWaterMark; } ///< most bytes taken by one operation
+    long allocations() const { return allocationCount; } ///< blocks allocated since the arena was created
+    int lastAllocations() const { return operationAllocations; } ///< blocks allocated by the last operation
+};
+
+#endif // SCRATCHARENA_H
@@ -0,0 +1,281 @@
+#include "simd.h"
+#include <atomic>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CV_SIMD_X86
+#include <immintrin.h>
+#define CV_TARGET_SSE2 __attribute__((target("sse2")))
+#define CV_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+static std::atomic<int> activeSet(-1); ///< instruction set of setActive (-1 -> supported one)
+
+/**
+  * detect the best instruction set of the cpu
+  */
+static Simd::InstructionSet detect() {
+#ifdef CV_SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+	return Simd::AVX2;
+    }
+    if(__builtin_cpu_supports("sse2")) {
+	return Simd::SSE2;
+    }
+#endif
+    return Simd::Scalar;
+}
+
+Simd::InstructionSet Simd::supported() {
+    // detected once, the first call may come from several threads
+    static const InstructionSet best = detect();
+    return best;
+}
+
+Simd::InstructionSet Simd::active() {
+    int set = activeSet.load(std::memory_order_relaxed);
+    return set < 0 ? supported() : (InstructionSet) set;
+}
+
+void Simd::setActive(InstructionSet set) {
+    InstructionSet best = supported();
+    activeSet = set > best ? best : set;
+}
+
+/**
+  * scalar version of multiplyAdd (also used for the last pixels of a row)
+  */
+template <typename Pixel>
+static void multiplyAddScalar(const Pixel *const *src, const int16_t *coeff, int taps,
+			      int32_t *dst, int from, int n) {
+    for(int i = from; i < n; i++) {
+	dst[i] = 0;
+    }
+    for(int t = 0; t < taps; t++) {
+	const Pixel *row = src[t];
+	int32_t value = coeff[t];
+	for(int i = from; i < n; i++) {
+	    dst[i] += value * row[i];
+	}
+    }
+}
+
+#ifdef CV_SIMD_X86
+
+/**
+  * taps are processed in pairs: two pixels are interleaved (8 bit pixels
+  * extended to 16 bit) and multiplied with two 16 bit coefficients by one
+  * madd (sum in 32 bit)
+  */
+template <typename Pixel>
+struct TapPairs {
+    const Pixel *first[Simd::maxTaps/2 + 1]; ///< row of the first tap
+    const Pixel *second[Simd::maxTaps/2 + 1]; ///< row of the second tap
+    int32_t coeff[Simd::maxTaps/2 + 1]; ///< both coefficients (low: first, high: second)
+    int count; ///< number of pairs
+
+    TapPairs(const Pixel *const *src, const int16_t *c, int taps) {
+	count = (taps + 1) / 2;
+	for(int p = 0; p < count; p++) {
+	    int t = 2*p;
+	    bool odd = t + 1 == taps;
+	    first[p] = src[t];
+	    second[p] = odd ? src[t] : src[t+1];
+	    int16_t c1 = odd ? 0 : c[t+1];
+	    coeff[p] = (int32_t) ((uint16_t) c[t] | ((uint32_t) (uint16_t) c1 << 16));
+	}
+    }
+};
+
+/**
+  * SSE2: 16 pixels per iteration, Pairs > 0 -> fixed number of pairs (unrolled)
+  */
+template <int Pairs>
+CV_TARGET_SSE2
+static int multiplyAddSse2(const TapPairs<uint8_t> &pairs, int32_t *dst, int n) {
+    int count = Pairs > 0 ? Pairs : pairs.count;
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for(; i + 16 <= n; i += 16) {
+	__m128i acc0 = zero;
+	__m128i acc1 = zero;
+	__m128i acc2 = zero;
+	__m128i acc3 = zero;
+	for(int p = 0; p < count; p++) {
+	    __m128i c = _mm_set1_epi32(pairs.coeff[p]);
+	    __m128i a = _mm_loadu_si128((const __m128i*) (pairs.first[p] + i));
+	    __m128i b = _mm_loadu_si128((const __m128i*) (pairs.second[p] + i));
+	    __m128i abLow = _mm_unpacklo_epi8(a, b);
+	    __m128i abHigh = _mm_unpackhi_epi8(a, b);
+	    acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi8(abLow, zero), c));
+	    acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi8(abLow, zero), c));
+	    acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi8(abHigh, zero), c));
+	    acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi8(abHigh, zero), c));
+	}
+	_mm_storeu_si128((__m128i*) (dst + i), acc0);
+	_mm_storeu_si128((__m128i*) (dst + i + 4), acc1);
+	_mm_storeu_si128((__m128i*) (dst + i + 8), acc2);
+	_mm_storeu_si128((__m128i*) (dst + i + 12), acc3);
+    }
+    return i;
+}
+
+/**
+  * AVX2: 16 pixels per iteration, Pairs > 0 -> fixed number of pairs (unrolled)
+  */
+template <int Pairs>
+CV_TARGET_AVX2
+static int multiplyAddAvx2(const TapPairs<uint8_t> &pairs, int32_t *dst, int n) {
+    int count = Pairs > 0 ? Pairs : pairs.count;
+    int i = 0;
+    for(; i + 16 <= n; i += 16) {
+	__m256i acc0 = _mm256_setzero_si256();
+	__m256i acc1 = _mm256_setzero_si256();
+	for(int p = 0; p < count; p++) {
+	    __m256i c = _mm256_set1_epi32(pairs.coeff[p]);
+	    __m128i a = _mm_loadu_si128((const __m128i*) (pairs.first[p] + i));
+	    __m128i b = _mm_loadu_si128((const __m128i*) (pairs.second[p] + i));
+	    __m256i abLow = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(a, b));
+	    __m256i abHigh = _mm256_cvtepu8_epi16(_mm_unpackhi_epi8(a, b));
+	    acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(abLow, c));
+	    acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(abHigh, c));
+	}
+	_mm256_storeu_si256((__m256i*) (dst + i), acc0);
+	_mm256_storeu_si256((__m256i*) (dst + i + 8), acc1);
+    }
+    return i;
+}
+
+/**
+  * SSE2 with 16 bit pixels: 16 pixels per iteration, the pixels of a pair
+  * are interleaved without extension
+  */
+template <int Pairs>
+CV_TARGET_SSE2
+static int multiplyAddSse2(const TapPairs<int16_t> &pairs, int32_t *dst, int n) {
+    int count = Pairs > 0 ? Pairs : pairs.count;
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for(; i + 16 <= n; i += 16) {
+	__m128i acc0 = zero;
+	__m128i acc1 = zero;
+	__m128i acc2 = zero;
+	__m128i acc3 = zero;
+	for(int p = 0; p < count; p++) {
+	    __m128i c = _mm_set1_epi32(pairs.coeff[p]);
+	    __m128i a0 = _mm_loadu_si128((const __m128i*) (pairs.first[p] + i));
+	    __m128i b0 = _mm_loadu_si128((const __m128i*) (pairs.second[p] + i));
+	    __m128i a1 = _mm_loadu_si128((const __m128i*) (pairs.first[p] + i + 8));
+	    __m128i b1 = _mm_loadu_si128((const __m128i*) (pairs.second[p] + i + 8));
+	    acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(a0, b0), c));
+	    acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(a0, b0), c));
+	    acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(a1, b1), c));
+	    acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(a1, b1), c));
+	}
+	_mm_storeu_si128((__m128i*) (dst + i), acc0);
+	_mm_storeu_si128((__m128i*) (dst + i + 4), acc1);
+	_mm_storeu_si128((__m128i*) (dst + i + 8), acc2);
+	_mm_storeu_si128((__m128i*) (dst + i + 12), acc3);
+    }
+    return i;
+}
+
+/**
+  * AVX2 with 16 bit pixels: 16 pixels per iteration, the interleave works
+  * per 128 bit lane, so the lanes of the sums are put in order at the end
+  */
+template <int Pairs>
+CV_TARGET_AVX2
+static int multiplyAddAvx2(const TapPairs<int16_t> &pairs, int32_t *dst, int n) {
+    int count = Pairs > 0 ? Pairs : pairs.count;
+    int i = 0;
+    for(; i + 16 <= n; i += 16) {
+	__m256i acc0 = _mm256_setzero_si256();
+	__m256i acc1 = _mm256_setzero_si256();
+	for(int p = 0; p < count; p++) {
+	    __m256i c = _mm256_set1_epi32(pairs.coeff[p]);
+	    __m256i a = _mm256_loadu_si256((const __m256i*) (pairs.first[p] + i));
+	    __m256i b = _mm256_loadu_si256((const __m256i*) (pairs.second[p] + i));
+	    acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), c));
+	    acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), c));
+	}
+	// acc0: pixels 0-3 und 8-11, acc1: pixels 4-7 und 12-15
+	_mm256_storeu_si256((__m256i*) (dst + i), _mm256_permute2x128_si256(acc0, acc1, 0x20));
+	_mm256_storeu_si256((__m256i*) (dst + i + 8), _mm256_permute2x128_si256(acc0, acc1, 0x31));
+    }
+    return i;
+}
+
+/**
+  * select the unrolled version for small kernels (3x3: up to 5 pairs,
+  * 5x5: up to 13 pairs) or the generic one
+  */
+template <template <int> class Kernel, typename Pixel>
+static int dispatchPairs(const TapPairs<Pixel> &pairs, int32_t *dst, int n) {
+    switch(pairs.count) {
+    case 1: return Kernel<1>::run(pairs, dst, n);
+    case 2: return Kernel<2>::run(pairs, dst, n);
+    case 3: return Kernel<3>::run(pairs, dst, n);
+    case 4: return Kernel<4>::run(pairs, dst, n);
+    case 5: return Kernel<5>::run(pairs, dst, n);
+    case 6: return Kernel<6>::run(pairs, dst, n);
+    case 7: return Kernel<7>::run(pairs, dst, n);
+    case 8: return Kernel<8>::run(pairs, dst, n);
+    case 9: return Kernel<9>::run(pairs, dst, n);
+    case 10: return Kernel<10>::run(pairs, dst, n);
+    case 11: return Kernel<11>::run(pairs, dst, n);
+    case 12: return Kernel<12>::run(pairs, dst, n);
+    case 13: return Kernel<13>::run(pairs, dst, n);
+    default: return Kernel<0>::run(pairs, dst, n);
+    }
+}
+
+template <int Pairs>
+struct Sse2Kernel {
+    template <typename Pixel>
+    static int run(const TapPairs<Pixel> &pairs, int32_t *dst, int n) {
+	return multiplyAddSse2<Pairs>(pairs, dst, n);
+    }
+};
+
+template <int Pairs>
+struct Avx2Kernel {
+    template <typename Pixel>
+    static int run(const TapPairs<Pixel> &pairs, int32_t *dst, int n) {
+	return multiplyAddAvx2<Pairs>(pairs, dst, n);
+    }
+};
+
+#endif // CV_SIMD_X86
+
+/**
+  * multiplyAdd with the active instruction set
+  */
+template <typename Pixel>
+static void multiplyAddRows(const Pixel *const *src, const int16_t *coeff, int taps,
+			    int32_t *dst, int n) {
+    int done = 0;
+#ifdef CV_SIMD_X86
+    Simd::InstructionSet set = Simd::active();
+    if(set != Simd::Scalar && taps > 0 && taps <= Simd::maxTaps) {
+	TapPairs<Pixel> pairs(src, coeff, taps);
+	if(set == Simd::AVX2) {
+	    done = dispatchPairs<Avx2Kernel>(pairs, dst, n);
+	} else {
+	    done = dispatchPairs<Sse2Kernel>(pairs, dst, n);
+	}
+    }
+#endif
+    // last pixels (or everything without vectors)
+    multiplyAddScalar(src, coeff, taps, dst, done, n);
+}
+
+void Simd::multiplyAdd(const uint8_t *const *src, const int16_t *coeff, int taps,
+		       int32_t *dst, int n) {
+    multiplyAddRows(src, coeff, taps, dst, n);
+}
+
+void Simd::multiplyAdd(const int16_t *const *src, const int16_t *coeff, int taps,
+		       int32_t *dst, int n) {
+    multiplyAddRows(src, coeff, taps, dst, n);
+}
@@ -0,0 +1,76 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+
+/**
+  * vectorized row kernels, the instruction set (scalar, SSE2 or AVX2) is
+  * selected at runtime by the features of the cpu
+  */
+class Simd
+{
+public:
+    /**
+      * available implementations
+      */
+    enum InstructionSet {
+        Scalar = 0, ///< plain C++
+        SSE2 = 1, ///< 128 bit vectors
+        AVX2 = 2 ///< 256 bit vectors
+    };
+
+    static const int maxTaps = 23*23; ///< maximal number of taps of multiplyAdd
+
+    /**
+      * get the best instruction set of this cpu
+      *
+      * @return  supported instruction set
+      */
+    static InstructionSet supported();
+
+    /**
+      * get the instruction set which is used
+      *
+      * @return  active instruction set
+      */
+    static InstructionSet active();
+
+    /**
+      * use another instruction set (e.g. to compare with the scalar code),
+      * it is limited to the supported instruction set
+      *
+      * @param set instruction set to use
+      */
+    static void setActive(InstructionSet set);
+
+    /**
+      * multiply 8 bit rows with 16 bit coefficients and add them up:
+      * dst[i] = coeff[0] * src[0][i] + ... + coeff[taps-1] * src[taps-1][i]
+      * the sums must fit in 32 bit, the result is the same for every
+      * instruction set
+      *
+      * @param src one row per tap
+      * @param coeff one coefficient per tap
+      * @param taps number of taps (up to maxTaps)
+      * @param dst sums (size: n)
+      * @param n number of pixels
+      */
+    static void multiplyAdd(const uint8_t *const *src, const int16_t *coeff, int taps,
+                            int32_t *dst, int n);
+
+    /**
+      * multiply 16 bit rows (e.g. fixed point results of a convolution)
+      * with 16 bit coefficients and add them up like the 8 bit version
+      * the sums (and the sums of two products) must fit in 32 bit
+      *
+      * @param src one row per tap
+      * @param coeff one coefficient per tap
+      * @param taps number of taps (up to maxTaps)
+      * @param dst sums (size: n)
+      * @param n number of pixels
+      */
+    static void multiplyAdd(const int16_t *const *src, const int16_t *coeff, int taps,
+                            int32_t *dst, int n);
+};
+
+#endif // SIMD_H
@@ -0,0 +1,396 @@
+#include <stdio.h>
+#include <vector>
+#include "simd.h"
+#include "convolution.h"
+#include "kernels.h"
+#include "threadpool.h"
+#include "roi.h"
+#include "imageplane.h"
+
+/**
+  * test of the vectorized code: every instruction set and every number of
+  * threads must give the same values as the scalar code in one thread (the
+  * stencils of the built-in kernels the same values as the generic loops)
+  */
+
+static const Simd::InstructionSet sets[3] = { Simd::Scalar, Simd::SSE2, Simd::AVX2 };
+static const char *setNames[3] = { "scalar", "SSE2", "AVX2" };
+static const int threadCounts[4] = { 1, 2, 3, 8 };
+
+static int cases = 0; ///< compared results
+static int failedCases = 0; ///< results with at least one different value
+
+static uint32_t randomState = 1; ///< state of random (same numbers in every run)
+
+/**
+  * get a pseudo random number
+  *
+  * @param n number of values
+  * @return  0 .. n-1
+  */
+static int randomNumber(int n) {
+    randomState = randomState * 1103515245u + 12345u;
+    return (int) ((randomState >> 8) % (uint32_t) n);
+}
+
+/**
+  * compare a result with the reference and print the first difference
+  *
+  * @param name description of the case
+  * @param reference scalar result
+  * @param result result of the case
+  * @param width values per row
+  * @param height rows
+  * @param roi compare only the pixels of this region (0 -> all values)
+  */
+template<typename T>
+static void compare(const char *name, const PlaneView<T> &reference, const PlaneView<T> &result,
+		    int width, int height, const Roi *roi) {
+    cases++;
+    long differences = 0;
+    int firstX = 0;
+    int firstY = 0;
+    for(int y = 0; y < height; y++) {
+	const T *expected = reference.row(y);
+	const T *actual = result.row(y);
+	int count = 1;
+	RoiSpan whole = { 0, width };
+	const RoiSpan *span = roi != 0 ? roi->row(y, &count) : &whole;
+	for(int s = 0; s < count; s++) {
+	    for(int x = span[s].left; x < span[s].right; x++) {
+		if(expected[x] != actual[x]) {
+		    if(differences == 0) {
+			firstX = x;
+			firstY = y;
+		    }
+		    differences++;
+		}
+	    }
+	}
+    }
+    if(differences > 0) {
+	failedCases++;
+	printf("FAIL %s: %ld values differ, first at (%d, %d): %ld instead of %ld\n", name,
+	       differences, firstX, firstY, (long) result.row(firstY)[firstX],
+	       (long) reference.row(firstY)[firstX]);
+    }
+}
+
+/**
+  * test multiplyAdd of random rows (8 or 16 bit) with random coefficients,
+  * all row lengths up to 200 (remainders of every vector width) and
+  * unaligned rows
+  *
+  * @param type description of the pixel type
+  * @param pixelMin smallest value of a pixel
+  * @param pixelMax largest value of a pixel
+  */
+template<typename Pixel>
+static void testMultiplyAdd(const char *type, int pixelMin, int pixelMax) {
+    const int maxLength = 200;
+    std::vector<Pixel> pixels((size_t) Simd::maxTaps * (maxLength + 16));
+    std::vector<const Pixel*> rows(Simd::maxTaps);
+    std::vector<int16_t> coeff(Simd::maxTaps);
+    std::vector<int32_t> reference(maxLength);
+    std::vector<int32_t> result(maxLength);
+
+    for(int run = 0; run < 400; run++) {
+	int taps = run < 40 ? run % 20 + 1 : randomNumber(Simd::maxTaps) + 1;
+	int n = run < 40 ? run * 5 % (maxLength + 1) : randomNumber(maxLength + 1);
+
+	// the sums (and the sums of two products) must fit in 32 bit
+	long long pixelBound = -pixelMin > pixelMax ? -pixelMin : pixelMax;
+	long long coeffBound = 0x7fffffffLL / (pixelBound * (taps + 1));
+	coeffBound = coeffBound > 32767 ? 32767 : coeffBound;
+	for(int t = 0; t < taps; t++) {
+	    Pixel *row = &pixels[(size_t) t * (maxLength + 16) + randomNumber(16)];
+	    for(int i = 0; i < n; i++) {
+		row[i] = (Pixel) (pixelMin + randomNumber(pixelMax - pixelMin + 1));
+	    }
+	    rows[t] = row;
+	    coeff[t] = (int16_t) (randomNumber((int) coeffBound * 2 + 1) - coeffBound);
+	}
+
+	Simd::setActive(Simd::Scalar);
+	Simd::multiplyAdd(&rows[0], &coeff[0], taps, &reference[0], n);
+	for(int s = 1; s < 3; s++) {
+	    Simd::setActive(sets[s]);
+	    if(Simd::active() != sets[s]) {
+		continue;
+	    }
+	    Simd::multiplyAdd(&rows[0], &coeff[0], taps, &result[0], n);
+	    char name[96];
+	    snprintf(name, sizeof(name), "multiplyAdd %s %s, %d taps, %d pixels", type,
+		     setNames[s], taps, n);
+	    PlaneView<int32_t> expected = { &reference[0], n, 1, maxLength };
+	    PlaneView<int32_t> actual = { &result[0], n, 1, maxLength };
+	    compare(name, expected, actual, n, 1, 0);
+	}
+    }
+}
+
+/**
+  * kernel of a case of the convolution test
+  */
+struct KernelCase {
+    const char *name; ///< description
+    int size; ///< x and y size (0 -> built-in kernel)
+    bool rotate; ///< rotating kernel
+    bool gauss; ///< Gauss kernel (separable) instead of random values
+    Kernels::Builtin builtin; ///< built-in kernel (if size is 0)
+};
+
+/**
+  * apply a convolution in all variants (8 bit or 16 bit source, int or
+  * 16 bit result) with every instruction set and number of threads and
+  * compare with the scalar result of the reference in one thread
+  *
+  * @param kernelName description of the kernel
+  * @param conv prepared kernel
+  * @param reference the same kernel (conv itself, or the generic loops for
+  *                  the stencil of a built-in kernel)
+  * @param image random 8 bit image
+  * @param fixed random 16 bit fixed point image
+  * @param fixedShift fraction bits of fixed
+  * @param roiName description of the region
+  * @param roi region (prepared for the size of the images, 0 -> whole image)
+  */
+static void testConvolution(const char *kernelName, const Convolution &conv,
+			    const Convolution &reference, const Plane<uint8_t> &image, const Plane<int16_t> &fixed,
+			    int fixedShift, const char *roiName, const Roi *roi) {
+    int width = image.width();
+    int height = image.height();
+
+    // 16 bit results need a shift which fits the bound of the kernel
+    long long bounds[2] = { conv.bound(255), conv.bound(255LL << fixedShift) };
+    int shifts[2] = { -1, -1 };
+    for(int v = 0; v < 2; v++) {
+	if(bounds[v] <= 32767) {
+	    shifts[v] = 0;
+	    while(shifts[v] < 14 && (bounds[v] << (shifts[v]+1)) <= 32767) {
+		shifts[v]++;
+	    }
+	}
+    }
+
+    std::vector<int> intReference((size_t) width * height);
+    std::vector<int> intResult((size_t) width * height);
+    Plane<int16_t> shortReference;
+    Plane<int16_t> shortResult;
+    if(shortReference.allocate(width, height) != 0 || shortResult.allocate(width, height) != 0) {
+	printf("FAIL %s: out of memory\n", kernelName);
+	failedCases++;
+	return;
+    }
+
+    // variant 0: 8 bit -> int, 1: 8 bit -> 16 bit, 2: 16 bit -> 16 bit,
+    // 3: 16 bit -> int
+    const char *variants[4] = { "8 bit -> int", "8 bit -> 16 bit", "16 bit -> 16 bit",
+				"16 bit -> int" };
+    for(int variant = 0; variant < 4; variant++) {
+	int dstShift = shifts[variant == 1 ? 0 : 1];
+	bool toShort = variant == 1 || variant == 2;
+	if(toShort && dstShift < 0) {
+	    continue;
+	}
+	// the reference runs first (scalar, one thread), then conv with every
+	// instruction set and number of threads
+	for(int run = -1; run < 3 * 4; run++) {
+	    bool isReference = run < 0;
+	    int s = isReference ? 0 : run / 4;
+	    int t = isReference ? 0 : run % 4;
+	    Simd::setActive(sets[s]);
+	    if(Simd::active() != sets[s]) {
+		continue;
+	    }
+	    ThreadPool::instance()->setThreadCount(threadCounts[t]);
+	    const Convolution &used = isReference ? reference : conv;
+	    int *intDst = isReference ? &intReference[0] : &intResult[0];
+	    PlaneView<int16_t> shortDst = isReference ? shortReference.view() : shortResult.view();
+	    switch(variant) {
+	    case 0:
+		used.apply(image.constView(), intDst, width, roi);
+		break;
+	    case 1:
+		used.apply(image.constView(), shortDst, dstShift, roi);
+		break;
+	    case 2:
+		used.apply(fixed.constView(), fixedShift, shortDst, dstShift, roi);
+		break;
+	    default:
+		used.apply(fixed.constView(), fixedShift, intDst, width, roi);
+		break;
+	    }
+	    if(isReference) {
+		continue;
+	    }
+
+	    char name[160];
+	    snprintf(name, sizeof(name), "convolution %s, %s, %s, %s, %d threads",
+		     kernelName, variants[variant], roiName, setNames[s], threadCounts[t]);
+	    if(toShort) {
+		compare(name, shortReference.constView(), shortResult.constView(), width,
+			height, roi);
+	    } else {
+		PlaneView<int> expected = { &intReference[0], width, height, width };
+		PlaneView<int> actual = { &intResult[0], width, height, width };
+		compare(name, expected, actual, width, height, roi);
+	    }
+	}
+    }
+}
+
+/**
+  * compare the stencil of a built-in kernel (scalar and vectorized loop,
+  * border) with the generic loops of the same coefficients
+  *
+  * @param kernelName description of the kernel
+  * @param builtin built-in kernel
+  * @param image random 8 bit image
+  * @param fixed random 16 bit fixed point image
+  * @param fixedShift fraction bits of fixed
+  * @param roiName description of the region
+  * @param roi region (prepared for the size of the images, 0 -> whole image)
+  */
+static void testBuiltin(const char *kernelName, Kernels::Builtin builtin,
+			const Plane<uint8_t> &image, const Plane<int16_t> &fixed, int fixedShift,
+			const char *roiName, const Roi *roi) {
+    int size = Kernels::size(builtin);
+    int **values = Kernels::allocate(size);
+    if(values == 0) {
+	printf("FAIL %s: out of memory\n", kernelName);
+	failedCases++;
+	return;
+    }
+    Kernels::fill(values, builtin);
+    Convolution generic(values, size, Kernels::rotating(builtin));
+    Kernels::release(values, size);
+
+    Convolution stencil(builtin);
+    cases++;
+    if(!stencil.hasStencil() || generic.hasStencil()) {
+	printf("FAIL %s: the stencil or the generic loops are not used\n", kernelName);
+	failedCases++;
+	return;
+    }
+    testConvolution(kernelName, stencil, generic, image, fixed, fixedShift, roiName, roi);
+}
+
+/**
+  * test the convolution of 3x3, 5x5 and larger kernels (random, rotating,
+  * separable and built-in) on random images with and without a region
+  */
+static void testConvolutions() {
+    const KernelCase kernels[] = {
+	{ "3x3 random", 3, false, false, Kernels::Sobel },
+	{ "3x3 random rotating", 3, true, false, Kernels::Sobel },
+	{ "3x3 Gauss", 3, false, true, Kernels::Sobel },
+	{ "5x5 random", 5, false, false, Kernels::Sobel },
+	{ "5x5 random rotating", 5, true, false, Kernels::Sobel },
+	{ "5x5 Gauss", 5, false, true, Kernels::Sobel },
+	{ "7x7 random", 7, false, false, Kernels::Sobel },
+	{ "9x9 Gauss", 9, false, true, Kernels::Sobel },
+	{ "11x11 random", 11, false, false, Kernels::Sobel },
+	{ "23x23 Gauss", 23, false, true, Kernels::Sobel },
+	{ "Kirsch", 0, false, false, Kernels::Kirsch },
+	{ "Laplace", 0, false, false, Kernels::Laplace },
+	{ "Prewitt 1", 0, false, false, Kernels::Prewitt1 },
+	{ "Prewitt 2", 0, false, false, Kernels::Prewitt2 },
+	{ "Sobel", 0, false, false, Kernels::Sobel },
+	{ "Sobel vertical", 0, false, false, Kernels::SobelVertical }
+    };
+    const int sizes[2][2] = { { 67, 45 }, { 320, 240 } };
+
+    for(int i = 0; i < 2; i++) {
+	int width = sizes[i][0];
+	int height = sizes[i][1];
+
+	// random 8 bit image and random 16 bit fixed point image (4 fraction bits)
+	const int fixedShift = 4;
+	Plane<uint8_t> image;
+	Plane<int16_t> fixed;
+	if(image.allocate(width, height) != 0 || fixed.allocate(width, height) != 0) {
+	    printf("FAIL convolution: out of memory\n");
+	    failedCases++;
+	    return;
+	}
+	for(int y = 0; y < height; y++) {
+	    for(int x = 0; x < width; x++) {
+		image.row(y)[x] = (uint8_t) randomNumber(256);
+		fixed.row(y)[x] = (int16_t) randomNumber((255 << fixedShift) + 1);
+	    }
+	}
+
+	// whole image, rectangle and polygon
+	Roi rectangle;
+	rectangle.setRectangle(width / 5, height / 4, width - 3, height - height / 3);
+	rectangle.prepare(width, height);
+	Roi polygon;
+	std::vector<RoiPoint> corners;
+	RoiPoint a = { width * 0.5, 1.0 };
+	RoiPoint b = { width - 1.0, height * 0.6 };
+	RoiPoint c = { width * 0.3, height - 1.0 };
+	RoiPoint d = { 0.0, height * 0.4 };
+	corners.push_back(a);
+	corners.push_back(b);
+	corners.push_back(c);
+	corners.push_back(d);
+	polygon.setPolygon(corners);
+	polygon.prepare(width, height);
+	const Roi *rois[3] = { 0, &rectangle, &polygon };
+	const char *roiNames[3] = { "whole image", "rectangle", "polygon" };
+
+	for(size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+	    const KernelCase &kernel = kernels[k];
+	    char kernelName[64];
+	    snprintf(kernelName, sizeof(kernelName), "%s (%dx%d image)", kernel.name, width, height);
+	    for(int r = 0; r < 3; r++) {
+		if(kernel.size == 0) {
+		    testBuiltin(kernelName, kernel.builtin, image, fixed, fixedShift, roiNames[r],
+				rois[r]);
+		    continue;
+		}
+		int **values = Kernels::allocate(kernel.size);
+		if(values == 0) {
+		    printf("FAIL %s: out of memory\n", kernelName);
+		    failedCases++;
+		    return;
+		}
+		if(kernel.gauss) {
+		    Kernels::gauss(values, kernel.size);
+		} else {
+		    // some zeros, so taps are dropped
+		    for(int y = 0; y < kernel.size; y++) {
+			for(int x = 0; x < kernel.size; x++) {
+			    values[y][x] = randomNumber(4) == 0 ? 0 : randomNumber(41) - 20;
+			}
+		    }
+		}
+		Convolution conv(values, kernel.size, kernel.rotate);
+		testConvolution(kernelName, conv, conv, image, fixed, fixedShift, roiNames[r],
+				rois[r]);
+		Kernels::release(values, kernel.size);
+	    }
+	}
+    }
+}
+
+int main() {
+    Simd::InstructionSet supported = Simd::supported();
+    printf("tested instruction sets:");
+    for(int s = 0; s <= supported; s++) {
+	printf(" %s", setNames[s]);
+    }
+    if(supported != Simd::AVX2) {
+	printf(" (instruction sets above %s are not supported and skipped)", setNames[supported]);
+    }
+    printf("\n");
+
+    testMultiplyAdd<uint8_t>("8 bit", 0, 255);
+    testMultiplyAdd<int16_t>("16 bit", -32768, 32767);
+    testConvolutions();
+
+    Simd::setActive(supported);
+    printf("%d results compared, %d differ\n", cases, failedCases);
+    return failedCases == 0 ? 0 : 1;
+}
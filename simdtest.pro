@@ -0,0 +1,37 @@
+#-------------------------------------------------
+#
+# Test of the vectorized code: every instruction set
+# and number of threads gives the scalar results, the
+# stencils of the built-in kernels the generic results
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = simdtest
+TEMPLATE = app
+CONFIG   += console
+CONFIG   -= app_bundle
+
+# own objects and Makefile (cv and cvbatch are built in the same directory)
+OBJECTS_DIR = simdtest-obj
+MAKEFILE = Makefile.simdtest
+
+SOURCES += simdtest.cpp \
+    simd.cpp \
+    convolution.cpp \
+    threadpool.cpp \
+    kernels.cpp \
+    roi.cpp
+
+HEADERS += simd.h \
+    convolution.h \
+    threadpool.h \
+    kernels.h \
+    stencil.h \
+    roi.h \
+    imageplane.h \
+    alignedblock.h
+
+QMAKE_CXXFLAGS += -std=c++11
+unix:LIBS += -pthread
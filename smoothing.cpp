@@ -0,0 +1,379 @@
+#include "smoothing.h"
+#include "threadpool.h"
+#include <math.h>
+#include <string.h>
+
+/**
+  * histograms of the window of a median or bilateral filter, moved pixel by
+  * pixel along a row (Perreault)
+  * the histograms have 16 coarse bins (gray value / 16) and 256 fine bins,
+  * four 16 bit bins are packed into one 64 bit word, so four bins are added
+  * with one addition (a bin never overflows or gets negative, so there is
+  * no carry into the next bin)
+  */
+struct WindowHistogram {
+    const ImageView *src; ///< filtered image
+    int radius; ///< pixels left (and right, above and below) of the center
+    int width; ///< width of the image
+    std::vector<uint64_t> columnCoarse; ///< coarse histogram of every column (size: width x 4 words)
+    std::vector<uint64_t> columnFine; ///< fine histogram of every column (size: 16 coarse bins x width x 4 words, the columns of a coarse bin are neighbours)
+    uint64_t coarse[4]; ///< coarse histogram of the window
+    uint64_t fine[64]; ///< fine histogram of the window (only valid at fineColumn)
+    int fineColumn[16]; ///< column of the window for which the fine bins of a coarse bin are valid (-1 -> none)
+    int column; ///< center column of the window
+    int rows; ///< rows in the window (cut at the border)
+
+    WindowHistogram(const ImageView *image, int r) : columnCoarse(image->width * 4, 0),
+	columnFine(image->width * 64, 0) {
+	src = image;
+	radius = r;
+	width = image->width;
+	column = 0;
+	rows = 0;
+    }
+
+    /**
+      * get a bin of packed bins
+      */
+    static int bin(const uint64_t *bins, int i) {
+	return (int) (bins[i >> 2] >> ((i & 3) * 16)) & 0xffff;
+    }
+
+    /**
+      * search the bin of a rank in 16 packed bins
+      *
+      * @param bins 16 packed bins
+      * @param rank rank (0 -> smallest), the pixels of the bins before the
+      *             found bin are subtracted
+      * @return  bin with the pixel of the rank
+      */
+    static int search(const uint64_t *bins, int *rank) {
+	int i = 0;
+	while(*rank >= bin(bins, i)) {
+	    *rank -= bin(bins, i);
+	    i++;
+	}
+	return i;
+    }
+
+    /**
+      * add a row of the image to the column histograms or remove it
+      */
+    void changeRow(int y, bool add) {
+	const uint8_t *row = src->row(y);
+	for(int x = 0; x < width; x++) {
+	    int value = row[x];
+	    uint64_t coarseOne = (uint64_t) 1 << ((value >> 4 & 3) * 16);
+	    uint64_t fineOne = (uint64_t) 1 << ((value & 3) * 16);
+	    if(add) {
+		columnCoarse[x * 4 + (value >> 6)] += coarseOne;
+		columnFine[((value >> 4) * width + x) * 4 + (value >> 2 & 3)] += fineOne;
+	    } else {
+		columnCoarse[x * 4 + (value >> 6)] -= coarseOne;
+		columnFine[((value >> 4) * width + x) * 4 + (value >> 2 & 3)] -= fineOne;
+	    }
+	}
+    }
+
+    /**
+      * set the column histograms to the window of a row
+      */
+    void startRow(int y) {
+	memset(&columnCoarse[0], 0, columnCoarse.size() * sizeof(uint64_t));
+	memset(&columnFine[0], 0, columnFine.size() * sizeof(uint64_t));
+	int first = y - radius > 0 ? y - radius : 0;
+	int last = y + radius < src->height ? y + radius + 1 : src->height;
+	for(int i = first; i < last; i++) {
+	    changeRow(i, true);
+	}
+	rows = last - first;
+    }
+
+    /**
+      * move the column histograms from the window of row y-1 to row y
+      */
+    void nextRow(int y) {
+	if(y - radius - 1 >= 0) {
+	    changeRow(y - radius - 1, false);
+	    rows--;
+	}
+	if(y + radius < src->height) {
+	    changeRow(y + radius, true);
+	    rows++;
+	}
+    }
+
+    /**
+      * set the window to a column (the fine bins are updated on demand)
+      */
+    void startColumn(int x) {
+	memset(coarse, 0, sizeof(coarse));
+	int first = x - radius > 0 ? x - radius : 0;
+	int last = x + radius < width ? x + radius + 1 : width;
+	for(int i = first; i < last; i++) {
+	    const uint64_t *add = &columnCoarse[i * 4];
+	    for(int k = 0; k < 4; k++) {
+		coarse[k] += add[k];
+	    }
+	}
+	for(int k = 0; k < 16; k++) {
+	    fineColumn[k] = -1;
+	}
+	column = x;
+    }
+
+    /**
+      * move the window one column to the right
+      */
+    void nextColumn() {
+	column++;
+	if(column - radius - 1 >= 0) {
+	    const uint64_t *sub = &columnCoarse[(column - radius - 1) * 4];
+	    for(int k = 0; k < 4; k++) {
+		coarse[k] -= sub[k];
+	    }
+	}
+	if(column + radius < width) {
+	    const uint64_t *add = &columnCoarse[(column + radius) * 4];
+	    for(int k = 0; k < 4; k++) {
+		coarse[k] += add[k];
+	    }
+	}
+    }
+
+    /**
+      * get the fine bins of a coarse bin for the current column, they are
+      * moved from the column of the last use or added again if this is
+      * cheaper
+      *
+      * @param k coarse bin
+      * @return  16 packed fine bins (gray values k*16 .. k*16+15)
+      */
+    const uint64_t *fineBins(int k) {
+	uint64_t *bins = &fine[k * 4];
+	int from = fineColumn[k];
+	if(from < 0 || column - from > radius) {
+	    memset(bins, 0, 4 * sizeof(uint64_t));
+	    int first = column - radius > 0 ? column - radius : 0;
+	    int last = column + radius < width ? column + radius + 1 : width;
+	    for(int i = first; i < last; i++) {
+		const uint64_t *add = &columnFine[(k * width + i) * 4];
+		for(int v = 0; v < 4; v++) {
+		    bins[v] += add[v];
+		}
+	    }
+	} else {
+	    for(int x = from + 1; x <= column; x++) {
+		if(x - radius - 1 >= 0) {
+		    const uint64_t *sub = &columnFine[(k * width + x - radius - 1) * 4];
+		    for(int v = 0; v < 4; v++) {
+			bins[v] -= sub[v];
+		    }
+		}
+		if(x + radius < width) {
+		    const uint64_t *add = &columnFine[(k * width + x + radius) * 4];
+		    for(int v = 0; v < 4; v++) {
+			bins[v] += add[v];
+		    }
+		}
+	    }
+	}
+	fineColumn[k] = column;
+	return bins;
+    }
+
+    /**
+      * get the number of pixels in the window (cut at the border)
+      */
+    int count() const {
+	int first = column - radius > 0 ? column - radius : 0;
+	int last = column + radius < width ? column + radius + 1 : width;
+	return rows * (last - first);
+    }
+};
+
+Smoothing::Smoothing() {
+    rangeSigma = 0;
+}
+
+int Smoothing::box(const ImageView &src, const ImageView &dst, int radius, const Roi *roi) {
+    if(radius < 1 || radius > maxRadius) {
+	return -1;
+    }
+    Roi whole;
+    if(roi == 0) {
+	whole.prepare(src.width, src.height);
+	roi = &whole;
+    }
+
+    // integral image, the sums may overflow: the difference of four sums
+    // is right modulo 2^32 and a window has less than 2^32 / 255 pixels
+    int stride = src.width + 1;
+    integral.resize((size_t) stride * (src.height + 1));
+    memset(&integral[0], 0, stride * sizeof(uint32_t));
+    for(int y = 0; y < src.height; y++) {
+	const uint8_t *row = src.row(y);
+	const uint32_t *above = &integral[(size_t) y * stride];
+	uint32_t *sums = &integral[(size_t) (y+1) * stride];
+	uint32_t rowSum = 0;
+	sums[0] = 0;
+	for(int x = 0; x < src.width; x++) {
+	    rowSum += row[x];
+	    sums[x+1] = above[x+1] + rowSum;
+	}
+    }
+
+    int top = roi->top();
+    ThreadPool::instance()->parallelBands(roi->bottom() - top, [&](int begin, int end, int) {
+	for(int y = begin+top; y < end+top; y++) {
+	    // rows of the window (cut at the border)
+	    int first = y - radius > 0 ? y - radius : 0;
+	    int last = y + radius < src.height ? y + radius + 1 : src.height;
+	    const uint32_t *upper = &integral[(size_t) first * stride];
+	    const uint32_t *lower = &integral[(size_t) last * stride];
+	    int rows = last - first;
+
+	    // columns with a whole window have the same number of pixels, the
+	    // division is a multiplication with ceil(2^32 / pixels), which is
+	    // exact while 256 * pixels^2 < 2^32 (a window has up to 51 x 51
+	    // pixels), so it rounds like the division at the border
+	    int innerLeft = radius;
+	    int innerRight = src.width - radius;
+	    uint32_t innerPixels = rows * (2 * radius + 1);
+	    uint64_t reciprocal = ((1ULL << 32) + innerPixels - 1) / innerPixels;
+
+	    uint8_t *row = dst.row(y);
+	    int count;
+	    const RoiSpan *span = roi->row(y, &count);
+	    for(int s = 0; s < count; s++) {
+		int left = span[s].left;
+		int right = span[s].right;
+		int from = left > innerLeft ? left : innerLeft;
+		int to = right < innerRight ? right : innerRight;
+		if(from > to) {
+		    from = right;
+		    to = right;
+		}
+		for(int x = left; x < from; x++) {
+		    int x0 = x - radius > 0 ? x - radius : 0;
+		    int x1 = x + radius < src.width ? x + radius + 1 : src.width;
+		    uint32_t sum = lower[x1] - lower[x0] - upper[x1] + upper[x0];
+		    int pixels = rows * (x1 - x0);
+		    row[x] = (uint8_t) ((sum + pixels / 2) / pixels);
+		}
+		for(int x = from; x < to; x++) {
+		    uint32_t sum = lower[x+radius+1] - lower[x-radius] - upper[x+radius+1] + upper[x-radius];
+		    row[x] = (uint8_t) (((sum + innerPixels / 2) * reciprocal) >> 32);
+		}
+		for(int x = to; x < right; x++) {
+		    int x0 = x - radius > 0 ? x - radius : 0;
+		    int x1 = x + radius < src.width ? x + radius + 1 : src.width;
+		    uint32_t sum = lower[x1] - lower[x0] - upper[x1] + upper[x0];
+		    int pixels = rows * (x1 - x0);
+		    row[x] = (uint8_t) ((sum + pixels / 2) / pixels);
+		}
+	    }
+	}
+    });
+    return 0;
+}
+
+int Smoothing::median(const ImageView &src, const ImageView &dst, int radius, const Roi *roi) {
+    if(radius < 1 || radius > maxRadius) {
+	return -1;
+    }
+    Roi whole;
+    if(roi == 0) {
+	whole.prepare(src.width, src.height);
+	roi = &whole;
+    }
+
+    int top = roi->top();
+    ThreadPool::instance()->parallelBands(roi->bottom() - top, [&](int begin, int end, int) {
+	histogramBand(src, dst, radius, 0, roi, begin+top, end+top);
+    }, 2 * radius + 1);
+    return 0;
+}
+
+int Smoothing::bilateral(const ImageView &src, const ImageView &dst, int radius, int sigma,
+			 const Roi *roi) {
+    if(radius < 1 || radius > maxRadius || sigma <= 0) {
+	return -1;
+    }
+    Roi whole;
+    if(roi == 0) {
+	whole.prepare(src.width, src.height);
+	roi = &whole;
+    }
+
+    // weights of the gray value differences (only if sigma changes)
+    if(rangeSigma != sigma) {
+	rangeWeights.resize(256);
+	for(int d = 0; d < 256; d++) {
+	    rangeWeights[d] = d > 3 * sigma ? 0 : (int) (1024 * exp(-0.5 * d * d / ((double) sigma * sigma)) + 0.5);
+	}
+	rangeSigma = sigma;
+    }
+
+    int top = roi->top();
+    ThreadPool::instance()->parallelBands(roi->bottom() - top, [&](int begin, int end, int) {
+	histogramBand(src, dst, radius, sigma, roi, begin+top, end+top);
+    }, 2 * radius + 1);
+    return 0;
+}
+
+void Smoothing::histogramBand(const ImageView &src, const ImageView &dst, int radius, int sigma,
+			      const Roi *roi, int begin, int end) const {
+    WindowHistogram window(&src, radius);
+    const int *weights = sigma > 0 ? &rangeWeights[0] : 0;
+    for(int y = begin; y < end; y++) {
+	if(y == begin) {
+	    window.startRow(y);
+	} else {
+	    window.nextRow(y);
+	}
+
+	const uint8_t *center = src.row(y);
+	uint8_t *row = dst.row(y);
+	int count;
+	const RoiSpan *span = roi->row(y, &count);
+	for(int s = 0; s < count; s++) {
+	    for(int x = span[s].left; x < span[s].right; x++) {
+		if(x == span[s].left) {
+		    window.startColumn(x);
+		} else {
+		    window.nextColumn();
+		}
+
+		if(weights == 0) {
+		    // coarse bin of the median, then the fine bin
+		    int rank = (window.count() - 1) / 2;
+		    int k = WindowHistogram::search(window.coarse, &rank);
+		    int v = WindowHistogram::search(window.fineBins(k), &rank);
+		    row[x] = (uint8_t) (k * 16 + v);
+		    continue;
+		}
+
+		// gray values within 3 sigma of the center pixel
+		int value = center[x];
+		int low = value - 3 * sigma > 0 ? value - 3 * sigma : 0;
+		int high = value + 3 * sigma < 255 ? value + 3 * sigma : 255;
+		int weightSum = 0;
+		int valueSum = 0;
+		for(int k = low >> 4; k <= high >> 4; k++) {
+		    if(WindowHistogram::bin(window.coarse, k) == 0) {
+			continue;
+		    }
+		    const uint64_t *bins = window.fineBins(k);
+		    for(int v = 0; v < 16; v++) {
+			int gray = k * 16 + v;
+			int weight = WindowHistogram::bin(bins, v) * weights[gray > value ? gray - value : value - gray];
+			weightSum += weight;
+			valueSum += weight * gray;
+		    }
+		}
+		row[x] = (uint8_t) ((valueSum + weightSum / 2) / weightSum);
+	    }
+	}
+    }
+}
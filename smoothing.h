@@ -0,0 +1,99 @@
+#ifndef SMOOTHING_H
+#define SMOOTHING_H
+
+#include <vector>
+#include "imageplane.h"
+#include "roi.h"
+
+/**
+  * smoothing filters of an 8 bit image whose cost per pixel does not
+  * depend on the radius of the window (3x3 up to 51x51)
+  *
+  * box: mean of the window, four lookups in an integral image (summed area
+  * table)
+  * median: median of the window with running histograms (Perreault): every
+  * column keeps the histogram of its pixels in the window, it is moved down
+  * by one pixel per row, the histogram of the window is moved right by
+  * adding and removing whole column histograms, the histograms have a
+  * coarse (16 bins) and a fine (256 bins) level and the fine level of the
+  * window is only updated for the coarse bins which are really searched
+  * bilateral: mean of the window with the running histograms of the median,
+  * every gray value is weighted with its difference to the center pixel
+  * (Gauss), the window itself is not weighted (box instead of Gauss)
+  *
+  * the window is cut at the border of the image (pixels outside of the image
+  * are left out), the rows are calculated in parallel bands
+  * with a region of interest only the pixels of the region are calculated,
+  * but all pixels of the image are read
+  */
+class Smoothing
+{
+private:
+    std::vector<uint32_t> integral; ///< integral image (size: (width+1) x (height+1), modulo 2^32)
+    std::vector<int> rangeWeights; ///< weight of a gray value difference (0 .. 255) in 1/1024
+    int rangeSigma; ///< sigma of rangeWeights (0 -> not calculated)
+
+public:
+    Smoothing();
+
+    static const int maxRadius = 25; ///< maximal radius of the window (51x51)
+
+    /**
+      * replace every pixel by the mean of its window
+      *
+      * @param src image
+      * @param dst result (size of src, another image than src), pixels
+      *            outside of the region are not changed
+      * @param radius pixels left (and right, above and below) of the center
+      * @param roi only the pixels of this region (prepared for the size of
+      *            src, 0 -> whole image)
+      * @return  0 -> filtered
+      *         -1 -> wrong radius (1 .. maxRadius)
+      */
+    int box(const ImageView &src, const ImageView &dst, int radius, const Roi *roi = 0);
+
+    /**
+      * replace every pixel by the median of its window (the lower one if
+      * the window has an even number of pixels)
+      *
+      * @param src image
+      * @param dst result (size of src, another image than src), pixels
+      *            outside of the region are not changed
+      * @param radius pixels left (and right, above and below) of the center
+      * @param roi only the pixels of this region (prepared for the size of
+      *            src, 0 -> whole image)
+      * @return  0 -> filtered
+      *         -1 -> wrong radius (1 .. maxRadius)
+      */
+    int median(const ImageView &src, const ImageView &dst, int radius, const Roi *roi = 0);
+
+    /**
+      * replace every pixel by the mean of its window, weighted by the
+      * difference of the gray values (edges are kept), gray values which
+      * differ more than 3 sigma from the center are left out
+      *
+      * @param src image
+      * @param dst result (size of src, another image than src), pixels
+      *            outside of the region are not changed
+      * @param radius pixels left (and right, above and below) of the center
+      * @param sigma sigma of the weights of the gray value difference (> 0)
+      * @param roi only the pixels of this region (prepared for the size of
+      *            src, 0 -> whole image)
+      * @return  0 -> filtered
+      *         -1 -> wrong radius (1 .. maxRadius) or sigma
+      */
+    int bilateral(const ImageView &src, const ImageView &dst, int radius, int sigma,
+                  const Roi *roi = 0);
+
+private:
+    /**
+      * run the median (sigma 0) or the bilateral filter on a band of rows
+      *
+      * @param begin first row of the band
+      * @param end row after the band
+      */
+    void histogramBand(const ImageView &src, const ImageView &dst, int radius, int sigma,
+                       const Roi *roi, int begin, int end) const;
+};
+
+#endif // SMOOTHING_H
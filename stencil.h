@@ -0,0 +1,356 @@
+#ifndef STENCIL_H
+#define STENCIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(__SSE2__)
+#define CV_STENCIL_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+  * kernel whose coefficients are known at compile time, e.g. Sobel:
+  * Stencil<3, 3,  1, 2, 1,  0, 0, 0,  -1, -2, -1>
+  *
+  * StencilRows calculates a row of results with every tap unrolled: zero
+  * coefficients are left out, +-1 and +-2^n are added with shifts instead
+  * of multiplications, the pixels are processed 8 at a time in 16 bit
+  * (SSE2, only if the caller allows vectors, see Simd::active) if the sums
+  * fit
+  */
+template<int W, int H, int... Coefficients>
+struct Stencil;
+
+/**
+  * get a coefficient of a parameter pack
+  *
+  * @param index index in the pack
+  * @return  coefficient (0 if index is outside)
+  */
+constexpr int stencilCoefficient(int) {
+    return 0;
+}
+
+template<typename... Rest>
+constexpr int stencilCoefficient(int index, int first, Rest... rest) {
+    return index == 0 ? first : stencilCoefficient(index - 1, rest...);
+}
+
+template<int W, int H, int... Coefficients>
+struct Stencil {
+    static_assert(sizeof...(Coefficients) == W * H, "a stencil needs W x H coefficients");
+    static_assert(W % 2 == 1 && H % 2 == 1, "a stencil has an odd size");
+
+    static const int width = W; ///< x size
+    static const int height = H; ///< y size
+
+    /**
+      * @return  coefficient of a tap
+      */
+    static constexpr int at(int row, int col) {
+        return stencilCoefficient(row * W + col, Coefficients...);
+    }
+};
+
+/**
+  * stencil plus the stencil rotated by 90 degree (rotating kernels of the
+  * convolution), the divisor is the sum of the stencil (twice for rotating
+  * ones, 0 -> no division)
+  */
+template<typename S, bool Rotate>
+struct StencilKernel {
+    static_assert(!Rotate || S::width == S::height, "only a square stencil rotates");
+
+    static const int width = S::width; ///< x size
+    static const int height = S::height; ///< y size
+
+    /**
+      * @return  coefficient of a tap
+      */
+    static constexpr int at(int row, int col) {
+        return S::at(row, col) + (Rotate ? S::at(col, S::width - 1 - row) : 0);
+    }
+
+    /**
+      * @return  coefficient of a tap outside of the image (the kernel
+      *          without rotation times white)
+      */
+    static constexpr int outside(int row, int col) {
+        return S::at(row, col);
+    }
+
+    /**
+      * @return  sum of the coefficients of the stencil from tap index on
+      */
+    static constexpr int sumFrom(int index) {
+        return index == width * height ? 0 : S::at(index / width, index % width) + sumFrom(index + 1);
+    }
+
+    /**
+      * @return  sum of the absolute coefficients from tap index on
+      */
+    static constexpr int absSumFrom(int index) {
+        return index == width * height ? 0
+               : (at(index / width, index % width) < 0 ? -at(index / width, index % width)
+                                                       : at(index / width, index % width))
+                 + absSumFrom(index + 1);
+    }
+
+    static constexpr int divisor() { return sumFrom(0) * (Rotate ? 2 : 1); } ///< divisor of the sums
+    static constexpr int absSum() { return absSumFrom(0); } ///< bound of a sum with pixel 1
+};
+
+/**
+  * compile-time list of tap indices (C++11 has no std::index_sequence)
+  */
+template<int... I>
+struct StencilIndices {};
+
+template<int N, int... I>
+struct MakeStencilIndices : MakeStencilIndices<N - 1, N - 1, I...> {};
+
+template<int... I>
+struct MakeStencilIndices<0, I...> {
+    typedef StencilIndices<I...> type;
+};
+
+/**
+  * kind of a coefficient: 0 -> left out, 1 -> add, 2 -> subtract,
+  * 3 -> add shifted, 4 -> subtract shifted, 5 -> multiply
+  */
+constexpr int stencilWeightKind(int c) {
+    return c == 0 ? 0 : c == 1 ? 1 : c == -1 ? 2
+           : (c > 0 && (c & (c - 1)) == 0) ? 3 : (c < 0 && (-c & (-c - 1)) == 0) ? 4 : 5;
+}
+
+/**
+  * @return  n of 2^n
+  */
+constexpr int stencilLog2(int c) {
+    return c <= 1 ? 0 : 1 + stencilLog2(c / 2);
+}
+
+/**
+  * one tap with the coefficient C: add C * pixel to a sum
+  */
+template<int C, int Kind = stencilWeightKind(C)>
+struct StencilWeight {
+    static int apply(int acc, const uint8_t *pixel) { return acc + C * *pixel; }
+#ifdef CV_STENCIL_SSE2
+    static __m128i apply(__m128i acc, const uint8_t *pixels) {
+        return _mm_add_epi16(acc, _mm_mullo_epi16(load(pixels), _mm_set1_epi16((short) C)));
+    }
+    static __m128i load(const uint8_t *pixels) {
+        return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) pixels), _mm_setzero_si128());
+    }
+#endif
+};
+
+template<int C>
+struct StencilWeight<C, 0> {
+    static int apply(int acc, const uint8_t *) { return acc; }
+#ifdef CV_STENCIL_SSE2
+    static __m128i apply(__m128i acc, const uint8_t *) { return acc; }
+#endif
+};
+
+template<int C>
+struct StencilWeight<C, 1> : StencilWeight<C, 5> {
+    static int apply(int acc, const uint8_t *pixel) { return acc + *pixel; }
+#ifdef CV_STENCIL_SSE2
+    static __m128i apply(__m128i acc, const uint8_t *pixels) {
+        return _mm_add_epi16(acc, StencilWeight<C, 5>::load(pixels));
+    }
+#endif
+};
+
+template<int C>
+struct StencilWeight<C, 2> : StencilWeight<C, 5> {
+    static int apply(int acc, const uint8_t *pixel) { return acc - *pixel; }
+#ifdef CV_STENCIL_SSE2
+    static __m128i apply(__m128i acc, const uint8_t *pixels) {
+        return _mm_sub_epi16(acc, StencilWeight<C, 5>::load(pixels));
+    }
+#endif
+};
+
+template<int C>
+struct StencilWeight<C, 3> : StencilWeight<C, 5> {
+    static int apply(int acc, const uint8_t *pixel) { return acc + (*pixel << stencilLog2(C)); }
+#ifdef CV_STENCIL_SSE2
+    static __m128i apply(__m128i acc, const uint8_t *pixels) {
+        return _mm_add_epi16(acc, _mm_slli_epi16(StencilWeight<C, 5>::load(pixels), stencilLog2(C)));
+    }
+#endif
+};
+
+template<int C>
+struct StencilWeight<C, 4> : StencilWeight<C, 5> {
+    static int apply(int acc, const uint8_t *pixel) { return acc - (*pixel << stencilLog2(-C)); }
+#ifdef CV_STENCIL_SSE2
+    static __m128i apply(__m128i acc, const uint8_t *pixels) {
+        return _mm_sub_epi16(acc, _mm_slli_epi16(StencilWeight<C, 5>::load(pixels), stencilLog2(-C)));
+    }
+#endif
+};
+
+/**
+  * all taps of a kernel, unrolled by the list of tap indices
+  */
+template<typename K, typename Indices>
+struct StencilTaps;
+
+template<typename K, int... I>
+struct StencilTaps<K, StencilIndices<I...> > {
+    /**
+      * sum of one result
+      *
+      * @param rows one pointer per row of the kernel (first pixel under
+      *             the kernel of the first result)
+      * @param x result in the row
+      */
+    static int sum(const uint8_t *const *rows, int x) {
+        int acc = 0;
+        int unused[] = { 0, (acc = StencilWeight<K::at(I / K::width, I % K::width)>::apply(
+                                  acc, rows[I / K::width] + x + I % K::width), 0)... };
+        (void) unused;
+        return acc;
+    }
+
+    /**
+      * sum of one result near the border of the image (pixels outside, the
+      * first row and the first column have the value white)
+      *
+      * @param data first pixel of the image
+      * @param stride distance between two rows in pixels
+      * @param width x size of the image
+      * @param height y size of the image
+      * @param y y position of the result
+      * @param x x position of the result
+      * @param white value of a pixel outside
+      */
+    static int border(const uint8_t *data, int stride, int width, int height, int y, int x,
+                      int white) {
+        int acc = 0;
+        int unused[] = { 0, (acc += borderTap<I>(data, stride, width, height, y, x, white), 0)... };
+        (void) unused;
+        return acc;
+    }
+
+    template<int Index>
+    static int borderTap(const uint8_t *data, int stride, int width, int height, int y, int x,
+                         int white) {
+        const int row = Index / K::width;
+        const int col = Index % K::width;
+        int srcY = y - K::height / 2 + row;
+        int srcX = x - K::width / 2 + col;
+        bool inside = srcY > 0 && srcY < height && srcX > 0 && srcX < width;
+        // read a pixel inside in any case, then select without a branch
+        int pixel = data[(size_t) (inside ? srcY : 0) * stride + (inside ? srcX : 0)];
+        return inside ? K::at(row, col) * pixel : K::outside(row, col) * white;
+    }
+
+#ifdef CV_STENCIL_SSE2
+    /**
+      * sums of 8 results in 16 bit (the sums must fit)
+      */
+    static __m128i sum8(const uint8_t *const *rows, int x) {
+        __m128i acc = _mm_setzero_si128();
+        int unused[] = { 0, (acc = StencilWeight<K::at(I / K::width, I % K::width)>::apply(
+                                  acc, rows[I / K::width] + x + I % K::width), 0)... };
+        (void) unused;
+        return acc;
+    }
+#endif
+};
+
+/**
+  * loop over 8 results at a time, selected at compile time (only if the
+  * sums of 8 bit pixels fit in 16 bit and there is no division)
+  */
+template<typename Taps, bool vectorized>
+struct StencilLoop {
+    static int run(const uint8_t *const *, int16_t *, int, int) { return 0; }
+    static int run(const uint8_t *const *, int *, int) { return 0; }
+};
+
+#ifdef CV_STENCIL_SSE2
+template<typename Taps>
+struct StencilLoop<Taps, true> {
+    static int run(const uint8_t *const *rows, int16_t *dst, int n, int up) {
+        __m128i shift = _mm_cvtsi32_si128(up);
+        int x = 0;
+        for(; x + 8 <= n; x += 8) {
+            _mm_storeu_si128((__m128i*) (dst + x), _mm_sll_epi16(Taps::sum8(rows, x), shift));
+        }
+        return x;
+    }
+
+    static int run(const uint8_t *const *rows, int *dst, int n) {
+        int x = 0;
+        for(; x + 8 <= n; x += 8) {
+            __m128i sums = Taps::sum8(rows, x);
+            // sign extension: the 16 bit sum into the upper half, then shift it down
+            _mm_storeu_si128((__m128i*) (dst + x), _mm_srai_epi32(_mm_unpacklo_epi16(sums, sums), 16));
+            _mm_storeu_si128((__m128i*) (dst + x + 4), _mm_srai_epi32(_mm_unpackhi_epi16(sums, sums), 16));
+        }
+        return x;
+    }
+};
+#endif
+
+/**
+  * results of a part of a row with a kernel known at compile time (the
+  * same results as the generic loops of Convolution)
+  */
+template<typename K>
+struct StencilRows {
+    typedef StencilTaps<K, typename MakeStencilIndices<K::width * K::height>::type> Taps;
+    static const bool vectorized = K::divisor() == 0 && K::absSum() * 255 <= 32767;
+
+    /**
+      * calculate n results in 16 bit fixed point
+      *
+      * @param rows one pointer per row of the kernel (first pixel under
+      *             the kernel of the first result)
+      * @param dst first result
+      * @param n number of results
+      * @param up fraction bits of the results
+      * @param vectors false -> scalar loop only (e.g. Simd::Scalar is active)
+      */
+    static void run(const uint8_t *const *rows, int16_t *dst, int n, int up, bool vectors) {
+        int x = vectors ? StencilLoop<Taps, vectorized>::run(rows, dst, n, up) : 0;
+        for(; x < n; x++) {
+            int shifted = Taps::sum(rows, x) * (1 << up);
+            dst[x] = (int16_t) (K::divisor() == 0 ? shifted : shifted / K::divisor());
+        }
+    }
+
+    /**
+      * calculate n results as int
+      *
+      * @param rows one pointer per row of the kernel (first pixel under
+      *             the kernel of the first result)
+      * @param dst first result
+      * @param n number of results
+      * @param vectors false -> scalar loop only (e.g. Simd::Scalar is active)
+      */
+    static void run(const uint8_t *const *rows, int *dst, int n, bool vectors) {
+        int x = vectors ? StencilLoop<Taps, vectorized>::run(rows, dst, n) : 0;
+        for(; x < n; x++) {
+            int sum = Taps::sum(rows, x);
+            dst[x] = K::divisor() == 0 ? sum : sum / K::divisor();
+        }
+    }
+
+    /**
+      * calculate the sum of one result near the border (not divided, see
+      * StencilTaps::border)
+      */
+    static int border(const uint8_t *data, int stride, int width, int height, int y, int x,
+                      int white) {
+        return Taps::border(data, stride, width, height, y, x, white);
+    }
+};
+
+#endif // STENCIL_H
@@ -0,0 +1,145 @@
+#include "threadpool.h"
+#include <stdlib.h>
+
+static thread_local bool insideBand = false; ///< true -> thread runs a band
+
+ThreadPool::ThreadPool() {
+    jobFunction = 0;
+    jobRows = 0;
+    jobBands = 0;
+    nextBand = 0;
+    pendingBands = 0;
+    jobNumber = 0;
+    stopping = false;
+    threads = 1;
+
+    // number of threads from the environment or the number of cores
+    const char *env = getenv("CV_THREADS");
+    setThreadCount(env != 0 ? atoi(env) : 0);
+}
+
+ThreadPool::~ThreadPool() {
+    stopWorkers();
+}
+
+ThreadPool *ThreadPool::instance() {
+    static ThreadPool pool;
+    return &pool;
+}
+
+void ThreadPool::setThreadCount(int count) {
+    if(count <= 0) {
+	count = (int) std::thread::hardware_concurrency();
+    }
+    if(count <= 0) {
+	count = 1;
+    }
+
+    std::lock_guard<std::mutex> lock(jobMutex);
+    stopWorkers();
+    threads = count;
+    startWorkers();
+}
+
+void ThreadPool::startWorkers() {
+    stopping = false;
+    for(int i = 1; i < threads; i++) {
+	workers.push_back(std::thread(&ThreadPool::work, this));
+    }
+}
+
+void ThreadPool::stopWorkers() {
+    {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	stopping = true;
+    }
+    wakeUp.notify_all();
+    for(size_t i = 0; i < workers.size(); i++) {
+	workers[i].join();
+    }
+    workers.clear();
+}
+
+int ThreadPool::bandCount(int height, int minRows) const {
+    if(minRows < 1) {
+	minRows = 1;
+    }
+    int bands = height / minRows;
+    if(bands > threads) {
+	bands = threads;
+    }
+    return bands < 1 ? 1 : bands;
+}
+
+void ThreadPool::parallelBands(int height, const BandFunction &function, int minRows) {
+    int bands = bandCount(height, minRows);
+
+    // one band, nested call or pool busy: run the bands in this thread
+    std::unique_lock<std::mutex> jobLock(jobMutex, std::defer_lock);
+    if(bands == 1 || insideBand || !jobLock.try_lock()) {
+	bool wasInside = insideBand;
+	insideBand = true;
+	for(int band = 0; band < bands; band++) {
+	    function((long) height * band / bands, (long) height * (band+1) / bands, band);
+	}
+	insideBand = wasInside;
+	return;
+    }
+
+    // publish the job and help the workers
+    {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	jobFunction = &function;
+	jobRows = height;
+	jobBands = bands;
+	nextBand = 0;
+	pendingBands = bands;
+	jobNumber++;
+    }
+    wakeUp.notify_all();
+    runBands();
+
+    // wait for the bands of the workers
+    std::unique_lock<std::mutex> lock(stateMutex);
+    while(pendingBands > 0) {
+	jobDone.wait(lock);
+    }
+    jobFunction = 0;
+}
+
+void ThreadPool::runBands() {
+    insideBand = true;
+    std::unique_lock<std::mutex> lock(stateMutex);
+    while(jobFunction != 0 && nextBand < jobBands) {
+	int band = nextBand++;
+	const BandFunction *function = jobFunction;
+	int begin = (long) jobRows * band / jobBands;
+	int end = (long) jobRows * (band+1) / jobBands;
+	lock.unlock();
+
+	(*function)(begin, end, band);
+
+	lock.lock();
+	if(--pendingBands == 0) {
+	    jobDone.notify_all();
+	}
+    }
+    insideBand = false;
+}
+
+void ThreadPool::work() {
+    long lastJob = 0;
+    while(true) {
+	{
+	    std::unique_lock<std::mutex> lock(stateMutex);
+	    while(!stopping && jobNumber == lastJob) {
+		wakeUp.wait(lock);
+	    }
+	    if(stopping) {
+		return;
+	    }
+	    lastJob = jobNumber;
+	}
+	runBands();
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+  * small pool of worker threads which runs row bands of an image in
+  * parallel
+  *
+  * the rows are split into bands by the height and the number of threads
+  * only, so every band always gets the same rows and results which are
+  * reduced band by band are deterministic
+  */
+class ThreadPool
+{
+public:
+    /**
+      * function for one band: rows [begin, end) of band number band
+      */
+    typedef std::function<void(int begin, int end, int band)> BandFunction;
+
+private:
+    std::vector<std::thread> workers; ///< worker threads (threadCount - 1)
+    int threads; ///< number of threads including the calling thread
+    std::mutex jobMutex; ///< only one job at a time
+    std::mutex stateMutex; ///< protects the state of the current job
+    std::condition_variable wakeUp; ///< signals a new job or the end of the pool
+    std::condition_variable jobDone; ///< signals that all bands are done
+    const BandFunction *jobFunction; ///< function of the current job
+    int jobRows; ///< rows of the current job
+    int jobBands; ///< bands of the current job
+    int nextBand; ///< next band which is not started
+    int pendingBands; ///< bands which are not finished
+    long jobNumber; ///< counts the jobs (to wake up the workers once per job)
+    bool stopping; ///< true -> workers have to exit
+
+    ThreadPool();
+    ~ThreadPool();
+
+    void startWorkers(); ///< start threads - 1 workers
+    void stopWorkers(); ///< stop and join all workers
+    void work(); ///< main loop of a worker
+    void runBands(); ///< take bands of the current job until all are started
+
+public:
+    /**
+      * get the global pool, the number of threads is the number of cores
+      * or the value of the environment variable CV_THREADS
+      *
+      * @return  global pool
+      */
+    static ThreadPool *instance();
+
+    /**
+      * set the number of threads (including the calling thread)
+      *
+      * @param count number of threads (0 -> number of cores)
+      */
+    void setThreadCount(int count);
+
+    /**
+      * get the number of threads (including the calling thread)
+      *
+      * @return  number of threads
+      */
+    int threadCount() const { return threads; }
+
+    /**
+      * get the number of bands for an image
+      *
+      * @param height rows of the image
+      * @param minRows minimal number of rows per band
+      * @return  number of bands (at least 1)
+      */
+    int bandCount(int height, int minRows = 16) const;
+
+    /**
+      * split the rows into bands and run the function for every band, the
+      * call returns when all bands are done
+      * called from inside of a band (or while another job is running) the
+      * bands run one after another in the calling thread
+      *
+      * @param height rows of the image
+      * @param function function for one band
+      * @param minRows minimal number of rows per band
+      */
+    void parallelBands(int height, const BandFunction &function, int minRows = 16);
+};
+
+#endif // THREADPOOL_H